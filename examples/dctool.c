@@ -40,6 +40,9 @@
 
 #include "common.h"
 #include "dctool.h"
+#ifdef ENABLE_EMULATOR
+#include "emulator.h"
+#endif
 #include "utils.h"
 
 #if defined(__GLIBC__) || defined(__MINGW32__)
@@ -58,6 +61,7 @@ static const dctool_command_t *g_commands[] = {
 	&dctool_help,
 	&dctool_version,
 	&dctool_list,
+	&dctool_monitor,
 	&dctool_download,
 	&dctool_dump,
 	&dctool_parse,
@@ -109,6 +113,9 @@ dctool_command_showhelp (const dctool_command_t *command)
 			"   -f, --family <family>     Device family type\n"
 			"   -m, --model <model>       Device model number\n"
 			"   -l, --logfile <logfile>   Logfile\n"
+#ifdef ENABLE_EMULATOR
+			"   -e, --emulate <config>    Emulate the device\n"
+#endif
 			"   -q, --quiet               Quiet mode\n"
 			"   -v, --verbose             Verbose mode\n"
 #else
@@ -117,8 +124,22 @@ dctool_command_showhelp (const dctool_command_t *command)
 			"   -f <family>    Family type\n"
 			"   -m <model>     Model number\n"
 			"   -l <logfile>   Logfile\n"
+#ifdef ENABLE_EMULATOR
+			"   -e <config>    Emulate the device\n"
+#endif
 			"   -q             Quiet mode\n"
 			"   -v             Verbose mode\n"
+#endif
+#ifdef ENABLE_EMULATOR
+			"\n"
+			"The emulator configuration is a comma separated list with the number\n"
+			"of dives (dives=<n>), the size of each dive (size=<bytes>) and whether\n"
+			"the data crosses the ringbuffer wrap point (wrap). By default the\n"
+			"emulator is registered as an extended custom transport. The basic\n"
+			"custom serial interface can be selected instead (basic). With a\n"
+			"virtual clock (virtual), the protocol delays complete immediately.\n"
+			"Devices that keep state between downloads can reset it after each\n"
+			"dive download (rewind).\n"
 #endif
 			"\n"
 			"Available commands:\n");
@@ -167,6 +188,9 @@ main (int argc, char *argv[])
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_context_t *context = NULL;
 	dc_descriptor_t *descriptor = NULL;
+#ifdef ENABLE_EMULATOR
+	dctool_emulator_t *emulator = NULL;
+#endif
 
 	// Default option values.
 	unsigned int help = 0;
@@ -176,10 +200,18 @@ main (int argc, char *argv[])
 	dc_family_t family = DC_FAMILY_NULL;
 	unsigned int model = 0;
 	unsigned int have_family = 0, have_model = 0;
+#ifdef ENABLE_EMULATOR
+	dctool_emulator_config_t emulate;
+	unsigned int have_emulate = 0;
+#endif
 
 	// Parse the command-line options.
 	int opt = 0;
+#ifdef ENABLE_EMULATOR
+	const char *optstring = NOPERMUTATION "hd:f:m:l:e:qv";
+#else
 	const char *optstring = NOPERMUTATION "hd:f:m:l:qv";
+#endif
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
@@ -187,6 +219,9 @@ main (int argc, char *argv[])
 		{"family",      required_argument, 0, 'f'},
 		{"model",       required_argument, 0, 'm'},
 		{"logfile",     required_argument, 0, 'l'},
+#ifdef ENABLE_EMULATOR
+		{"emulate",     required_argument, 0, 'e'},
+#endif
 		{"quiet",       no_argument,       0, 'q'},
 		{"verbose",     no_argument,       0, 'v'},
 		{0,             0,                 0,  0 }
@@ -213,6 +248,15 @@ main (int argc, char *argv[])
 		case 'l':
 			logfile = optarg;
 			break;
+#ifdef ENABLE_EMULATOR
+		case 'e':
+			if (dctool_emulator_config_parse (&emulate, optarg) != DC_STATUS_SUCCESS) {
+				message ("Invalid emulator configuration: %s\n", optarg);
+				return EXIT_FAILURE;
+			}
+			have_emulate = 1;
+			break;
+#endif
 		case 'q':
 			loglevel = DC_LOGLEVEL_NONE;
 			break;
@@ -301,12 +345,33 @@ main (int argc, char *argv[])
 			exitcode = EXIT_FAILURE;
 			goto cleanup;
 		}
+
+#ifdef ENABLE_EMULATOR
+		// Replace the serial port with a device emulator.
+		if (have_emulate) {
+			status = dctool_emulator_new (&emulator, context,
+				dc_descriptor_get_type (descriptor),
+				dc_descriptor_get_model (descriptor),
+				&emulate);
+			if (status != DC_STATUS_SUCCESS) {
+				message ("No emulator available for %s, 0x%X\n",
+					dctool_family_name (dc_descriptor_get_type (descriptor)),
+					dc_descriptor_get_model (descriptor));
+				exitcode = EXIT_FAILURE;
+				goto cleanup;
+			}
+		}
+#endif
 	}
 
 	// Execute the command.
 	exitcode = command->run (argc, argv, context, descriptor);
 
 cleanup:
+#ifdef ENABLE_EMULATOR
+	if (dctool_emulator_free (emulator) != DC_STATUS_SUCCESS)
+		exitcode = EXIT_FAILURE;
+#endif
 	dc_descriptor_free (descriptor);
 	dc_context_free (context);
 	message_set_logfile (NULL);
@@ -152,7 +152,43 @@ event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *us
 }
 
 static dc_status_t
-download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, dctool_output_t *output)
+register_known (dc_device_t *device, const char *filename)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	char line[1024];
+
+	FILE *fp = fopen (filename, "r");
+	if (fp == NULL) {
+		ERROR ("Failed to open the file.");
+		return DC_STATUS_IO;
+	}
+
+	// Register each fingerprint, one per line.
+	unsigned int count = 0;
+	while (fgets (line, sizeof (line), fp) != NULL) {
+		line[strcspn (line, " \t\r\n")] = 0;
+
+		dc_buffer_t *fingerprint = dctool_convert_hex2bin (line);
+		if (fingerprint == NULL)
+			continue;
+
+		rc = dc_device_add_fingerprint (device, dc_buffer_get_data (fingerprint), dc_buffer_get_size (fingerprint));
+		dc_buffer_free (fingerprint);
+		if (rc != DC_STATUS_SUCCESS)
+			break;
+
+		count++;
+	}
+
+	fclose (fp);
+
+	message ("Registered %u known fingerprints.\n", count);
+
+	return rc;
+}
+
+static dc_status_t
+download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, const char *known, dctool_output_t *output)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_device_t *device = NULL;
@@ -204,6 +240,16 @@ download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devnam
 		}
 	}
 
+	// Register the known fingerprints.
+	if (known) {
+		message ("Registering the known fingerprints.\n");
+		rc = register_known (device, known);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR ("Error registering the known fingerprints.");
+			goto cleanup;
+		}
+	}
+
 	// Initialize the dive data.
 	dive_data_t divedata = {0};
 	divedata.device = device;
@@ -253,17 +299,19 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 	const char *fphex = NULL;
 	const char *filename = NULL;
 	const char *cachedir = NULL;
+	const char *known = NULL;
 	const char *format = "xml";
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:p:c:f:u:";
+	const char *optstring = "ho:p:c:k:f:u:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
 		{"output",      required_argument, 0, 'o'},
 		{"fingerprint", required_argument, 0, 'p'},
 		{"cache",       required_argument, 0, 'c'},
+		{"known",       required_argument, 0, 'k'},
 		{"format",      required_argument, 0, 'f'},
 		{"units",       required_argument, 0, 'u'},
 		{0,             0,                 0,  0 }
@@ -285,6 +333,9 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 		case 'c':
 			cachedir = optarg;
 			break;
+		case 'k':
+			known = optarg;
+			break;
 		case 'f':
 			format = optarg;
 			break;
@@ -328,7 +379,7 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 	}
 
 	// Download the dives.
-	status = download (context, descriptor, argv[0], cachedir, fingerprint, output);
+	status = download (context, descriptor, argv[0], cachedir, fingerprint, known, output);
 	if (status != DC_STATUS_SUCCESS) {
 		message ("ERROR: %s\n", dctool_errmsg (status));
 		exitcode = EXIT_FAILURE;
@@ -355,6 +406,7 @@ const dctool_command_t dctool_download = {
 	"   -o, --output <filename>    Output filename\n"
 	"   -p, --fingerprint <data>   Fingerprint data (hexadecimal)\n"
 	"   -c, --cache <directory>    Cache directory\n"
+	"   -k, --known <filename>     Known fingerprints (hexadecimal, one per line)\n"
 	"   -f, --format <format>      Output format\n"
 	"   -u, --units <units>        Set units (metric or imperial)\n"
 #else
@@ -362,6 +414,7 @@ const dctool_command_t dctool_download = {
 	"   -o <filename>      Output filename\n"
 	"   -p <fingerprint>   Fingerprint data (hexadecimal)\n"
 	"   -c <directory>     Cache directory\n"
+	"   -k <filename>      Known fingerprints (hexadecimal, one per line)\n"
 	"   -f <format>        Output format\n"
 	"   -u <units>         Set units (metric or imperial)\n"
 #endif
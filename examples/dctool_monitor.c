@@ -0,0 +1,125 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/serial_monitor.h>
+
+#include "dctool.h"
+#include "utils.h"
+
+static void
+event_cb (dc_serial_event_t event, const char *name, unsigned int vid, unsigned int pid, void *userdata)
+{
+	printf ("%s %s vid=%04x pid=%04x\n",
+		event == DC_SERIAL_EVENT_ADD ? "add" : "remove",
+		name, vid, pid);
+	fflush (stdout);
+}
+
+static int
+dctool_monitor_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *dummy)
+{
+	int exitcode = EXIT_SUCCESS;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_monitor_t *monitor = NULL;
+
+	// Default option values.
+	unsigned int help = 0;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "h";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",        no_argument,       0, 'h'},
+		{0,             0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_monitor);
+		return EXIT_SUCCESS;
+	}
+
+	// Report the present serial ports, and then every port that is
+	// added or removed, until the user interrupts.
+	status = dc_serial_monitor_new (&monitor, context, event_cb, NULL);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the serial port monitor.");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	while (!dctool_cancel_cb (NULL)) {
+		status = dc_serial_monitor_poll (monitor, 100);
+		if (status != DC_STATUS_SUCCESS && status != DC_STATUS_TIMEOUT) {
+			ERROR ("Error waiting for serial port events.");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+
+cleanup:
+	dc_serial_monitor_free (monitor);
+	return exitcode;
+}
+
+const dctool_command_t dctool_monitor = {
+	dctool_monitor_run,
+	DCTOOL_CONFIG_NONE,
+	"monitor",
+	"Monitor serial ports being added or removed",
+	"Usage:\n"
+	"   dctool monitor [options]\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help   Show help message\n"
+#else
+	"   -h   Show help message\n"
+#endif
+};
@@ -0,0 +1,118 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DCTOOL_EMULATOR_PRIVATE_H
+#define DCTOOL_EMULATOR_PRIVATE_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/datetime.h>
+#include <libdivecomputer/buffer.h>
+#include <libdivecomputer/custom_serial.h>
+#include <libdivecomputer/context.h>
+
+#include "emulator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct dctool_emulator_vtable_t dctool_emulator_vtable_t;
+
+struct dctool_emulator_t {
+	const dctool_emulator_vtable_t *vtable;
+	dc_context_t *context;
+	dc_custom_transport_t transport;
+	dc_buffer_t *input;
+	dc_buffer_t *output;
+	size_t offset;
+	/* Statistics */
+	unsigned int ncommands;
+	unsigned int ncalls;
+	unsigned long long nreceived;
+	unsigned long long nsent;
+	double elapsed;
+	double timestamp;
+	/* Clock */
+	dc_clock_t clock;
+	unsigned int virtual;
+	unsigned long long now;
+	unsigned long long delays;
+	/* Allocator */
+	dc_allocator_t allocator;
+	volatile long nallocs;
+	volatile long nblocks;
+};
+
+struct dctool_emulator_vtable_t {
+	size_t size;
+
+	dc_family_t type;
+
+	/* Generate the synthetic memory contents. */
+	dc_status_t (*init) (dctool_emulator_t *emulator, unsigned int model, const dctool_emulator_config_t *config);
+
+	/* Reset the protocol state at the start of a new session. */
+	dc_status_t (*reset) (dctool_emulator_t *emulator);
+
+	/* Process the data received from the host. Returns the number of bytes
+	 * consumed, or zero if more data is required to complete a command. */
+	unsigned int (*process) (dctool_emulator_t *emulator, const unsigned char data[], unsigned int size);
+
+	/* Send unsolicited data, when the host reads while no answer is
+	 * pending. Optional. */
+	dc_status_t (*idle) (dctool_emulator_t *emulator);
+
+	dc_status_t (*free) (dctool_emulator_t *emulator);
+};
+
+extern const dctool_emulator_vtable_t dctool_oceanic_atom2_emulator;
+extern const dctool_emulator_vtable_t dctool_suunto_d9_emulator;
+extern const dctool_emulator_vtable_t dctool_hw_ostc3_emulator;
+extern const dctool_emulator_vtable_t dctool_shearwater_predator_emulator;
+extern const dctool_emulator_vtable_t dctool_shearwater_petrel_emulator;
+extern const dctool_emulator_vtable_t dctool_divesystem_idive_emulator;
+extern const dctool_emulator_vtable_t dctool_reefnet_sensusultra_emulator;
+
+dc_status_t
+dctool_emulator_reply (dctool_emulator_t *emulator, const unsigned char data[], unsigned int size);
+
+void
+dctool_emulator_datetime (unsigned int number, dc_datetime_t *datetime);
+
+dc_ticks_t
+dctool_emulator_ticks (unsigned int number);
+
+unsigned int
+dctool_emulator_rb_start (unsigned int begin, unsigned int end, unsigned int total, unsigned int align, unsigned int wrap);
+
+unsigned int
+dctool_emulator_rb_write (unsigned char memory[], unsigned int begin, unsigned int end, unsigned int address, const unsigned char data[], unsigned int size);
+
+unsigned int
+dctool_emulator_rb_read (const unsigned char memory[], unsigned int begin, unsigned int end, unsigned int address, unsigned char data[], unsigned int size);
+
+unsigned int
+dctool_emulator_rb_distance (unsigned int begin, unsigned int end, unsigned int a, unsigned int b);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DCTOOL_EMULATOR_PRIVATE_H */
@@ -0,0 +1,666 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+#include "emulator-private.h"
+#include "utils.h"
+
+#define C_ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
+
+#define DEFAULT_NDIVES   100
+#define DEFAULT_DIVESIZE 2048
+
+// All synthetic dives start at 2016-01-01 00:00:00 UTC, with a new dive
+// every six hours. This results in unique timestamps (and fingerprints),
+// even for devices that only store the date and time with minute resolution.
+#define EPOCH    1451606400
+#define INTERVAL (6 * 3600)
+
+static const dctool_emulator_vtable_t *g_emulators[] = {
+	&dctool_oceanic_atom2_emulator,
+	&dctool_suunto_d9_emulator,
+	&dctool_hw_ostc3_emulator,
+	&dctool_shearwater_predator_emulator,
+	&dctool_shearwater_petrel_emulator,
+	&dctool_divesystem_idive_emulator,
+	&dctool_reefnet_sensusultra_emulator,
+};
+
+static double
+dctool_emulator_now (void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&now);
+	return (double) now.QuadPart / (double) frequency.QuadPart;
+#else
+	struct timeval now;
+	gettimeofday (&now, NULL);
+	return now.tv_sec + now.tv_usec / 1000000.0;
+#endif
+}
+
+static unsigned long long
+dctool_emulator_clock_monotonic (void *userdata)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) userdata;
+
+	if (emulator->virtual)
+		return emulator->now;
+
+	return dctool_emulator_now () * 1000000.0;
+}
+
+static void
+dctool_emulator_clock_sleep (void *userdata, unsigned int milliseconds)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) userdata;
+
+	// Keep track of the deliberate delays.
+	emulator->delays += milliseconds;
+
+	if (emulator->virtual) {
+		emulator->now += milliseconds * 1000ULL;
+		return;
+	}
+
+#ifdef _WIN32
+	Sleep (milliseconds);
+#else
+	struct timespec ts;
+	ts.tv_sec  = (milliseconds / 1000);
+	ts.tv_nsec = (milliseconds % 1000) * 1000000;
+	nanosleep (&ts, NULL);
+#endif
+}
+
+static dc_status_t
+dctool_emulator_open (void **userdata, const char *name)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	dc_buffer_clear (emulator->input);
+	dc_buffer_clear (emulator->output);
+	emulator->offset = 0;
+
+	if (emulator->vtable->reset) {
+		dc_status_t rc = emulator->vtable->reset (emulator);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+	}
+
+	emulator->timestamp = dctool_emulator_now ();
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_close (void **userdata)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	emulator->elapsed += dctool_emulator_now () - emulator->timestamp;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static size_t
+dctool_emulator_receive (dctool_emulator_t *emulator, void *data, size_t size)
+{
+	// Let the device send its unsolicited data.
+	if (dc_buffer_get_size (emulator->output) == 0 && emulator->vtable->idle)
+		emulator->vtable->idle (emulator);
+
+	size_t available = dc_buffer_get_size (emulator->output) - emulator->offset;
+	size_t nbytes = (size < available ? size : available);
+
+	memcpy (data, dc_buffer_get_data (emulator->output) + emulator->offset, nbytes);
+	emulator->offset += nbytes;
+	emulator->nsent += nbytes;
+
+	// Release the buffer once all data has been consumed.
+	if (emulator->offset == dc_buffer_get_size (emulator->output)) {
+		dc_buffer_clear (emulator->output);
+		emulator->offset = 0;
+	}
+
+	return nbytes;
+}
+
+static dc_status_t
+dctool_emulator_read (void **userdata, void *data, size_t size, size_t *actual)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	emulator->ncalls++;
+
+	// Return all the data that is available. Because the emulator answers
+	// every command immediately, missing data will never arrive and is
+	// reported as a timeout.
+	size_t nbytes = dctool_emulator_receive (emulator, data, size);
+
+	if (actual)
+		*actual = nbytes;
+
+	if (nbytes != size)
+		return DC_STATUS_TIMEOUT;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_read_some (void **userdata, void *data, size_t minimum, size_t maximum, size_t *actual)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	emulator->ncalls++;
+
+	size_t nbytes = dctool_emulator_receive (emulator, data, maximum);
+
+	if (actual)
+		*actual = nbytes;
+
+	if (nbytes < minimum)
+		return DC_STATUS_TIMEOUT;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_readv (void **userdata, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	emulator->ncalls++;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		size_t n = dctool_emulator_receive (emulator, iov[i].data, iov[i].size);
+		nbytes += n;
+		if (n != iov[i].size) {
+			status = DC_STATUS_TIMEOUT;
+			break;
+		}
+	}
+
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+static dc_status_t
+dctool_emulator_send (dctool_emulator_t *emulator, const void *data, size_t size)
+{
+	if (!dc_buffer_append (emulator->input, (const unsigned char *) data, size))
+		return DC_STATUS_NOMEMORY;
+
+	emulator->nreceived += size;
+
+	// Process all complete commands.
+	unsigned char *buffer = dc_buffer_get_data (emulator->input);
+	unsigned int length = dc_buffer_get_size (emulator->input);
+	unsigned int offset = 0;
+	while (offset < length) {
+		unsigned int n = emulator->vtable->process (emulator, buffer + offset, length - offset);
+		if (n == 0)
+			break;
+
+		emulator->ncommands++;
+		offset += n;
+	}
+
+	// Keep the remaining data for the next write.
+	dc_buffer_slice (emulator->input, offset, length - offset);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_write (void **userdata, const void *data, size_t size, size_t *actual)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	emulator->ncalls++;
+
+	dc_status_t status = dctool_emulator_send (emulator, data, size);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	if (actual)
+		*actual = size;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_writev (void **userdata, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+	size_t nbytes = 0;
+
+	emulator->ncalls++;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		dc_status_t status = dctool_emulator_send (emulator, iov[i].data, iov[i].size);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+		nbytes += iov[i].size;
+	}
+
+	if (actual)
+		*actual = nbytes;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_purge (void **userdata, dc_direction_t direction)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	if (direction & DC_DIRECTION_INPUT) {
+		dc_buffer_clear (emulator->output);
+		emulator->offset = 0;
+	}
+
+	if (direction & DC_DIRECTION_OUTPUT) {
+		dc_buffer_clear (emulator->input);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_emulator_get_available (void **userdata, size_t *value)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) *userdata;
+
+	if (value)
+		*value = dc_buffer_get_size (emulator->output) - emulator->offset;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dctool_emulator_config_parse (dctool_emulator_config_t *config, const char *str)
+{
+	if (config == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Default values.
+	config->ndives = DEFAULT_NDIVES;
+	config->divesize = DEFAULT_DIVESIZE;
+	config->wrap = 0;
+	config->basic = 0;
+	config->virtual = 0;
+	config->rewind = 0;
+
+	if (str == NULL)
+		return DC_STATUS_SUCCESS;
+
+	// Parse the comma separated list of key=value pairs.
+	while (*str) {
+		size_t len = strcspn (str, ",");
+		const char *value = memchr (str, '=', len);
+		size_t keylen = (value ? (size_t) (value - str) : len);
+
+		unsigned int number = 1;
+		if (value) {
+			char *end = NULL;
+			number = strtoul (value + 1, &end, 0);
+			if (end != str + len)
+				return DC_STATUS_INVALIDARGS;
+		}
+
+		if (keylen == 5 && strncmp (str, "dives", keylen) == 0) {
+			config->ndives = number;
+		} else if (keylen == 4 && strncmp (str, "size", keylen) == 0) {
+			config->divesize = number;
+		} else if (keylen == 4 && strncmp (str, "wrap", keylen) == 0) {
+			config->wrap = number;
+		} else if (keylen == 5 && strncmp (str, "basic", keylen) == 0) {
+			config->basic = number;
+		} else if (keylen == 7 && strncmp (str, "virtual", keylen) == 0) {
+			config->virtual = number;
+		} else if (keylen == 6 && strncmp (str, "rewind", keylen) == 0) {
+			config->rewind = number;
+		} else if (keylen != 0) {
+			return DC_STATUS_INVALIDARGS;
+		}
+
+		str += len;
+		if (*str == ',')
+			str++;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * The allocator is also used by the pipeline workers, so the counters
+ * are updated atomically.
+ */
+static void
+dctool_emulator_count (volatile long *counter, long amount)
+{
+#if defined(_WIN32)
+	InterlockedExchangeAdd (counter, amount);
+#elif defined(__GNUC__)
+	__sync_add_and_fetch (counter, amount);
+#else
+	*counter += amount;
+#endif
+}
+
+static void *
+dctool_emulator_malloc (void *userdata, size_t size)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) userdata;
+
+	void *ptr = malloc (size);
+	if (ptr) {
+		dctool_emulator_count (&emulator->nallocs, 1);
+		dctool_emulator_count (&emulator->nblocks, 1);
+	}
+
+	return ptr;
+}
+
+static void *
+dctool_emulator_realloc (void *userdata, void *ptr, size_t size)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) userdata;
+
+	void *result = realloc (ptr, size);
+	if (result && ptr == NULL) {
+		dctool_emulator_count (&emulator->nallocs, 1);
+		dctool_emulator_count (&emulator->nblocks, 1);
+	}
+
+	return result;
+}
+
+static void
+dctool_emulator_free_block (void *userdata, void *ptr)
+{
+	dctool_emulator_t *emulator = (dctool_emulator_t *) userdata;
+
+	dctool_emulator_count (&emulator->nblocks, -1);
+	free (ptr);
+}
+
+dc_status_t
+dctool_emulator_new (dctool_emulator_t **out, dc_context_t *context, dc_family_t family, unsigned int model, const dctool_emulator_config_t *config)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dctool_emulator_t *emulator = NULL;
+
+	if (out == NULL || config == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Find the emulator for the device family.
+	const dctool_emulator_vtable_t *vtable = NULL;
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (g_emulators); ++i) {
+		if (g_emulators[i]->type == family) {
+			vtable = g_emulators[i];
+			break;
+		}
+	}
+
+	if (vtable == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	assert (vtable->size >= sizeof (dctool_emulator_t));
+
+	// Allocate memory.
+	emulator = (dctool_emulator_t *) malloc (vtable->size);
+	if (emulator == NULL) {
+		return DC_STATUS_NOMEMORY;
+	}
+
+	emulator->vtable = vtable;
+	emulator->context = context;
+	emulator->offset = 0;
+	emulator->ncommands = 0;
+	emulator->ncalls = 0;
+	emulator->nreceived = 0;
+	emulator->nsent = 0;
+	emulator->elapsed = 0.0;
+	emulator->timestamp = 0.0;
+	emulator->virtual = config->virtual;
+	emulator->now = 0;
+	emulator->delays = 0;
+	emulator->nallocs = 0;
+	emulator->nblocks = 0;
+
+	memset (&emulator->allocator, 0, sizeof (emulator->allocator));
+	emulator->allocator.malloc = dctool_emulator_malloc;
+	emulator->allocator.realloc = dctool_emulator_realloc;
+	emulator->allocator.free = dctool_emulator_free_block;
+	emulator->allocator.userdata = emulator;
+
+	memset (&emulator->clock, 0, sizeof (emulator->clock));
+	emulator->clock.monotonic = dctool_emulator_clock_monotonic;
+	emulator->clock.sleep = dctool_emulator_clock_sleep;
+	emulator->clock.userdata = emulator;
+
+	memset (&emulator->transport, 0, sizeof (emulator->transport));
+	emulator->transport.serial.userdata = emulator;
+	emulator->transport.serial.open = dctool_emulator_open;
+	emulator->transport.serial.close = dctool_emulator_close;
+	emulator->transport.serial.read = dctool_emulator_read;
+	emulator->transport.serial.write = dctool_emulator_write;
+	emulator->transport.serial.purge = dctool_emulator_purge;
+	emulator->transport.serial.get_available = dctool_emulator_get_available;
+	emulator->transport.readv = dctool_emulator_readv;
+	emulator->transport.writev = dctool_emulator_writev;
+	emulator->transport.read_some = dctool_emulator_read_some;
+
+	emulator->input = dc_buffer_new (0);
+	emulator->output = dc_buffer_new (0);
+	if (emulator->input == NULL || emulator->output == NULL) {
+		status = DC_STATUS_NOMEMORY;
+		goto error_free;
+	}
+
+	// Generate the memory contents.
+	status = vtable->init (emulator, model, config);
+	if (status != DC_STATUS_SUCCESS) {
+		if (vtable->free)
+			vtable->free (emulator);
+		goto error_free;
+	}
+
+	// Route all serial communication to the emulator.
+	if (config->basic)
+		dc_context_set_custom_serial (context, &emulator->transport.serial);
+	else
+		dc_context_set_custom_transport (context, &emulator->transport);
+
+	// Route all delays through the emulator clock.
+	dc_context_set_clock (context, &emulator->clock);
+
+	// Count the memory allocations of the library, to detect leaks. The
+	// counters are not protected against concurrent access, because dctool
+	// only uses the library from a single thread.
+	status = dc_context_set_allocator (context, &emulator->allocator);
+	if (status != DC_STATUS_SUCCESS) {
+		dc_context_set_custom_serial (context, NULL);
+		dc_context_set_clock (context, NULL);
+		if (vtable->free)
+			vtable->free (emulator);
+		goto error_free;
+	}
+
+	*out = emulator;
+
+	return DC_STATUS_SUCCESS;
+
+error_free:
+	dc_buffer_free (emulator->output);
+	dc_buffer_free (emulator->input);
+	free (emulator);
+	return status;
+}
+
+dc_status_t
+dctool_emulator_free (dctool_emulator_t *emulator)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (emulator == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_context_set_custom_serial (emulator->context, NULL);
+	dc_context_set_clock (emulator->context, NULL);
+
+	// Check that all the memory has been released.
+	if (emulator->nblocks) {
+		message ("Emulator: %ld of %ld memory blocks not released\n",
+			emulator->nblocks, emulator->nallocs);
+		status = DC_STATUS_NOMEMORY;
+	} else {
+		dc_context_set_allocator (emulator->context, NULL);
+	}
+
+	// Report the transfer statistics.
+	double rate = 0.0;
+	if (emulator->elapsed > 0.0)
+		rate = emulator->nsent / emulator->elapsed / 1024.0;
+	message ("Emulator: commands=%u, calls=%u, received=%llu, sent=%llu, elapsed=%.3fs, delays=%.3fs%s, rate=%.1fKiB/s, allocations=%ld\n",
+		emulator->ncommands, emulator->ncalls, emulator->nreceived, emulator->nsent,
+		emulator->elapsed, emulator->delays / 1000.0, emulator->virtual ? " (virtual)" : "", rate,
+		emulator->nallocs);
+
+	if (emulator->vtable->free) {
+		dc_status_t rc = emulator->vtable->free (emulator);
+		if (status == DC_STATUS_SUCCESS)
+			status = rc;
+	}
+
+	dc_buffer_free (emulator->output);
+	dc_buffer_free (emulator->input);
+	free (emulator);
+
+	return status;
+}
+
+dc_status_t
+dctool_emulator_reply (dctool_emulator_t *emulator, const unsigned char data[], unsigned int size)
+{
+	if (!dc_buffer_append (emulator->output, data, size))
+		return DC_STATUS_NOMEMORY;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_ticks_t
+dctool_emulator_ticks (unsigned int number)
+{
+	return EPOCH + (dc_ticks_t) number * INTERVAL;
+}
+
+void
+dctool_emulator_datetime (unsigned int number, dc_datetime_t *datetime)
+{
+	dc_datetime_gmtime (datetime, dctool_emulator_ticks (number));
+}
+
+unsigned int
+dctool_emulator_rb_start (unsigned int begin, unsigned int end, unsigned int total, unsigned int align, unsigned int wrap)
+{
+	if (!wrap)
+		return begin;
+
+	// Start writing such that roughly half of the data ends up before and
+	// half after the ringbuffer wrap point.
+	unsigned int size = end - begin;
+	if (total > size)
+		total = size;
+
+	unsigned int offset = (total / 2) / align * align;
+	if (offset == 0)
+		return begin;
+
+	return end - offset;
+}
+
+unsigned int
+dctool_emulator_rb_write (unsigned char memory[], unsigned int begin, unsigned int end, unsigned int address, const unsigned char data[], unsigned int size)
+{
+	unsigned int nbytes = 0;
+	while (nbytes < size) {
+		unsigned int len = end - address;
+		if (len > size - nbytes)
+			len = size - nbytes;
+
+		memcpy (memory + address, data + nbytes, len);
+
+		nbytes += len;
+		address += len;
+		if (address == end)
+			address = begin;
+	}
+
+	return address;
+}
+
+unsigned int
+dctool_emulator_rb_read (const unsigned char memory[], unsigned int begin, unsigned int end, unsigned int address, unsigned char data[], unsigned int size)
+{
+	unsigned int nbytes = 0;
+	while (nbytes < size) {
+		unsigned int len = end - address;
+		if (len > size - nbytes)
+			len = size - nbytes;
+
+		memcpy (data + nbytes, memory + address, len);
+
+		nbytes += len;
+		address += len;
+		if (address == end)
+			address = begin;
+	}
+
+	return address;
+}
+
+unsigned int
+dctool_emulator_rb_distance (unsigned int begin, unsigned int end, unsigned int a, unsigned int b)
+{
+	if (b >= a)
+		return b - a;
+	else
+		return (end - a) + (b - begin);
+}
@@ -0,0 +1,55 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DCTOOL_EMULATOR_H
+#define DCTOOL_EMULATOR_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct dctool_emulator_t dctool_emulator_t;
+
+typedef struct dctool_emulator_config_t {
+	unsigned int ndives;   /* Number of dives recorded by the device. */
+	unsigned int divesize; /* Approximate size of a single dive (bytes). */
+	unsigned int wrap;     /* Place the data across the ringbuffer wrap point. */
+	unsigned int basic;    /* Use the basic custom serial interface only. */
+	unsigned int virtual;  /* Use a virtual clock instead of sleeping. */
+	unsigned int rewind;   /* Reset the device state after each dive download. */
+} dctool_emulator_config_t;
+
+dc_status_t
+dctool_emulator_config_parse (dctool_emulator_config_t *config, const char *str);
+
+dc_status_t
+dctool_emulator_new (dctool_emulator_t **out, dc_context_t *context, dc_family_t family, unsigned int model, const dctool_emulator_config_t *config);
+
+dc_status_t
+dctool_emulator_free (dctool_emulator_t *emulator);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DCTOOL_EMULATOR_H */
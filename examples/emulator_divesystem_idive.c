@@ -0,0 +1,226 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define IX3M_EASY 0x22
+#define IX3M_REB  0x25
+
+#define MAXPACKET 0xFF
+#define START     0x55
+#define ACK       0x06
+#define NAK       0x15
+#define BUSY      0x60
+
+// The dive computer stores its timestamps relative to 2008-01-01.
+#define EPOCH 1199145600
+
+typedef struct divesystem_idive_commands_t {
+	unsigned char id, range, header, sample;
+	unsigned int idsize, headersize, samplesize;
+} divesystem_idive_commands_t;
+
+typedef struct divesystem_idive_emulator_t {
+	dctool_emulator_t base;
+	const divesystem_idive_commands_t *commands;
+	unsigned int model;
+	unsigned int ndives;
+	unsigned int nsamples;
+	unsigned int busy;
+} divesystem_idive_emulator_t;
+
+static dc_status_t divesystem_idive_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static dc_status_t divesystem_idive_emulator_reset (dctool_emulator_t *abstract);
+static unsigned int divesystem_idive_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+
+const dctool_emulator_vtable_t dctool_divesystem_idive_emulator = {
+	sizeof(divesystem_idive_emulator_t), /* size */
+	DC_FAMILY_DIVESYSTEM_IDIVE, /* type */
+	divesystem_idive_emulator_init, /* init */
+	divesystem_idive_emulator_reset, /* reset */
+	divesystem_idive_emulator_process, /* process */
+	NULL, /* idle */
+	NULL, /* free */
+};
+
+static const divesystem_idive_commands_t idive = {
+	0x10, 0x98, 0xA0, 0xA8,
+	0x0A, 0x32, 0x2A,
+};
+
+static const divesystem_idive_commands_t ix3m = {
+	0x11, 0x78, 0x79, 0x7A,
+	0x1A, 0x36, 0x36,
+};
+
+static unsigned short
+divesystem_idive_emulator_crc (const unsigned char data[], unsigned int size)
+{
+	unsigned short crc = 0xFFFF;
+	for (unsigned int i = 0; i < size; ++i) {
+		crc ^= data[i] << 8;
+		for (unsigned int j = 0; j < 8; ++j) {
+			if (crc & 0x8000)
+				crc = (crc << 1) ^ 0x1021;
+			else
+				crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+static dc_status_t
+divesystem_idive_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	divesystem_idive_emulator_t *emulator = (divesystem_idive_emulator_t *) abstract;
+
+	if (model >= IX3M_EASY && model <= IX3M_REB)
+		emulator->commands = &ix3m;
+	else
+		emulator->commands = &idive;
+
+	// The dive numbers are 16 bit values, starting at one.
+	emulator->model = model;
+	emulator->ndives = config->ndives;
+	if (emulator->ndives > 0xFFFF)
+		emulator->ndives = 0xFFFF;
+
+	// Every dive has a fixed number of samples.
+	emulator->nsamples = config->divesize / emulator->commands->samplesize;
+	if (emulator->nsamples == 0)
+		emulator->nsamples = 1;
+	if (emulator->nsamples > 0xFFFF)
+		emulator->nsamples = 0xFFFF;
+
+	emulator->busy = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+divesystem_idive_emulator_reset (dctool_emulator_t *abstract)
+{
+	divesystem_idive_emulator_t *emulator = (divesystem_idive_emulator_t *) abstract;
+
+	emulator->busy = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static void
+divesystem_idive_emulator_send (dctool_emulator_t *abstract, unsigned char cmd, const unsigned char data[], unsigned int size, unsigned char status)
+{
+	unsigned char packet[MAXPACKET + 4];
+
+	packet[0] = START;
+	packet[1] = size + 2;
+	packet[2] = cmd;
+	if (size)
+		memcpy (packet + 3, data, size);
+	packet[size + 3] = status;
+
+	unsigned short crc = divesystem_idive_emulator_crc (packet, size + 4);
+	packet[size + 4] = (crc >> 8) & 0xFF;
+	packet[size + 5] = (crc     ) & 0xFF;
+
+	dctool_emulator_reply (abstract, packet, size + 6);
+}
+
+static unsigned int
+divesystem_idive_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	divesystem_idive_emulator_t *emulator = (divesystem_idive_emulator_t *) abstract;
+	const divesystem_idive_commands_t *commands = emulator->commands;
+	unsigned char answer[MAXPACKET] = {0};
+
+	// Skip garbage until the start of the next packet.
+	if (data[0] != START)
+		return 1;
+
+	// Wait for a complete packet.
+	if (size < 2 || size < data[1] + 4u)
+		return 0;
+
+	unsigned int len = data[1];
+	unsigned int psize = len + 4;
+	unsigned short crc = (data[len + 2] << 8) | data[len + 3];
+	if (len < 1 || crc != divesystem_idive_emulator_crc (data, len + 2))
+		return psize;
+
+	const unsigned char *payload = data + 2;
+	unsigned char cmd = payload[0];
+	unsigned int number = (len >= 3 ? payload[1] | (payload[2] << 8) : 0);
+
+	if (cmd == commands->id) {
+		answer[0] = emulator->model & 0xFF;
+		answer[1] = (emulator->model >> 8) & 0xFF;
+		answer[6] = 0x78;
+		answer[7] = 0x56;
+		answer[8] = 0x34;
+		answer[9] = 0x12;
+		divesystem_idive_emulator_send (abstract, cmd, answer, commands->idsize, ACK);
+	} else if (cmd == commands->range) {
+		unsigned int first = 1;
+		unsigned int last = emulator->ndives;
+		answer[0] = first & 0xFF;
+		answer[1] = (first >> 8) & 0xFF;
+		answer[2] = last & 0xFF;
+		answer[3] = (last >> 8) & 0xFF;
+		divesystem_idive_emulator_send (abstract, cmd, answer, 4, ACK);
+	} else if (cmd == commands->header) {
+		// Every other header request is answered with a busy error
+		// first, like a device that still needs to prepare the dive.
+		emulator->busy = !emulator->busy;
+		if (emulator->busy) {
+			answer[0] = BUSY;
+			divesystem_idive_emulator_send (abstract, cmd, answer, 1, NAK);
+			return psize;
+		}
+
+		unsigned int ticks = dctool_emulator_ticks (number - 1) - EPOCH;
+		answer[1] = emulator->nsamples & 0xFF;
+		answer[2] = (emulator->nsamples >> 8) & 0xFF;
+		answer[7] = (ticks      ) & 0xFF;
+		answer[8] = (ticks >>  8) & 0xFF;
+		answer[9] = (ticks >> 16) & 0xFF;
+		answer[10] = (ticks >> 24) & 0xFF;
+		divesystem_idive_emulator_send (abstract, cmd, answer, commands->headersize, ACK);
+	} else if (cmd == commands->sample) {
+		// A flat profile at 10m and 20°C on air, with a sample
+		// every 10 seconds.
+		unsigned int time = number * 10;
+		answer[2] = (time      ) & 0xFF;
+		answer[3] = (time >>  8) & 0xFF;
+		answer[4] = (time >> 16) & 0xFF;
+		answer[5] = (time >> 24) & 0xFF;
+		answer[6] = 100;
+		answer[8] = 200;
+		answer[10] = 21;
+		divesystem_idive_emulator_send (abstract, cmd, answer, commands->samplesize, ACK);
+	}
+
+	// Unsupported commands are silently ignored.
+
+	return psize;
+}
@@ -0,0 +1,339 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define SZ_CUSTOMTEXT 60
+#define SZ_VERSION    (SZ_CUSTOMTEXT + 4)
+#define SZ_HARDWARE2  5
+#define SZ_MEMORY     0x400000
+#define SZ_SECTOR     0x1000
+
+#define RB_LOGBOOK_SIZE_COMPACT  16
+#define RB_LOGBOOK_SIZE_FULL     256
+#define RB_LOGBOOK_COUNT 256
+
+#define RB_PROFILE_BEGIN 0x200000
+#define RB_PROFILE_END   0x400000
+
+#define S_BLOCK_READ 0x20
+#define S_READY    0x4C
+#define READY      0x4D
+#define HARDWARE2  0x60
+#define HEADER     0x61
+#define DIVE       0x66
+#define IDENTITY   0x69
+#define COMPACT    0x6D
+#define INIT       0xBB
+#define EXIT       0xFF
+
+#define SERIAL     12345
+#define FIRMWARE   0x0A05
+
+typedef struct hw_ostc3_emulator_t {
+	dctool_emulator_t base;
+	unsigned int model;
+	unsigned int service;
+	unsigned int command;
+	unsigned int isize;
+	unsigned char memory[SZ_MEMORY];
+} hw_ostc3_emulator_t;
+
+static dc_status_t hw_ostc3_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static dc_status_t hw_ostc3_emulator_reset (dctool_emulator_t *abstract);
+static unsigned int hw_ostc3_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+
+const dctool_emulator_vtable_t dctool_hw_ostc3_emulator = {
+	sizeof(hw_ostc3_emulator_t), /* size */
+	DC_FAMILY_HW_OSTC3, /* type */
+	hw_ostc3_emulator_init, /* init */
+	hw_ostc3_emulator_reset, /* reset */
+	hw_ostc3_emulator_process, /* process */
+	NULL, /* idle */
+	NULL, /* free */
+};
+
+static void
+uint24_le_set (unsigned char data[], unsigned int value)
+{
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+}
+
+static unsigned int
+uint24_le (const unsigned char data[])
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16);
+}
+
+static dc_status_t
+hw_ostc3_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	hw_ostc3_emulator_t *emulator = (hw_ostc3_emulator_t *) abstract;
+	unsigned char *memory = emulator->memory;
+
+	emulator->model = model;
+	emulator->service = 0;
+	emulator->command = 0;
+	emulator->isize = 0;
+
+	// Erased flash memory.
+	memset (memory, 0xFF, sizeof (emulator->memory));
+
+	// The profile consists of the (3 byte) length, the sample rate, the
+	// number of sample descriptors (none), a number of depth-only samples
+	// and the end of profile marker. The length stored in the header is
+	// three bytes larger than the actual profile.
+	unsigned int nsamples = 1;
+	if (config->divesize > 7 + 3)
+		nsamples = (config->divesize - 7) / 3;
+	if (7 + 3 * nsamples >= RB_PROFILE_END - RB_PROFILE_BEGIN)
+		nsamples = (RB_PROFILE_END - RB_PROFILE_BEGIN - 8) / 3;
+	unsigned int size = 7 + 3 * nsamples;
+
+	unsigned char *profile = (unsigned char *) malloc (size);
+	if (profile == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Record all dives in chronological order. Older dives are
+	// overwritten once the ringbuffer or the logbook is full.
+	unsigned int address = dctool_emulator_rb_start (RB_PROFILE_BEGIN, RB_PROFILE_END,
+		config->ndives * size, 1, config->wrap);
+	for (unsigned int i = 0; i < config->ndives; ++i) {
+		uint24_le_set (profile, size + 3);
+		profile[3] = 10; // Sample rate
+		profile[4] = 0;  // Number of sample descriptors
+		for (unsigned int j = 0; j < nsamples; ++j) {
+			unsigned int depth = 1000 + ((i + j) % 64) * 100; // mbar
+			profile[5 + 3 * j + 0] = depth & 0xFF;
+			profile[5 + 3 * j + 1] = (depth >> 8) & 0xFF;
+			profile[5 + 3 * j + 2] = 0;
+		}
+		profile[size - 2] = 0xFD;
+		profile[size - 1] = 0xFD;
+
+		unsigned int begin = address;
+		address = dctool_emulator_rb_write (memory, RB_PROFILE_BEGIN, RB_PROFILE_END, address, profile, size);
+
+		dc_datetime_t dt;
+		dctool_emulator_datetime (i, &dt);
+
+		unsigned char *header = memory + (i % RB_LOGBOOK_COUNT) * SZ_SECTOR;
+		memset (header, 0x00, RB_LOGBOOK_SIZE_FULL);
+		header[0] = 0xFA;
+		header[1] = 0xFA;
+		uint24_le_set (header + 2, begin);
+		uint24_le_set (header + 5, address);
+		header[8] = 0x23;
+		uint24_le_set (header + 9, size + 3);
+		header[12] = dt.year % 100;
+		header[13] = dt.month;
+		header[14] = dt.day;
+		header[15] = dt.hour;
+		header[16] = dt.minute;
+		header[0x30] = (FIRMWARE >> 8) & 0xFF;
+		header[0x31] = (FIRMWARE     ) & 0xFF;
+		header[80] = (i + 1) & 0xFF;
+		header[81] = ((i + 1) >> 8) & 0xFF;
+		header[254] = 0xFB;
+		header[255] = 0xFB;
+	}
+
+	free (profile);
+
+	// Erase the logbook entries of the dives that are no longer
+	// available, because their profile is overwritten already.
+	unsigned int count = 0, total = 0;
+	while (count < config->ndives && count < RB_LOGBOOK_COUNT) {
+		if (total + size > RB_PROFILE_END - RB_PROFILE_BEGIN)
+			break;
+		total += size;
+		count++;
+	}
+	for (unsigned int i = count; i < config->ndives && i < RB_LOGBOOK_COUNT; ++i) {
+		unsigned int idx = (config->ndives - 1 - i) % RB_LOGBOOK_COUNT;
+		memset (memory + idx * SZ_SECTOR, 0xFF, RB_LOGBOOK_SIZE_FULL);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+hw_ostc3_emulator_reset (dctool_emulator_t *abstract)
+{
+	hw_ostc3_emulator_t *emulator = (hw_ostc3_emulator_t *) abstract;
+
+	emulator->service = 0;
+	emulator->command = 0;
+	emulator->isize = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static void
+hw_ostc3_emulator_command (hw_ostc3_emulator_t *emulator, unsigned int cmd, const unsigned char input[])
+{
+	dctool_emulator_t *abstract = (dctool_emulator_t *) emulator;
+	const unsigned char *memory = emulator->memory;
+
+	switch (cmd) {
+	case HARDWARE2: {
+			unsigned char hardware[SZ_HARDWARE2] = {
+				(emulator->model >> 8) & 0xFF,
+				(emulator->model     ) & 0xFF,
+				0x00, 0x00, 0x00};
+			dctool_emulator_reply (abstract, hardware, sizeof (hardware));
+		}
+		break;
+	case IDENTITY: {
+			unsigned char version[SZ_VERSION];
+			version[0] = (SERIAL     ) & 0xFF;
+			version[1] = (SERIAL >> 8) & 0xFF;
+			version[2] = (FIRMWARE >> 8) & 0xFF;
+			version[3] = (FIRMWARE     ) & 0xFF;
+			memset (version + 4, ' ', SZ_CUSTOMTEXT);
+			dctool_emulator_reply (abstract, version, sizeof (version));
+		}
+		break;
+	case HEADER:
+		for (unsigned int i = 0; i < RB_LOGBOOK_COUNT; ++i) {
+			dctool_emulator_reply (abstract, memory + i * SZ_SECTOR, RB_LOGBOOK_SIZE_FULL);
+		}
+		break;
+	case COMPACT:
+		for (unsigned int i = 0; i < RB_LOGBOOK_COUNT; ++i) {
+			const unsigned char *header = memory + i * SZ_SECTOR;
+			unsigned char compact[RB_LOGBOOK_SIZE_COMPACT];
+			if (header[0] == 0xFF && header[1] == 0xFF) {
+				memset (compact, 0xFF, sizeof (compact));
+			} else {
+				memset (compact, 0x00, sizeof (compact));
+				memcpy (compact + 0, header + 9, 3);
+				memcpy (compact + 3, header + 12, 5);
+				memcpy (compact + 13, header + 80, 2);
+			}
+			dctool_emulator_reply (abstract, compact, sizeof (compact));
+		}
+		break;
+	case DIVE: {
+			const unsigned char *header = memory + input[0] * SZ_SECTOR;
+			dctool_emulator_reply (abstract, header, RB_LOGBOOK_SIZE_FULL);
+			if (header[0] == 0xFF && header[1] == 0xFF)
+				break;
+
+			unsigned int begin = uint24_le (header + 2);
+			unsigned int length = uint24_le (header + 9) - 3;
+			unsigned char *profile = (unsigned char *) malloc (length);
+			if (profile == NULL)
+				break;
+			dctool_emulator_rb_read (memory, RB_PROFILE_BEGIN, RB_PROFILE_END, begin, profile, length);
+			dctool_emulator_reply (abstract, profile, length);
+			free (profile);
+		}
+		break;
+	case S_BLOCK_READ: {
+			unsigned int address = (input[0] << 16) | (input[1] << 8) | input[2];
+			unsigned int length = (input[3] << 16) | (input[4] << 8) | input[5];
+			if (address + length <= SZ_MEMORY)
+				dctool_emulator_reply (abstract, memory + address, length);
+		}
+		break;
+	default:
+		break;
+	}
+
+	// Send the ready byte.
+	unsigned char ready[1] = {emulator->service ? S_READY : READY};
+	dctool_emulator_reply (abstract, ready, sizeof (ready));
+}
+
+static unsigned int
+hw_ostc3_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	hw_ostc3_emulator_t *emulator = (hw_ostc3_emulator_t *) abstract;
+
+	// Finish the pending command once the input data is complete.
+	if (emulator->command) {
+		if (size < emulator->isize)
+			return 0;
+
+		unsigned int isize = emulator->isize;
+		hw_ostc3_emulator_command (emulator, emulator->command, data);
+		emulator->command = 0;
+		emulator->isize = 0;
+		return isize;
+	}
+
+	// Enter service mode.
+	if (data[0] == 0xAA) {
+		const unsigned char service[] = {0xAA, 0xAB, 0xCD, 0xEF};
+		if (size < sizeof (service))
+			return 0;
+
+		if (memcmp (data, service, sizeof (service)) == 0) {
+			const unsigned char answer[] = {0x4B, 0xAB, 0xCD, 0xEF, S_READY};
+			dctool_emulator_reply (abstract, answer, sizeof (answer));
+			emulator->service = 1;
+		}
+
+		return sizeof (service);
+	}
+
+	unsigned char cmd[1] = {data[0]};
+	switch (cmd[0]) {
+	case EXIT:
+		dctool_emulator_reply (abstract, cmd, sizeof (cmd));
+		emulator->service = 0;
+		break;
+	case INIT:
+	case HARDWARE2:
+	case IDENTITY:
+	case HEADER:
+	case COMPACT:
+		dctool_emulator_reply (abstract, cmd, sizeof (cmd));
+		hw_ostc3_emulator_command (emulator, cmd[0], NULL);
+		break;
+	case DIVE:
+		dctool_emulator_reply (abstract, cmd, sizeof (cmd));
+		emulator->command = cmd[0];
+		emulator->isize = 1;
+		break;
+	case S_BLOCK_READ:
+		if (emulator->service) {
+			dctool_emulator_reply (abstract, cmd, sizeof (cmd));
+			emulator->command = cmd[0];
+			emulator->isize = 6;
+			break;
+		}
+		// Fall-through!
+	default:
+		// Unsupported commands are answered with the ready byte.
+		cmd[0] = (emulator->service ? S_READY : READY);
+		dctool_emulator_reply (abstract, cmd, sizeof (cmd));
+		break;
+	}
+
+	return 1;
+}
@@ -0,0 +1,230 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define CMD_INIT      0xA8
+#define CMD_VERSION   0x84
+#define CMD_READ1     0xB1
+#define CMD_READ8     0xB4
+#define CMD_READ16    0xB8
+#define CMD_KEEPALIVE 0x91
+#define CMD_QUIT      0x6A
+
+#define ACK 0x5A
+#define NAK 0xA5
+
+#define PAGESIZE 0x10
+
+// The emulator identifies itself as an Aeris A300CS, which supports the
+// largest (16 pages) read command.
+#define MODEL    0x454C
+
+#define SZ_MEMORY  0x40000
+#define CF_DEVINFO  0x0000
+#define CF_POINTERS 0x0040
+#define RB_LOGBOOK_BEGIN 0x0900
+#define RB_LOGBOOK_END   0x1000
+#define RB_LOGBOOK_SIZE  16
+#define RB_PROFILE_BEGIN 0x1000
+#define RB_PROFILE_END   0x3FE00
+
+typedef struct oceanic_atom2_emulator_t {
+	dctool_emulator_t base;
+	unsigned char memory[SZ_MEMORY];
+} oceanic_atom2_emulator_t;
+
+static dc_status_t oceanic_atom2_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static unsigned int oceanic_atom2_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+
+const dctool_emulator_vtable_t dctool_oceanic_atom2_emulator = {
+	sizeof(oceanic_atom2_emulator_t), /* size */
+	DC_FAMILY_OCEANIC_ATOM2, /* type */
+	oceanic_atom2_emulator_init, /* init */
+	NULL, /* reset */
+	oceanic_atom2_emulator_process, /* process */
+	NULL, /* idle */
+	NULL, /* free */
+};
+
+static const unsigned char version[PAGESIZE] = "AER300CS \0\0 2048";
+
+static dc_status_t
+oceanic_atom2_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	oceanic_atom2_emulator_t *emulator = (oceanic_atom2_emulator_t *) abstract;
+	unsigned char *memory = emulator->memory;
+
+	// Erased memory.
+	memset (memory, 0xFF, sizeof (emulator->memory));
+
+	// Device info.
+	unsigned char *id = memory + CF_DEVINFO;
+	memset (id, 0x00, PAGESIZE);
+	id[8]  = (MODEL >> 8) & 0xFF;
+	id[9]  = (MODEL     ) & 0xFF;
+	id[10] = 0x12;
+	id[11] = 0x34;
+	id[12] = 0x56;
+
+	// Round the profile size up to a multiple of the page size.
+	unsigned int size = (config->divesize + PAGESIZE - 1) / PAGESIZE * PAGESIZE;
+	if (size == 0)
+		size = PAGESIZE;
+	if (size > RB_PROFILE_END - RB_PROFILE_BEGIN)
+		size = RB_PROFILE_END - RB_PROFILE_BEGIN;
+
+	unsigned char *profile = (unsigned char *) malloc (size);
+	if (profile == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Record all dives in chronological order. Older dives are
+	// overwritten once the ringbuffers are full.
+	unsigned int rb_logbook = dctool_emulator_rb_start (RB_LOGBOOK_BEGIN, RB_LOGBOOK_END,
+		config->ndives * RB_LOGBOOK_SIZE, RB_LOGBOOK_SIZE, config->wrap);
+	unsigned int rb_profile = dctool_emulator_rb_start (RB_PROFILE_BEGIN, RB_PROFILE_END,
+		config->ndives * size, PAGESIZE, config->wrap);
+	unsigned int rb_logbook_first = rb_logbook;
+	unsigned int rb_logbook_last = rb_logbook;
+	for (unsigned int i = 0; i < config->ndives; ++i) {
+		for (unsigned int j = 0; j < size; ++j)
+			profile[j] = (i + j) & 0x7F;
+
+		unsigned int first = rb_profile;
+		rb_profile = dctool_emulator_rb_write (memory, RB_PROFILE_BEGIN, RB_PROFILE_END, rb_profile, profile, size);
+		unsigned int last = (rb_profile == RB_PROFILE_BEGIN ? RB_PROFILE_END : rb_profile) - PAGESIZE;
+
+		dc_datetime_t dt;
+		dctool_emulator_datetime (i, &dt);
+
+		unsigned char entry[RB_LOGBOOK_SIZE] = {0};
+		entry[0] = (i + 1) & 0xFF;
+		entry[1] = ((i + 1) >> 8) & 0xFF;
+		entry[2] = dt.minute;
+		entry[3] = dt.hour;
+		entry[4] = (first / PAGESIZE) & 0xFF;
+		entry[5] = ((first / PAGESIZE) >> 8) & 0xFF;
+		entry[6] = (last / PAGESIZE) & 0xFF;
+		entry[7] = ((last / PAGESIZE) >> 8) & 0xFF;
+		entry[8] = dt.day;
+		entry[9] = dt.month;
+		entry[10] = dt.year % 100;
+
+		rb_logbook_last = rb_logbook;
+		rb_logbook = dctool_emulator_rb_write (memory, RB_LOGBOOK_BEGIN, RB_LOGBOOK_END, rb_logbook, entry, sizeof (entry));
+
+		// Once the logbook is full, the oldest entry is the one
+		// immediately after the most recent entry.
+		if ((i + 1) * RB_LOGBOOK_SIZE >= RB_LOGBOOK_END - RB_LOGBOOK_BEGIN)
+			rb_logbook_first = rb_logbook;
+	}
+
+	free (profile);
+
+	// Logbook pointers.
+	unsigned char *pointers = memory + CF_POINTERS;
+	memset (pointers, 0x00, PAGESIZE);
+	if (config->ndives) {
+		pointers[4] = rb_logbook_first & 0xFF;
+		pointers[5] = (rb_logbook_first >> 8) & 0xFF;
+		pointers[6] = rb_logbook_last & 0xFF;
+		pointers[7] = (rb_logbook_last >> 8) & 0xFF;
+	} else {
+		// An empty logbook has identical first/last pointers and
+		// uninitialized logbook entries.
+		pointers[4] = pointers[6] = RB_LOGBOOK_BEGIN & 0xFF;
+		pointers[5] = pointers[7] = (RB_LOGBOOK_BEGIN >> 8) & 0xFF;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+oceanic_atom2_emulator_answer (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size, unsigned int crc_size)
+{
+	unsigned char ack[1] = {ACK};
+	dc_status_t rc = dctool_emulator_reply (abstract, ack, sizeof (ack));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	rc = dctool_emulator_reply (abstract, data, size);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	unsigned int crc = 0;
+	for (unsigned int i = 0; i < size; ++i)
+		crc += data[i];
+
+	unsigned char checksum[2] = {crc & 0xFF, (crc >> 8) & 0xFF};
+	return dctool_emulator_reply (abstract, checksum, crc_size);
+}
+
+static unsigned int
+oceanic_atom2_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	oceanic_atom2_emulator_t *emulator = (oceanic_atom2_emulator_t *) abstract;
+	const unsigned char ack[1] = {ACK};
+	const unsigned char nak[1] = {NAK};
+
+	// Wait for a complete command.
+	unsigned int csize = (data[0] == CMD_VERSION ? 2 : 4);
+	if (size < csize)
+		return 0;
+
+	unsigned int npages = 0, crc_size = 1;
+	switch (data[0]) {
+	case CMD_VERSION:
+		oceanic_atom2_emulator_answer (abstract, version, sizeof (version), 1);
+		break;
+	case CMD_READ1:
+	case CMD_READ8:
+	case CMD_READ16:
+		if (data[0] == CMD_READ1) {
+			npages = 1;
+		} else if (data[0] == CMD_READ8) {
+			npages = 8;
+		} else {
+			npages = 16;
+			crc_size = 2;
+		}
+		unsigned int address = ((data[1] << 8) | data[2]) * PAGESIZE;
+		if (address % (npages * PAGESIZE) != 0 ||
+			address + npages * PAGESIZE > sizeof (emulator->memory)) {
+			dctool_emulator_reply (abstract, nak, sizeof (nak));
+			break;
+		}
+		oceanic_atom2_emulator_answer (abstract, emulator->memory + address, npages * PAGESIZE, crc_size);
+		break;
+	case CMD_KEEPALIVE:
+		dctool_emulator_reply (abstract, ack, sizeof (ack));
+		break;
+	case CMD_INIT:
+	case CMD_QUIT:
+	default:
+		dctool_emulator_reply (abstract, nak, sizeof (nak));
+		break;
+	}
+
+	return csize;
+}
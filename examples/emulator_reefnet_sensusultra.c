@@ -0,0 +1,260 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define SZ_PACKET    512
+#define SZ_MEMORY    2080768
+#define SZ_HANDSHAKE 24
+#define SZ_HEADER    16
+#define SZ_SAMPLE    4
+
+#define PROMPT 0xA5
+#define ACCEPT PROMPT
+#define REJECT 0x00
+
+#define CMD_DATA 0xB421
+
+#define STATE_IDLE  0
+#define STATE_LSB   1
+#define STATE_MSB   2
+#define STATE_PAGE  3
+
+// The dive timestamps are in seconds, relative to an arbitrary device
+// epoch. A new dive every six hours, like the other emulators.
+#define TIMESTAMP 1000000
+#define INTERVAL  (6 * 3600)
+
+typedef struct reefnet_sensusultra_emulator_t {
+	dctool_emulator_t base;
+	unsigned char *memory;
+	unsigned int devtime;
+	unsigned int state;
+	unsigned int lsb;
+	unsigned int page;
+} reefnet_sensusultra_emulator_t;
+
+static dc_status_t reefnet_sensusultra_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static dc_status_t reefnet_sensusultra_emulator_reset (dctool_emulator_t *abstract);
+static unsigned int reefnet_sensusultra_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+static dc_status_t reefnet_sensusultra_emulator_idle (dctool_emulator_t *abstract);
+static dc_status_t reefnet_sensusultra_emulator_free (dctool_emulator_t *abstract);
+
+const dctool_emulator_vtable_t dctool_reefnet_sensusultra_emulator = {
+	sizeof(reefnet_sensusultra_emulator_t), /* size */
+	DC_FAMILY_REEFNET_SENSUSULTRA, /* type */
+	reefnet_sensusultra_emulator_init, /* init */
+	reefnet_sensusultra_emulator_reset, /* reset */
+	reefnet_sensusultra_emulator_process, /* process */
+	reefnet_sensusultra_emulator_idle, /* idle */
+	reefnet_sensusultra_emulator_free, /* free */
+};
+
+static unsigned short
+reefnet_sensusultra_emulator_crc (const unsigned char data[], unsigned int size)
+{
+	unsigned short crc = 0xFFFF;
+	for (unsigned int i = 0; i < size; ++i) {
+		crc ^= data[i] << 8;
+		for (unsigned int j = 0; j < 8; ++j) {
+			if (crc & 0x8000)
+				crc = (crc << 1) ^ 0x1021;
+			else
+				crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+static void
+reefnet_sensusultra_emulator_put16 (unsigned char data[], unsigned int value)
+{
+	data[0] = (value     ) & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+}
+
+static void
+reefnet_sensusultra_emulator_put32 (unsigned char data[], unsigned int value)
+{
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+static dc_status_t
+reefnet_sensusultra_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	reefnet_sensusultra_emulator_t *emulator = (reefnet_sensusultra_emulator_t *) abstract;
+
+	emulator->memory = (unsigned char *) malloc (SZ_MEMORY);
+	if (emulator->memory == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Unused memory is erased.
+	memset (emulator->memory, 0xFF, SZ_MEMORY);
+
+	unsigned int nsamples = config->divesize / SZ_SAMPLE;
+	if (nsamples == 0)
+		nsamples = 1;
+	unsigned int divesize = SZ_HEADER + nsamples * SZ_SAMPLE + 4;
+
+	// The device sends the most recent page first. The memory image is
+	// stored in the same order as the dump, oldest dive first, with some
+	// erased space after the most recent dive.
+	unsigned int ndives = config->ndives;
+	unsigned int available = SZ_MEMORY - SZ_PACKET / 2;
+	if (ndives > available / divesize)
+		ndives = available / divesize;
+
+	unsigned int offset = available - ndives * divesize;
+	for (unsigned int i = 0; i < ndives; ++i) {
+		unsigned char *dive = emulator->memory + offset;
+
+		// Header, with a 10 second sample interval and a 1.1 bar
+		// threshold.
+		memset (dive, 0x00, 4);
+		reefnet_sensusultra_emulator_put32 (dive + 4, TIMESTAMP + i * INTERVAL);
+		reefnet_sensusultra_emulator_put16 (dive + 8, 10);
+		reefnet_sensusultra_emulator_put16 (dive + 10, 1100);
+		reefnet_sensusultra_emulator_put32 (dive + 12, 0x01010101);
+
+		// A flat profile at 10m (2 bar) and 20°C.
+		for (unsigned int j = 0; j < nsamples; ++j) {
+			unsigned char *sample = dive + SZ_HEADER + j * SZ_SAMPLE;
+			reefnet_sensusultra_emulator_put16 (sample + 0, 29315);
+			reefnet_sensusultra_emulator_put16 (sample + 2, 2000 + (j % 16));
+		}
+
+		// Footer.
+		memset (dive + divesize - 4, 0xFF, 4);
+
+		offset += divesize;
+	}
+
+	// The device clock is one hour past the most recent dive.
+	emulator->devtime = TIMESTAMP + ndives * INTERVAL + 3600;
+	emulator->state = STATE_IDLE;
+	emulator->lsb = 0;
+	emulator->page = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+reefnet_sensusultra_emulator_reset (dctool_emulator_t *abstract)
+{
+	reefnet_sensusultra_emulator_t *emulator = (reefnet_sensusultra_emulator_t *) abstract;
+
+	emulator->state = STATE_IDLE;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static void
+reefnet_sensusultra_emulator_page (reefnet_sensusultra_emulator_t *emulator)
+{
+	unsigned char packet[SZ_PACKET + 4];
+
+	unsigned int offset = SZ_MEMORY - (emulator->page + 1) * SZ_PACKET;
+	reefnet_sensusultra_emulator_put16 (packet, emulator->page);
+	memcpy (packet + 2, emulator->memory + offset, SZ_PACKET);
+	reefnet_sensusultra_emulator_put16 (packet + SZ_PACKET + 2,
+		reefnet_sensusultra_emulator_crc (packet + 2, SZ_PACKET));
+
+	unsigned char prompt = PROMPT;
+	dctool_emulator_reply (&emulator->base, packet, sizeof (packet));
+	dctool_emulator_reply (&emulator->base, &prompt, 1);
+}
+
+static dc_status_t
+reefnet_sensusultra_emulator_idle (dctool_emulator_t *abstract)
+{
+	reefnet_sensusultra_emulator_t *emulator = (reefnet_sensusultra_emulator_t *) abstract;
+
+	// A device that is not busy with a command (or gave up waiting for
+	// the host) keeps sending the handshake packet, followed by the
+	// prompt for the instruction code.
+	unsigned char handshake[SZ_HANDSHAKE + 3] = {0};
+	handshake[0] = 0x10; // Firmware
+	handshake[1] = 0x03; // Model
+	reefnet_sensusultra_emulator_put16 (handshake + 2, 1234);
+	reefnet_sensusultra_emulator_put32 (handshake + 4, emulator->devtime);
+	reefnet_sensusultra_emulator_put16 (handshake + SZ_HANDSHAKE,
+		reefnet_sensusultra_emulator_crc (handshake, SZ_HANDSHAKE));
+	handshake[SZ_HANDSHAKE + 2] = PROMPT;
+
+	emulator->state = STATE_LSB;
+
+	return dctool_emulator_reply (abstract, handshake, sizeof (handshake));
+}
+
+static unsigned int
+reefnet_sensusultra_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	reefnet_sensusultra_emulator_t *emulator = (reefnet_sensusultra_emulator_t *) abstract;
+	unsigned char prompt = PROMPT;
+
+	switch (emulator->state) {
+	case STATE_LSB:
+		emulator->lsb = data[0];
+		emulator->state = STATE_MSB;
+		dctool_emulator_reply (abstract, &prompt, 1);
+		break;
+	case STATE_MSB:
+		if ((emulator->lsb | (data[0] << 8)) == CMD_DATA) {
+			emulator->page = 0;
+			emulator->state = STATE_PAGE;
+			reefnet_sensusultra_emulator_page (emulator);
+		} else {
+			// Unsupported commands are silently ignored.
+			emulator->state = STATE_IDLE;
+		}
+		break;
+	case STATE_PAGE:
+		// A rejected page is sent again.
+		if (data[0] == ACCEPT)
+			emulator->page++;
+		if (emulator->page < SZ_MEMORY / SZ_PACKET) {
+			reefnet_sensusultra_emulator_page (emulator);
+		} else {
+			emulator->state = STATE_IDLE;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return 1;
+}
+
+static dc_status_t
+reefnet_sensusultra_emulator_free (dctool_emulator_t *abstract)
+{
+	reefnet_sensusultra_emulator_t *emulator = (reefnet_sensusultra_emulator_t *) abstract;
+
+	free (emulator->memory);
+
+	return DC_STATUS_SUCCESS;
+}
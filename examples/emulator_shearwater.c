@@ -0,0 +1,589 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define END     0xC0
+#define ESC     0xDB
+#define ESC_END 0xDC
+#define ESC_ESC 0xDD
+
+#define SZ_PACKET  254
+#define SZ_BLOCK   0x80
+#define SZ_CHUNK   243 // Multiple of 9 bytes for the compressed data.
+
+#define ID_SERIAL   0x8010
+#define ID_FIRMWARE 0x8011
+
+#define PREDATOR 2
+
+// Predator
+#define MEMORY_ADDR 0xDD000000
+#define SZ_MEMORY   0x20080
+#define RB_PROFILE_BEGIN 0
+#define RB_PROFILE_END   0x1F600
+#define SZ_SAMPLE_PREDATOR 0x10
+
+// Petrel
+#define MANIFEST_ADDR 0xE0000000
+#define MANIFEST_SIZE 0x600
+#define DIVE_ADDR     0xC0000000
+#define RECORD_SIZE   0x20
+#define RECORD_COUNT  (MANIFEST_SIZE / RECORD_SIZE)
+#define SZ_LOG        0x400000
+#define SZ_SAMPLE_PETREL 0x20
+
+typedef struct shearwater_dive_t {
+	unsigned int number;
+	unsigned int address;
+	unsigned int size;
+} shearwater_dive_t;
+
+typedef struct shearwater_emulator_t {
+	dctool_emulator_t base;
+	unsigned int petrel;
+	unsigned char *memory;
+	unsigned int memsize;
+	/* Petrel dives (most recent first) */
+	shearwater_dive_t *dives;
+	unsigned int ndives;
+	unsigned int manifest;
+	unsigned int rewind;
+	/* Active download */
+	dc_buffer_t *transfer;
+	unsigned int offset;
+} shearwater_emulator_t;
+
+static dc_status_t shearwater_predator_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static dc_status_t shearwater_petrel_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static dc_status_t shearwater_emulator_reset (dctool_emulator_t *abstract);
+static unsigned int shearwater_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+static dc_status_t shearwater_emulator_free (dctool_emulator_t *abstract);
+
+const dctool_emulator_vtable_t dctool_shearwater_predator_emulator = {
+	sizeof(shearwater_emulator_t), /* size */
+	DC_FAMILY_SHEARWATER_PREDATOR, /* type */
+	shearwater_predator_emulator_init, /* init */
+	shearwater_emulator_reset, /* reset */
+	shearwater_emulator_process, /* process */
+	NULL, /* idle */
+	shearwater_emulator_free, /* free */
+};
+
+const dctool_emulator_vtable_t dctool_shearwater_petrel_emulator = {
+	sizeof(shearwater_emulator_t), /* size */
+	DC_FAMILY_SHEARWATER_PETREL, /* type */
+	shearwater_petrel_emulator_init, /* init */
+	shearwater_emulator_reset, /* reset */
+	shearwater_emulator_process, /* process */
+	NULL, /* idle */
+	shearwater_emulator_free, /* free */
+};
+
+static void
+uint16_be_set (unsigned char data[], unsigned int value)
+{
+	data[0] = (value >> 8) & 0xFF;
+	data[1] = (value     ) & 0xFF;
+}
+
+static void
+uint32_be_set (unsigned char data[], unsigned int value)
+{
+	data[0] = (value >> 24) & 0xFF;
+	data[1] = (value >> 16) & 0xFF;
+	data[2] = (value >>  8) & 0xFF;
+	data[3] = (value      ) & 0xFF;
+}
+
+static dc_status_t
+shearwater_emulator_setup (shearwater_emulator_t *emulator, unsigned int petrel, unsigned int memsize)
+{
+	emulator->petrel = petrel;
+	emulator->dives = NULL;
+	emulator->ndives = 0;
+	emulator->manifest = 0;
+	emulator->rewind = 0;
+	emulator->offset = 0;
+	emulator->memsize = memsize;
+	emulator->memory = (unsigned char *) malloc (memsize);
+	emulator->transfer = dc_buffer_new (0);
+	if (emulator->memory == NULL || emulator->transfer == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Erased flash memory.
+	memset (emulator->memory, 0xFF, memsize);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static unsigned int
+shearwater_emulator_divesize (const dctool_emulator_config_t *config, unsigned int samplesize, unsigned int *nsamples)
+{
+	// A dive consists of an opening block, the samples (padded to
+	// the block size), and a closing block.
+	unsigned int n = 1;
+	if (config->divesize > 2 * SZ_BLOCK + samplesize)
+		n = (config->divesize - 2 * SZ_BLOCK) / samplesize;
+
+	*nsamples = n;
+
+	return 2 * SZ_BLOCK + (n * samplesize + SZ_BLOCK - 1) / SZ_BLOCK * SZ_BLOCK;
+}
+
+static void
+shearwater_emulator_dive (unsigned char data[], unsigned int size, unsigned int number, unsigned int nsamples, unsigned int samplesize)
+{
+	memset (data, 0x00, size);
+
+	// Opening block.
+	data[0] = 0xFF;
+	data[1] = 0xFF;
+	uint16_be_set (data + 2, number + 1);
+	uint32_be_set (data + 12, dctool_emulator_ticks (number));
+
+	// Samples.
+	unsigned int maxdepth = 0;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		unsigned char *sample = data + SZ_BLOCK + i * samplesize;
+		unsigned int depth = 10 + ((number + i) % 64) * 5; // 1/10 m
+		if (depth > maxdepth)
+			maxdepth = depth;
+		uint16_be_set (sample + 0, depth);
+		sample[7] = 21;   // Oxygen
+		sample[8] = 0;    // Helium
+		sample[11] = 0x10; // Open circuit
+	}
+
+	// Closing block.
+	unsigned char *footer = data + size - SZ_BLOCK;
+	footer[0] = 0xFF;
+	footer[1] = 0xFE;
+	uint16_be_set (footer + 2, number + 1);
+	uint16_be_set (footer + 4, maxdepth / 10);
+	uint16_be_set (footer + 6, (nsamples * 10 + 59) / 60);
+}
+
+static dc_status_t
+shearwater_predator_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	shearwater_emulator_t *emulator = (shearwater_emulator_t *) abstract;
+
+	dc_status_t rc = shearwater_emulator_setup (emulator, 0, SZ_MEMORY);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	unsigned int nsamples = 0;
+	unsigned int size = shearwater_emulator_divesize (config, SZ_SAMPLE_PREDATOR, &nsamples);
+	if (size > RB_PROFILE_END - RB_PROFILE_BEGIN - SZ_BLOCK) {
+		size = RB_PROFILE_END - RB_PROFILE_BEGIN - SZ_BLOCK;
+		nsamples = (size - 2 * SZ_BLOCK) / SZ_SAMPLE_PREDATOR;
+	}
+
+	unsigned char *dive = (unsigned char *) malloc (size);
+	if (dive == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Record all dives in chronological order. Older dives are
+	// overwritten once the ringbuffer is full.
+	unsigned int address = dctool_emulator_rb_start (RB_PROFILE_BEGIN, RB_PROFILE_END,
+		config->ndives * size, SZ_BLOCK, config->wrap);
+	for (unsigned int i = 0; i < config->ndives; ++i) {
+		shearwater_emulator_dive (dive, size, i, nsamples, SZ_SAMPLE_PREDATOR);
+		address = dctool_emulator_rb_write (emulator->memory, RB_PROFILE_BEGIN, RB_PROFILE_END, address, dive, size);
+	}
+
+	// Erase the remains of the partially overwritten dive, but always keep
+	// at least one empty block to separate the oldest and newest dive.
+	unsigned int count = 0, total = 0;
+	while (count < config->ndives && total + size + SZ_BLOCK <= RB_PROFILE_END - RB_PROFILE_BEGIN) {
+		total += size;
+		count++;
+	}
+	unsigned int n = RB_PROFILE_END - RB_PROFILE_BEGIN - total;
+	for (unsigned int i = 0; i < n; i += SZ_BLOCK) {
+		memset (dive, 0xFF, SZ_BLOCK);
+		address = dctool_emulator_rb_write (emulator->memory, RB_PROFILE_BEGIN, RB_PROFILE_END, address, dive, SZ_BLOCK);
+	}
+
+	free (dive);
+
+	// Final block.
+	unsigned char *final = emulator->memory + SZ_MEMORY - SZ_BLOCK;
+	memset (final, 0x00, SZ_BLOCK);
+	final[0] = 0xFF;
+	final[1] = 0xFD;
+	final[0x0D] = PREDATOR;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+shearwater_petrel_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	shearwater_emulator_t *emulator = (shearwater_emulator_t *) abstract;
+
+	dc_status_t rc = shearwater_emulator_setup (emulator, 1, SZ_LOG);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Optionally reset the manifest cursor after each dive download.
+	emulator->rewind = config->rewind;
+
+	// The Petrel dives include the final block.
+	unsigned int nsamples = 0;
+	unsigned int size = shearwater_emulator_divesize (config, SZ_SAMPLE_PETREL, &nsamples) + SZ_BLOCK;
+	if (size > SZ_LOG) {
+		size = SZ_LOG;
+		nsamples = (size - 3 * SZ_BLOCK) / SZ_SAMPLE_PETREL;
+	}
+
+	// Only the most recent dives are still available.
+	unsigned int count = config->ndives;
+	if (count > SZ_LOG / size)
+		count = SZ_LOG / size;
+
+	unsigned char *dive = (unsigned char *) malloc (size);
+	emulator->dives = (shearwater_dive_t *) malloc ((count + 1) * sizeof (shearwater_dive_t));
+	if (dive == NULL || emulator->dives == NULL) {
+		free (dive);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Record all dives in chronological order. Older dives are
+	// overwritten once the ringbuffer is full.
+	unsigned int address = dctool_emulator_rb_start (0, SZ_LOG, config->ndives * size, SZ_BLOCK, config->wrap);
+	for (unsigned int i = 0; i < config->ndives; ++i) {
+		shearwater_emulator_dive (dive, size - SZ_BLOCK, i, nsamples, SZ_SAMPLE_PETREL);
+
+		// Final block.
+		unsigned char *final = dive + size - SZ_BLOCK;
+		memset (final, 0x00, SZ_BLOCK);
+		final[0] = 0xFF;
+		final[1] = 0xFD;
+
+		unsigned int idx = config->ndives - 1 - i;
+		if (idx < count) {
+			emulator->dives[idx].number = i;
+			emulator->dives[idx].address = address;
+			emulator->dives[idx].size = size;
+		}
+
+		address = dctool_emulator_rb_write (emulator->memory, 0, SZ_LOG, address, dive, size);
+	}
+
+	emulator->ndives = count;
+
+	free (dive);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+shearwater_emulator_reset (dctool_emulator_t *abstract)
+{
+	shearwater_emulator_t *emulator = (shearwater_emulator_t *) abstract;
+
+	emulator->manifest = 0;
+	emulator->offset = 0;
+	dc_buffer_clear (emulator->transfer);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+shearwater_emulator_free (dctool_emulator_t *abstract)
+{
+	shearwater_emulator_t *emulator = (shearwater_emulator_t *) abstract;
+
+	dc_buffer_free (emulator->transfer);
+	free (emulator->dives);
+	free (emulator->memory);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static void
+shearwater_emulator_slip_write (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	const unsigned char end[] = {END};
+	const unsigned char esc_end[] = {ESC, ESC_END};
+	const unsigned char esc_esc[] = {ESC, ESC_ESC};
+
+	for (unsigned int i = 0; i < size; ++i) {
+		if (data[i] == END)
+			dctool_emulator_reply (abstract, esc_end, sizeof (esc_end));
+		else if (data[i] == ESC)
+			dctool_emulator_reply (abstract, esc_esc, sizeof (esc_esc));
+		else
+			dctool_emulator_reply (abstract, data + i, 1);
+	}
+
+	dctool_emulator_reply (abstract, end, sizeof (end));
+}
+
+static void
+shearwater_emulator_send (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	unsigned char packet[SZ_PACKET + 4];
+
+	packet[0] = 0x01;
+	packet[1] = 0xFF;
+	packet[2] = size + 1;
+	packet[3] = 0x00;
+	memcpy (packet + 4, data, size);
+
+	shearwater_emulator_slip_write (abstract, packet, size + 4);
+}
+
+static int
+shearwater_emulator_compress (dc_buffer_t *buffer, const unsigned char data[], unsigned int size)
+{
+	unsigned int value = 0, nbits = 0;
+	unsigned int offset = 0;
+
+	// Each block of 32 bytes is XOR'ed with the previous (uncompressed)
+	// block, and the result is encoded as a stream of 9 bit values
+	// containing either a literal byte or a run of zero bytes.
+	while (1) {
+		unsigned int code = 0;
+		if (offset < size) {
+			unsigned char c = data[offset] ^ (offset >= 32 ? data[offset - 32] : 0);
+			if (c) {
+				code = 0x100 | c;
+				offset++;
+			} else {
+				unsigned int run = 0;
+				while (offset < size && run < 0xFF &&
+					(data[offset] ^ (offset >= 32 ? data[offset - 32] : 0)) == 0) {
+					offset++;
+					run++;
+				}
+				code = run;
+			}
+		}
+
+		value = (value << 9) | code;
+		nbits += 9;
+		while (nbits >= 8) {
+			unsigned char c = (value >> (nbits - 8)) & 0xFF;
+			if (!dc_buffer_append (buffer, &c, 1))
+				return -1;
+			nbits -= 8;
+		}
+		value &= (1 << nbits) - 1;
+
+		// A zero-length run marks the end of the stream.
+		if (code == 0)
+			break;
+	}
+
+	// Flush the remaining bits, and pad the stream to a multiple of 9 bytes,
+	// such that every chunk contains an integer number of 9 bit values.
+	if (nbits) {
+		unsigned char c = (value << (8 - nbits)) & 0xFF;
+		if (!dc_buffer_append (buffer, &c, 1))
+			return -1;
+	}
+	while (dc_buffer_get_size (buffer) % 9 != 0) {
+		unsigned char c = 0;
+		if (!dc_buffer_append (buffer, &c, 1))
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+shearwater_emulator_download (shearwater_emulator_t *emulator, unsigned int address, unsigned int size, unsigned int compression)
+{
+	dc_buffer_t *source = dc_buffer_new (0);
+	if (source == NULL)
+		return -1;
+
+	if (!emulator->petrel && address == MEMORY_ADDR) {
+		// Memory dump.
+		if (size > emulator->memsize)
+			size = emulator->memsize;
+		dc_buffer_append (source, emulator->memory, size);
+	} else if (emulator->petrel && address == MANIFEST_ADDR) {
+		// Each manifest download returns the next set of records.
+		unsigned char record[RECORD_SIZE];
+		for (unsigned int i = 0; i < RECORD_COUNT; ++i) {
+			unsigned int idx = emulator->manifest + i;
+			memset (record, 0x00, sizeof (record));
+			if (idx < emulator->ndives) {
+				uint16_be_set (record + 0, 0xA5C4);
+				uint32_be_set (record + 4, dctool_emulator_ticks (emulator->dives[idx].number));
+				uint32_be_set (record + 20, emulator->dives[idx].address);
+			}
+			dc_buffer_append (source, record, sizeof (record));
+		}
+		emulator->manifest += RECORD_COUNT;
+	} else if (emulator->petrel && address >= DIVE_ADDR && address < MANIFEST_ADDR) {
+		// Dive data.
+		unsigned int idx = 0;
+		while (idx < emulator->ndives && emulator->dives[idx].address != address - DIVE_ADDR)
+			idx++;
+		if (idx == emulator->ndives) {
+			dc_buffer_free (source);
+			return -1;
+		}
+		unsigned int length = emulator->dives[idx].size;
+		if (length > size)
+			length = size;
+		if (!dc_buffer_resize (source, length)) {
+			dc_buffer_free (source);
+			return -1;
+		}
+		dctool_emulator_rb_read (emulator->memory, 0, emulator->memsize,
+			emulator->dives[idx].address, dc_buffer_get_data (source), length);
+		if (emulator->rewind)
+			emulator->manifest = 0;
+	} else {
+		dc_buffer_free (source);
+		return -1;
+	}
+
+	dc_buffer_clear (emulator->transfer);
+	emulator->offset = 0;
+
+	int rc = 0;
+	if (compression) {
+		rc = shearwater_emulator_compress (emulator->transfer,
+			dc_buffer_get_data (source), dc_buffer_get_size (source));
+	} else {
+		if (!dc_buffer_append (emulator->transfer,
+			dc_buffer_get_data (source), dc_buffer_get_size (source)))
+			rc = -1;
+	}
+
+	dc_buffer_free (source);
+
+	return rc;
+}
+
+static void
+shearwater_emulator_request (shearwater_emulator_t *emulator, const unsigned char data[], unsigned int size)
+{
+	dctool_emulator_t *abstract = (dctool_emulator_t *) emulator;
+	unsigned char response[SZ_PACKET];
+
+	if (size == 0)
+		return;
+
+	switch (data[0]) {
+	case 0x22: // Identifier
+		if (size == 3) {
+			unsigned int id = (data[1] << 8) | data[2];
+			const char *value = "";
+			if (id == ID_SERIAL)
+				value = "12345678";
+			else if (id == ID_FIRMWARE)
+				value = "V44";
+			response[0] = 0x62;
+			response[1] = data[1];
+			response[2] = data[2];
+			memcpy (response + 3, value, strlen (value));
+			shearwater_emulator_send (abstract, response, 3 + strlen (value));
+		}
+		break;
+	case 0x35: // Download init
+		if (size == 10) {
+			unsigned int address = ((unsigned int) data[3] << 24) | (data[4] << 16) | (data[5] << 8) | data[6];
+			unsigned int length = (data[7] << 16) | (data[8] << 8) | data[9];
+			if (shearwater_emulator_download (emulator, address, length, data[1] & 0x10) != 0) {
+				const unsigned char nak[] = {0x7F, 0x35, 0x00};
+				shearwater_emulator_send (abstract, nak, sizeof (nak));
+				break;
+			}
+			const unsigned char ack[] = {0x75, 0x10, SZ_CHUNK};
+			shearwater_emulator_send (abstract, ack, sizeof (ack));
+		}
+		break;
+	case 0x36: // Download block
+		if (size == 2) {
+			unsigned int available = dc_buffer_get_size (emulator->transfer) - emulator->offset;
+			if (available == 0) {
+				const unsigned char nak[] = {0x7F, 0x36, 0x00};
+				shearwater_emulator_send (abstract, nak, sizeof (nak));
+				break;
+			}
+			unsigned int len = (available < SZ_CHUNK ? available : SZ_CHUNK);
+			response[0] = 0x76;
+			response[1] = data[1];
+			memcpy (response + 2, dc_buffer_get_data (emulator->transfer) + emulator->offset, len);
+			emulator->offset += len;
+			shearwater_emulator_send (abstract, response, len + 2);
+		}
+		break;
+	case 0x37: // Download quit
+		dc_buffer_clear (emulator->transfer);
+		emulator->offset = 0;
+		response[0] = 0x77;
+		response[1] = 0x00;
+		shearwater_emulator_send (abstract, response, 2);
+		break;
+	default:
+		break;
+	}
+}
+
+static unsigned int
+shearwater_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	shearwater_emulator_t *emulator = (shearwater_emulator_t *) abstract;
+	unsigned char packet[SZ_PACKET + 4];
+	unsigned int n = 0;
+
+	// Wait for a complete packet.
+	const unsigned char *end = (const unsigned char *) memchr (data, END, size);
+	if (end == NULL)
+		return 0;
+
+	// Decode the packet.
+	unsigned int length = end - data;
+	for (unsigned int i = 0; i < length; ++i) {
+		unsigned char c = data[i];
+		if (c == ESC && i + 1 < length) {
+			c = data[++i];
+			if (c == ESC_END)
+				c = END;
+			else if (c == ESC_ESC)
+				c = ESC;
+		}
+		if (n < sizeof (packet))
+			packet[n] = c;
+		n++;
+	}
+
+	// Validate the request packet.
+	if (n >= 4 && n <= sizeof (packet) &&
+		packet[0] == 0xFF && packet[1] == 0x01 &&
+		packet[3] == 0x00 && packet[2] == n - 3) {
+		shearwater_emulator_request (emulator, packet + 4, n - 4);
+	}
+
+	return length + 1;
+}
@@ -0,0 +1,393 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "emulator-private.h"
+
+#define D4       0x12
+#define HELO2    0x15
+#define D4i      0x19
+#define D6i      0x1A
+#define D9tx     0x1B
+#define DX       0x1C
+#define VYPERNOVO 0x1D
+#define ZOOPNOVO  0x1E
+
+#define SZ_VERSION    0x04
+#define SZ_MEMORY     0x10000
+#define SZ_PACKET     0x78
+
+#define CMD_READ       0x05
+#define CMD_VERSION    0x0F
+#define CMD_RESET      0x20
+
+#define HEADER 0x0190
+
+#define AIR      0
+#define NPARAMS  3
+#define SZ_SAMPLE 5
+#define INTERVAL 10
+
+typedef struct suunto_d9_layout_t {
+	unsigned int memsize;
+	unsigned int fingerprint;
+	unsigned int serial;
+	unsigned int rb_profile_begin;
+	unsigned int rb_profile_end;
+} suunto_d9_layout_t;
+
+typedef struct suunto_d9_emulator_t {
+	dctool_emulator_t base;
+	const suunto_d9_layout_t *layout;
+	unsigned char version[SZ_VERSION];
+	unsigned char memory[SZ_MEMORY];
+} suunto_d9_emulator_t;
+
+static dc_status_t suunto_d9_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config);
+static unsigned int suunto_d9_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size);
+
+const dctool_emulator_vtable_t dctool_suunto_d9_emulator = {
+	sizeof(suunto_d9_emulator_t), /* size */
+	DC_FAMILY_SUUNTO_D9, /* type */
+	suunto_d9_emulator_init, /* init */
+	NULL, /* reset */
+	suunto_d9_emulator_process, /* process */
+	NULL, /* idle */
+	NULL, /* free */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout = {
+	0x8000, /* memsize */
+	0x0011, /* fingerprint */
+	0x0023, /* serial */
+	0x019A, /* rb_profile_begin */
+	0x7FFE /* rb_profile_end */
+};
+
+static const suunto_d9_layout_t suunto_d9tx_layout = {
+	0x10000, /* memsize */
+	0x0013, /* fingerprint */
+	0x0024, /* serial */
+	0x019A, /* rb_profile_begin */
+	0xEBF0 /* rb_profile_end */
+};
+
+static const suunto_d9_layout_t suunto_dx_layout = {
+	0x10000, /* memsize */
+	0x0017, /* fingerprint */
+	0x0024, /* serial */
+	0x019A, /* rb_profile_begin */
+	0xEBF0 /* rb_profile_end */
+};
+
+static void
+uint16_le_set (unsigned char data[], unsigned int value)
+{
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+}
+
+static unsigned int
+suunto_d9_emulator_config (unsigned int model)
+{
+	// Offset to the sample configuration, which follows the gas mixes
+	// on the newer models. The logbook id tag is left zero, which
+	// selects the first firmware variant in the parser.
+	switch (model) {
+	case D4:
+		return 0x3B;
+	case HELO2:
+		return 0x54 + 8 * 6;
+	case D4i:
+	case ZOOPNOVO:
+		return 0x5F + 1 * 6;
+	case D6i:
+	case VYPERNOVO:
+		return 0x5F + 2 * 6;
+	case D9tx:
+		return 0x87 + 8 * 6;
+	case DX:
+		return 0xC1 + 11 * 6;
+	default:
+		return 0x3A;
+	}
+}
+
+static unsigned int
+suunto_d9_emulator_divesize (unsigned int model, const dctool_emulator_config_t *config, unsigned int *nsamples)
+{
+	// A dive consists of the header, the sample configuration, the
+	// profile header and the samples.
+	unsigned int profile = suunto_d9_emulator_config (model) + 2 + NPARAMS * 3 + 5;
+
+	unsigned int n = 1;
+	if (config->divesize > profile + SZ_SAMPLE)
+		n = (config->divesize - profile) / SZ_SAMPLE;
+
+	*nsamples = n;
+
+	return profile + n * SZ_SAMPLE;
+}
+
+static void
+suunto_d9_emulator_dive (unsigned int model, const suunto_d9_layout_t *layout, unsigned char data[], unsigned int size, unsigned int number, unsigned int nsamples)
+{
+	int newformat = (layout != &suunto_d9_layout);
+
+	unsigned int gasmode = 0x19, interval = 0x18;
+	if (model == HELO2) {
+		gasmode = 0x1F;
+		interval = 0x1E;
+	} else if (model == DX) {
+		gasmode = 0x21;
+		interval = 0x22;
+	} else if (newformat) {
+		gasmode = 0x1D;
+		interval = 0x1E;
+	}
+
+	memset (data, 0x00, size);
+
+	// Date/time fingerprint.
+	dc_datetime_t dt;
+	dctool_emulator_datetime (number, &dt);
+	unsigned char *p = data + layout->fingerprint;
+	if (newformat) {
+		uint16_le_set (p, dt.year);
+		p[2] = dt.month;
+		p[3] = dt.day;
+		p[4] = dt.hour;
+		p[5] = dt.minute;
+		p[6] = dt.second;
+	} else {
+		p[0] = dt.hour;
+		p[1] = dt.minute;
+		p[2] = dt.second;
+		uint16_le_set (p + 3, dt.year);
+		p[5] = dt.month;
+		p[6] = dt.day;
+	}
+
+	data[gasmode] = AIR;
+	data[interval] = INTERVAL;
+
+	// Sample configuration: type, interval and divisor index.
+	unsigned char *cfg = data + suunto_d9_emulator_config (model);
+	cfg[0] = NPARAMS;
+	cfg[2] = 0x64; cfg[3] = 1; cfg[4] = 6 << 2; // Depth (1/100 m)
+	cfg[5] = 0x68; cfg[6] = 1; cfg[7] = 6 << 2; // Pressure (1/100 bar)
+	cfg[8] = 0x74; cfg[9] = 1; cfg[10] = 0;     // Temperature (°C)
+
+	// Profile header without event markers. The leading sequence
+	// indicates the HelO2 extra data block is absent.
+	unsigned char *profile = cfg + 2 + NPARAMS * 3;
+	profile[0] = 0x01;
+
+	// Samples.
+	unsigned int maxdepth = 0;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		unsigned char *sample = profile + 5 + i * SZ_SAMPLE;
+		unsigned int depth = 100 + ((number + i) % 64) * 50;
+		if (depth > maxdepth)
+			maxdepth = depth;
+		uint16_le_set (sample + 0, depth);
+		uint16_le_set (sample + 2, 20000 - (i % 180) * 100);
+		sample[4] = 20 - depth / 500;
+	}
+
+	// Summary.
+	uint16_le_set (data + 0x09, maxdepth);
+	unsigned int divetime = nsamples * INTERVAL;
+	if (model == D4)
+		uint16_le_set (data + 0x0B, divetime);
+	else if (model == HELO2)
+		uint16_le_set (data + 0x0D, (divetime + 59) / 60);
+	else if (newformat)
+		uint16_le_set (data + 0x0D, divetime);
+	else
+		uint16_le_set (data + 0x0B, (divetime + 59) / 60);
+}
+
+static dc_status_t
+suunto_d9_emulator_init (dctool_emulator_t *abstract, unsigned int model, const dctool_emulator_config_t *config)
+{
+	suunto_d9_emulator_t *emulator = (suunto_d9_emulator_t *) abstract;
+	unsigned char *memory = emulator->memory;
+
+	// Select the memory layout for the model.
+	if (model == D4i || model == D6i || model == D9tx ||
+		model == VYPERNOVO || model == ZOOPNOVO) {
+		emulator->layout = &suunto_d9tx_layout;
+	} else if (model == DX) {
+		emulator->layout = &suunto_dx_layout;
+	} else {
+		emulator->layout = &suunto_d9_layout;
+	}
+
+	const suunto_d9_layout_t *layout = emulator->layout;
+	const unsigned int begin = layout->rb_profile_begin;
+	const unsigned int end = layout->rb_profile_end;
+
+	// Version info: model and firmware version.
+	emulator->version[0] = model;
+	emulator->version[1] = 0x01;
+	emulator->version[2] = 0x05;
+	emulator->version[3] = 0x00;
+
+	memset (memory, 0x00, sizeof (emulator->memory));
+
+	// Serial number (base 100 digits).
+	memory[layout->serial + 0] = 12;
+	memory[layout->serial + 1] = 34;
+	memory[layout->serial + 2] = 56;
+	memory[layout->serial + 3] = 78;
+
+	// Each dive is prefixed with the previous/next pointers. A single
+	// dive can never fill the entire ringbuffer.
+	unsigned int nsamples = 0;
+	unsigned int size = suunto_d9_emulator_divesize (model, config, &nsamples);
+	if (size + 4 >= end - begin) {
+		unsigned int profile = suunto_d9_emulator_config (model) + 2 + NPARAMS * 3 + 5;
+		nsamples = (end - begin - 5 - profile) / SZ_SAMPLE;
+		size = profile + nsamples * SZ_SAMPLE;
+	}
+	unsigned int recsize = size + 4;
+
+	unsigned char *record = (unsigned char *) malloc (recsize);
+	unsigned int *starts = (unsigned int *) malloc ((config->ndives + 1) * sizeof (unsigned int));
+	if (record == NULL || starts == NULL) {
+		free (starts);
+		free (record);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Record all dives in chronological order. Older dives are
+	// overwritten once the ringbuffer is full.
+	unsigned int address = dctool_emulator_rb_start (begin, end, config->ndives * recsize, 1, config->wrap);
+	for (unsigned int i = 0; i < config->ndives; ++i) {
+		unsigned int prev = (i ? starts[i - 1] : address);
+		unsigned int next = address + recsize;
+		if (next >= end)
+			next -= end - begin;
+
+		record[0] = prev & 0xFF;
+		record[1] = (prev >> 8) & 0xFF;
+		record[2] = next & 0xFF;
+		record[3] = (next >> 8) & 0xFF;
+		suunto_d9_emulator_dive (model, layout, record + 4, size, i, nsamples);
+
+		starts[i] = address;
+		address = dctool_emulator_rb_write (memory, begin, end, address, record, recsize);
+	}
+
+	// Only the most recent dives that still fit entirely
+	// in the ringbuffer are available.
+	unsigned int count = 0, total = 0;
+	while (count < config->ndives && total + recsize < end - begin) {
+		total += recsize;
+		count++;
+	}
+
+	unsigned int last = (count ? starts[config->ndives - 1] : address);
+	unsigned int first = (count ? starts[config->ndives - count] : address);
+
+	free (starts);
+	free (record);
+
+	// Ringbuffer pointers.
+	unsigned char *header = memory + HEADER;
+	header[0] = last & 0xFF;
+	header[1] = (last >> 8) & 0xFF;
+	header[2] = count & 0xFF;
+	header[3] = (count >> 8) & 0xFF;
+	header[4] = address & 0xFF;
+	header[5] = (address >> 8) & 0xFF;
+	header[6] = first & 0xFF;
+	header[7] = (first >> 8) & 0xFF;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static unsigned int
+suunto_d9_emulator_process (dctool_emulator_t *abstract, const unsigned char data[], unsigned int size)
+{
+	suunto_d9_emulator_t *emulator = (suunto_d9_emulator_t *) abstract;
+	unsigned char answer[SZ_PACKET + 7];
+	unsigned int asize = 0;
+
+	// Wait for a complete command: a three byte header, the
+	// parameters and a one byte checksum.
+	if (size < 3)
+		return 0;
+
+	unsigned int csize = 3 + ((data[1] << 8) | data[2]) + 1;
+	if (size < csize)
+		return 0;
+
+	// Echo the command.
+	dctool_emulator_reply (abstract, data, csize);
+
+	switch (data[0]) {
+	case CMD_VERSION:
+		answer[0] = CMD_VERSION;
+		answer[1] = 0x00;
+		answer[2] = SZ_VERSION;
+		memcpy (answer + 3, emulator->version, SZ_VERSION);
+		asize = SZ_VERSION + 4;
+		break;
+	case CMD_READ:
+		if (csize == 7) {
+			unsigned int address = (data[3] << 8) | data[4];
+			unsigned int len = data[5];
+			if (len > SZ_PACKET || address + len > emulator->layout->memsize)
+				break;
+			answer[0] = CMD_READ;
+			answer[1] = 0x00;
+			answer[2] = len + 3;
+			memcpy (answer + 3, data + 3, 3);
+			memcpy (answer + 6, emulator->memory + address, len);
+			asize = len + 7;
+		}
+		break;
+	case CMD_RESET:
+		answer[0] = CMD_RESET;
+		answer[1] = 0x00;
+		answer[2] = 0x00;
+		asize = 4;
+		break;
+	default:
+		break;
+	}
+
+	// Unsupported commands are silently ignored.
+	if (asize) {
+		unsigned char crc = 0;
+		for (unsigned int i = 0; i < asize - 1; ++i)
+			crc ^= answer[i];
+		answer[asize - 1] = crc;
+
+		dctool_emulator_reply (abstract, answer, asize);
+	}
+
+	return csize;
+}
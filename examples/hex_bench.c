@@ -0,0 +1,140 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark of the hexadecimal codec in src/array.c, against the
+ * original branch chain decoder. The buffer size defaults to the
+ * memory size of the Cressi Leonardo (32KB), and is converted in both
+ * directions, like during a full memory dump.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "array.h"
+
+static int
+reference_hex2bin (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize)
+{
+	if (isize != 2 * osize)
+		return -1;
+
+	for (unsigned int i = 0; i < osize; ++i) {
+		unsigned char value = 0;
+		for (unsigned int j = 0; j < 2; ++j) {
+			unsigned char number = 0;
+			unsigned char ascii = input[i * 2 + j];
+			if (ascii >= '0' && ascii <= '9')
+				number = ascii - '0';
+			else if (ascii >= 'A' && ascii <= 'F')
+				number = 10 + ascii - 'A';
+			else if (ascii >= 'a' && ascii <= 'f')
+				number = 10 + ascii - 'a';
+			else
+				return -1; /* Invalid character */
+
+			value <<= 4;
+			value += number;
+		}
+		output[i] = value;
+	}
+
+	return 0;
+}
+
+static double
+elapsed (clock_t start)
+{
+	return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report (const char *name, double seconds, unsigned int size, unsigned int count)
+{
+	double mbytes = (double) size * count / (1024.0 * 1024.0);
+	printf ("%-24s %8.3fs  %9.1f MB/s\n", name, seconds, seconds > 0 ? mbytes / seconds : 0.0);
+}
+
+int
+main (int argc, char *argv[])
+{
+	unsigned int size = 32 * 1024;
+	unsigned int count = 10000;
+
+	if (argc > 1)
+		size = strtoul (argv[1], NULL, 0);
+	if (argc > 2)
+		count = strtoul (argv[2], NULL, 0);
+	if (size == 0 || count == 0) {
+		printf ("Usage:\n"
+			"   hex_bench [<size> [<count>]]\n");
+		return EXIT_FAILURE;
+	}
+
+	unsigned char *data = (unsigned char *) malloc (size);
+	unsigned char *ascii = (unsigned char *) malloc (2 * size);
+	unsigned char *result = (unsigned char *) malloc (size);
+	if (data == NULL || ascii == NULL || result == NULL) {
+		free (result);
+		free (ascii);
+		free (data);
+		return EXIT_FAILURE;
+	}
+
+	srand (1);
+	for (unsigned int i = 0; i < size; ++i)
+		data[i] = rand () & 0xFF;
+
+	clock_t start = clock ();
+	for (unsigned int n = 0; n < count; ++n)
+		array_convert_bin2hex (data, size, ascii, 2 * size);
+	report ("array_convert_bin2hex", elapsed (start), size, count);
+
+	int rc = 0;
+	start = clock ();
+	for (unsigned int n = 0; n < count; ++n)
+		rc |= reference_hex2bin (ascii, 2 * size, result, size);
+	report ("branch chain hex2bin", elapsed (start), size, count);
+
+	start = clock ();
+	for (unsigned int n = 0; n < count; ++n)
+		rc |= array_convert_hex2bin (ascii, 2 * size, result, size);
+	report ("array_convert_hex2bin", elapsed (start), size, count);
+
+	// Check the round trip, and the rejection of an invalid character.
+	int ok = (rc == 0 && memcmp (data, result, size) == 0);
+	ascii[size] = 'G';
+	if (array_convert_hex2bin (ascii, 2 * size, result, size) == 0)
+		ok = 0;
+	printf ("round trip %s\n", ok ? "ok" : "FAILED");
+
+	free (result);
+	free (ascii);
+	free (data);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
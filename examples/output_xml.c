@@ -413,12 +413,27 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 
 	// Parse the sample data.
 	message ("Parsing the sample data.\n");
-	status = dc_parser_samples_foreach (parser, sample_cb, &sampledata);
+	dc_iterator_t *iterator = NULL;
+	status = dc_parser_samples_iterator (parser, &iterator);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR ("Error parsing the sample data.");
 		goto cleanup;
 	}
 
+	dc_sample_t sample;
+	while ((status = dc_iterator_next (iterator, &sample)) == DC_STATUS_SUCCESS) {
+		sample_cb (sample.type, sample.value, &sampledata);
+	}
+
+	dc_iterator_free (iterator);
+
+	if (status != DC_STATUS_DONE) {
+		ERROR ("Error parsing the sample data.");
+		goto cleanup;
+	}
+
+	status = DC_STATUS_SUCCESS;
+
 cleanup:
 
 	if (sampledata.nsamples)
@@ -0,0 +1,255 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Benchmark of the sample dispatch alternatives of sample_visitor.hpp.
+ *
+ * Without dive files, only the dispatch itself is measured: a synthetic
+ * array of samples is handed to a visitor through a plain C callback,
+ * through the per-visitor trampoline, and through an inlined call to
+ * visit_sample. This isolates the cost of the indirect call per sample,
+ * and excludes the decoding.
+ *
+ * With dive files (in the raw dctool format), every dive is parsed with
+ * dc_parser_samples_foreach and a C callback, with dc::samples_foreach
+ * and with dc::samples_visit. This includes the decoding, and for the
+ * backends without a native iterator, the buffering of the profile.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/sample_visitor.hpp>
+
+#include "common.h"
+#include "utils.h"
+
+namespace {
+
+struct depth_visitor : dc::sample_visitor {
+	double sum;
+	unsigned int count;
+
+	depth_visitor () : sum (0.0), count (0) {}
+
+	void depth (double value)
+	{
+		sum += value;
+		count++;
+	}
+};
+
+void
+depth_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	depth_visitor *visitor = static_cast<depth_visitor *> (userdata);
+
+	if (type == DC_SAMPLE_DEPTH) {
+		visitor->sum += value.depth;
+		visitor->count++;
+	}
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+double
+elapsed (bench_clock::time_point start)
+{
+	return std::chrono::duration<double> (bench_clock::now () - start).count ();
+}
+
+void
+report (const char *name, double seconds, const depth_visitor &visitor)
+{
+	printf ("%-24s %8.3fs  (%u depth samples, sum %.1f)\n",
+		name, seconds, visitor.count, visitor.sum);
+}
+
+/*
+ * The function pointers are passed through a volatile variable, such
+ * that the compiler cannot turn the indirect calls into direct ones.
+ */
+void
+bench_dispatch (unsigned int count)
+{
+	std::vector<dc_sample_t> samples (count);
+	for (unsigned int i = 0; i < count; ++i) {
+		if (i % 2) {
+			samples[i].type = DC_SAMPLE_DEPTH;
+			samples[i].value.depth = (i % 400) / 10.0;
+		} else {
+			samples[i].type = DC_SAMPLE_TIME;
+			samples[i].value.time = i * 5;
+		}
+	}
+
+	dc_sample_callback_t volatile callback = depth_cb;
+	dc_sample_callback_t volatile trampoline = &dc::detail::sample_trampoline<depth_visitor, DC_SAMPLE_MODE_DOUBLE>;
+
+	depth_visitor v1;
+	bench_clock::time_point start = bench_clock::now ();
+	dc_sample_callback_t f1 = callback;
+	for (unsigned int i = 0; i < count; ++i)
+		f1 (samples[i].type, samples[i].value, &v1);
+	report ("C callback", elapsed (start), v1);
+
+	depth_visitor v2;
+	start = bench_clock::now ();
+	dc_sample_callback_t f2 = trampoline;
+	for (unsigned int i = 0; i < count; ++i)
+		f2 (samples[i].type, samples[i].value, &v2);
+	report ("visitor trampoline", elapsed (start), v2);
+
+	depth_visitor v3;
+	start = bench_clock::now ();
+	for (unsigned int i = 0; i < count; ++i)
+		dc::visit_sample (v3, samples[i].type, samples[i].value);
+	report ("inlined visit_sample", elapsed (start), v3);
+}
+
+int
+bench_parse (dc_context_t *context, dc_descriptor_t *descriptor, unsigned int count, int argc, char *argv[])
+{
+	std::vector<dc::buffer> dives;
+	for (int i = 0; i < argc; ++i) {
+		dc::buffer buffer (dctool_file_read (argv[i]));
+		if (!buffer) {
+			ERROR ("Error reading the dive data.");
+			return EXIT_FAILURE;
+		}
+		dives.push_back (std::move (buffer));
+	}
+
+	dc::parser parser;
+	dc_status_t rc = dc_parser_new2 (parser.out (), context, descriptor, 0, 0);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the parser.");
+		return EXIT_FAILURE;
+	}
+
+	for (unsigned int method = 0; method < 3; ++method) {
+		static const char *names[] = {
+			"C callback",
+			"dc::samples_foreach",
+			"dc::samples_visit",
+		};
+
+		depth_visitor visitor;
+		bench_clock::time_point start = bench_clock::now ();
+		for (unsigned int n = 0; n < count; ++n) {
+			for (size_t i = 0; i < dives.size (); ++i) {
+				rc = dc_parser_set_data (parser, dc_buffer_get_data (dives[i]), dc_buffer_get_size (dives[i]));
+				if (rc == DC_STATUS_SUCCESS) {
+					if (method == 0)
+						rc = dc_parser_samples_foreach (parser, depth_cb, &visitor);
+					else if (method == 1)
+						rc = dc::samples_foreach (parser, visitor);
+					else
+						rc = dc::samples_visit (parser, visitor);
+				}
+				if (rc != DC_STATUS_SUCCESS) {
+					ERROR ("Error parsing the sample data.");
+					return EXIT_FAILURE;
+				}
+			}
+		}
+		report (names[method], elapsed (start), visitor);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int
+main (int argc, char *argv[])
+{
+	int exitcode = EXIT_SUCCESS;
+
+	// Default option values.
+	dc_family_t family = DC_FAMILY_NULL;
+	unsigned int model = 0;
+	unsigned int count = 0;
+
+	// Parse the command-line options.
+	int opt = 0;
+	while ((opt = getopt (argc, argv, "f:m:n:h")) != -1) {
+		switch (opt) {
+		case 'f':
+			family = dctool_family_type (optarg);
+			break;
+		case 'm':
+			model = strtoul (optarg, NULL, 0);
+			break;
+		case 'n':
+			count = strtoul (optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			printf ("Usage:\n"
+				"   sample_visitor_bench [-n <count>]\n"
+				"   sample_visitor_bench -f <family> [-m <model>] [-n <count>] <file>...\n");
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc == 0) {
+		bench_dispatch (count ? count : 50000000);
+		return EXIT_SUCCESS;
+	}
+
+	if (family == DC_FAMILY_NULL) {
+		ERROR ("No device family specified.");
+		return EXIT_FAILURE;
+	}
+
+	dc::context context;
+	dc_status_t rc = dc_context_new (context.out ());
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the context.");
+		return EXIT_FAILURE;
+	}
+
+	dc_descriptor_t *descriptor = NULL;
+	rc = dctool_descriptor_search (&descriptor, NULL, family, model);
+	if (rc != DC_STATUS_SUCCESS || descriptor == NULL) {
+		ERROR ("No supported device found.");
+		return EXIT_FAILURE;
+	}
+
+	exitcode = bench_parse (context, descriptor, count ? count : 1000, argc, argv);
+
+	dc_descriptor_free (descriptor);
+
+	return exitcode;
+}
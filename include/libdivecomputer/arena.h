@@ -0,0 +1,79 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_ARENA_H
+#define DC_ARENA_H
+
+#include <stddef.h>
+
+#include "common.h"
+#include "context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A memory arena for the allocator of a context. The memory is handed out
+ * from large blocks, and the individual allocations are never released.
+ * Instead, everything that was allocated during a download or parse is
+ * released in a single step, with dc_arena_reset or dc_arena_free. All the
+ * objects that were created with the context (devices, parsers, iterators,
+ * buffers) must be destroyed before the memory is released.
+ *
+ * The arena can be used from several threads at the same time.
+ */
+typedef struct dc_arena_t dc_arena_t;
+
+/*
+ * Create a new arena. The memory is allocated in blocks of the requested
+ * size (or a default size if zero). Larger allocations get a block of
+ * their own.
+ */
+dc_status_t
+dc_arena_new (dc_arena_t **arena, size_t blocksize);
+
+dc_status_t
+dc_arena_free (dc_arena_t *arena);
+
+/*
+ * Release all the memory, except for a single block that is kept for
+ * the next round of allocations.
+ */
+dc_status_t
+dc_arena_reset (dc_arena_t *arena);
+
+/*
+ * Get the allocator callbacks for the context (see dc_context_set_allocator).
+ */
+dc_status_t
+dc_arena_get_allocator (dc_arena_t *arena, dc_allocator_t *allocator);
+
+/*
+ * Get the number of bytes that were handed out since the last reset.
+ */
+size_t
+dc_arena_get_size (dc_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_ARENA_H */
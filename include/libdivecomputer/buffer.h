@@ -54,12 +54,38 @@ dc_buffer_prepend (dc_buffer_t *buffer, const unsigned char data[], size_t size)
 int
 dc_buffer_slice (dc_buffer_t *buffer, size_t offset, size_t size);
 
+/*
+ * Create a view on a part of the buffer, without copying the data. The
+ * view keeps the data alive, even after the original buffer has been
+ * freed, and needs to be released with dc_buffer_free(). Whenever the
+ * original buffer or the view is modified, it switches to a private copy
+ * first, and the other one keeps the original contents.
+ *
+ * A buffer and its views can be used from different threads, but each
+ * individual buffer or view must not be used from more than one thread
+ * at the same time.
+ */
+dc_buffer_t *
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size);
+
 size_t
 dc_buffer_get_size (dc_buffer_t *buffer);
 
+/*
+ * Get a pointer to the data, for reading and writing. If the data is
+ * still shared with a view, the buffer switches to a private copy first,
+ * which invalidates any pointer returned previously.
+ */
 unsigned char *
 dc_buffer_get_data (dc_buffer_t *buffer);
 
+/*
+ * Get a pointer to the data, for reading only. Unlike dc_buffer_get_data,
+ * this never copies data that is shared with a view.
+ */
+const unsigned char *
+dc_buffer_get_const_data (dc_buffer_t *buffer);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -22,7 +22,10 @@
 #ifndef DC_CONTEXT_H
 #define DC_CONTEXT_H
 
+#include <stddef.h>
+
 #include "common.h"
+#include "datetime.h"
 #include "custom_serial.h"
 
 #ifdef __cplusplus
@@ -40,6 +43,51 @@ typedef enum dc_loglevel_t {
 	DC_LOGLEVEL_ALL
 } dc_loglevel_t;
 
+/*
+ * Memory allocation callbacks. All the memory that the library allocates
+ * on behalf of a context (devices, parsers, iterators, buffers and the
+ * intermediate data of a download or parse) goes through these callbacks.
+ *
+ * If the free callback is not set, the allocator operates in arena mode.
+ * The library never releases memory itself, and the application releases
+ * everything at once, after all the objects allocated from the arena
+ * (e.g. the device or parser) have been destroyed. See dc_arena_new for
+ * a ready-made arena.
+ *
+ * The allocator must be set before any object is created with the
+ * context. Once the library holds memory from the allocator, changing it
+ * fails with DC_STATUS_INVALIDARGS, until all the objects are destroyed.
+ */
+typedef struct dc_allocator_t {
+	void *(*malloc) (void *userdata, size_t size);
+	void *(*realloc) (void *userdata, void *ptr, size_t size);
+	void (*free) (void *userdata, void *ptr);
+	void *userdata;
+} dc_allocator_t;
+
+/*
+ * Time source callbacks. All the deliberate delays of the protocol code
+ * (dc_serial_sleep), the timing of the custom transport fallbacks and the
+ * host timestamps that are recorded for clock synchronization go through
+ * these callbacks. A test harness can install a virtual clock to run the
+ * protocol code against an emulated device without waiting in real time,
+ * or wrap the system clock to measure the time spent in delays.
+ *
+ *  - monotonic: Return a monotonic timestamp in microseconds.
+ *  - sleep: Suspend for the specified number of milliseconds.
+ *  - now: Return the current wall clock time. Optional, the system time
+ *    (dc_datetime_now) is used if not set.
+ *
+ * Timeouts of a native serial port are still enforced by the operating
+ * system, in real time.
+ */
+typedef struct dc_clock_t {
+	unsigned long long (*monotonic) (void *userdata);
+	void (*sleep) (void *userdata, unsigned int milliseconds);
+	dc_ticks_t (*now) (void *userdata);
+	void *userdata;
+} dc_clock_t;
+
 typedef void (*dc_logfunc_t) (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *message, void *userdata);
 
 dc_status_t
@@ -51,6 +99,15 @@ dc_context_free (dc_context_t *context);
 dc_status_t
 dc_context_set_custom_serial (dc_context_t *context, dc_custom_serial_t *custom_serial);
 
+dc_status_t
+dc_context_set_custom_transport (dc_context_t *context, dc_custom_transport_t *custom_transport);
+
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, const dc_allocator_t *allocator);
+
+dc_status_t
+dc_context_set_clock (dc_context_t *context, const dc_clock_t *clock);
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel);
 
@@ -1,6 +1,8 @@
 #ifndef CUSTOM_SERIAL_H
 #define CUSTOM_SERIAL_H
 
+#include <stddef.h>
+
 #include "common.h"
 
 #ifdef __cplusplus
@@ -83,6 +85,44 @@ typedef struct dc_custom_serial_t
 	//dc_serial_sleep (dc_serial_t *device, unsigned int timeout) - No device interaction
 } dc_custom_serial_t;
 
+/*
+ * A memory buffer for the scatter/gather operations.
+ */
+typedef struct dc_iovec_t {
+	void *data;
+	size_t size;
+} dc_iovec_t;
+
+/*
+ * The extended custom transport. The basic serial callbacks are embedded
+ * as the first member, and all the additional callbacks are optional. If
+ * a callback is not available, the library falls back to the basic read
+ * and write callbacks.
+ *
+ *  - readv/writev: Transfer a list of buffers with a single call.
+ *  - read_some: Read at least minimum bytes, and up to maximum bytes if
+ *    more data is already available. A timeout is only reported when
+ *    less than minimum bytes are received.
+ *  - get_fd: Return a file descriptor that becomes readable when data
+ *    is available, or a negative value if there is none. On POSIX
+ *    systems, the library
+ *    waits on this descriptor (with the configured timeout) before
+ *    calling any of the read callbacks.
+ *  - wait: Block until data is available, or the timeout (in
+ *    milliseconds, negative for infinite) expires. Returns
+ *    DC_STATUS_TIMEOUT when no data arrived. Takes precedence over
+ *    get_fd.
+ */
+typedef struct dc_custom_transport_t
+{
+	dc_custom_serial_t serial;
+	dc_status_t (*readv) (void **userdata, const dc_iovec_t iov[], unsigned int count, size_t *actual);
+	dc_status_t (*writev) (void **userdata, const dc_iovec_t iov[], unsigned int count, size_t *actual);
+	dc_status_t (*read_some) (void **userdata, void *data, size_t minimum, size_t maximum, size_t *actual);
+	int (*get_fd) (void **userdata);
+	dc_status_t (*wait) (void **userdata, int timeout);
+} dc_custom_transport_t;
+
 
 #ifdef __cplusplus
 }
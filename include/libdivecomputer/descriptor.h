@@ -23,6 +23,7 @@
 #define DC_DESCRIPTOR_H
 
 #include "common.h"
+#include "context.h"
 #include "iterator.h"
 
 #ifdef __cplusplus
@@ -41,6 +42,13 @@ typedef struct dc_descriptor_t dc_descriptor_t;
 dc_status_t
 dc_descriptor_iterator (dc_iterator_t **iterator);
 
+/*
+ * Same as dc_descriptor_iterator, but the iterator is allocated with the
+ * allocator of the context.
+ */
+dc_status_t
+dc_descriptor_iterator_new (dc_iterator_t **iterator, dc_context_t *context);
+
 void
 dc_descriptor_free (dc_descriptor_t *descriptor);
 
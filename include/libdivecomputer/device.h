@@ -84,6 +84,9 @@ dc_device_set_events (dc_device_t *device, unsigned int events, dc_event_callbac
 dc_status_t
 dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
 
+dc_status_t
+dc_device_add_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
+
 dc_status_t
 dc_device_version (dc_device_t *device, unsigned char data[], unsigned int size);
 
@@ -99,6 +102,15 @@ dc_device_dump (dc_device_t *device, dc_buffer_t *buffer);
 dc_status_t
 dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata);
 
+/*
+ * Keep a dive beyond the dive callback. Must be called from within the
+ * callback, with the dive data passed to it. If possible, the returned
+ * buffer is a view on the downloaded data, and otherwise a copy. The
+ * buffer needs to be released with dc_buffer_free().
+ */
+dc_buffer_t *
+dc_device_get_dive (dc_device_t *device, const unsigned char data[], unsigned int size);
+
 dc_status_t
 dc_device_close (dc_device_t *device);
 
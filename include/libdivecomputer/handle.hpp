@@ -0,0 +1,125 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_HANDLE_HPP
+#define DC_HANDLE_HPP
+
+#include "context.h"
+#include "device.h"
+#include "parser.h"
+#include "buffer.h"
+#include "iterator.h"
+
+namespace dc {
+
+/*
+ * Release policy for each of the library object types.
+ */
+template <typename T>
+struct handle_traits;
+
+template <>
+struct handle_traits<dc_context_t> {
+	static void release (dc_context_t *context) { dc_context_free (context); }
+};
+
+template <>
+struct handle_traits<dc_device_t> {
+	static void release (dc_device_t *device) { dc_device_close (device); }
+};
+
+template <>
+struct handle_traits<dc_parser_t> {
+	static void release (dc_parser_t *parser) { dc_parser_destroy (parser); }
+};
+
+template <>
+struct handle_traits<dc_buffer_t> {
+	static void release (dc_buffer_t *buffer) { dc_buffer_free (buffer); }
+};
+
+template <>
+struct handle_traits<dc_iterator_t> {
+	static void release (dc_iterator_t *iterator) { dc_iterator_free (iterator); }
+};
+
+/*
+ * Move-only owner of a library object. The object is released when the
+ * owner goes out of scope. The out() accessor can be passed directly to
+ * the constructor functions of the C interface:
+ *
+ *   dc::context context;
+ *   dc_status_t rc = dc_context_new (context.out ());
+ */
+template <typename T>
+class handle {
+public:
+	handle () : m_ptr (0) {}
+	explicit handle (T *ptr) : m_ptr (ptr) {}
+	handle (handle &&other) : m_ptr (other.release ()) {}
+	~handle () { reset (); }
+
+	handle &operator= (handle &&other)
+	{
+		reset (other.release ());
+		return *this;
+	}
+
+	handle (const handle &) = delete;
+	handle &operator= (const handle &) = delete;
+
+	T *get () const { return m_ptr; }
+	operator T * () const { return m_ptr; }
+	explicit operator bool () const { return m_ptr != 0; }
+
+	T *release ()
+	{
+		T *ptr = m_ptr;
+		m_ptr = 0;
+		return ptr;
+	}
+
+	void reset (T *ptr = 0)
+	{
+		if (m_ptr)
+			handle_traits<T>::release (m_ptr);
+		m_ptr = ptr;
+	}
+
+	T **out ()
+	{
+		reset ();
+		return &m_ptr;
+	}
+
+private:
+	T *m_ptr;
+};
+
+typedef handle<dc_context_t> context;
+typedef handle<dc_device_t> device;
+typedef handle<dc_parser_t> parser;
+typedef handle<dc_buffer_t> buffer;
+typedef handle<dc_iterator_t> iterator;
+
+} // namespace dc
+
+#endif /* DC_HANDLE_HPP */
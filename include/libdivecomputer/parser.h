@@ -27,6 +27,7 @@
 #include "descriptor.h"
 #include "device.h"
 #include "datetime.h"
+#include "iterator.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -204,6 +205,18 @@ typedef struct dc_field_string_t {
 	const char *value;
 } dc_field_string_t;
 
+/*
+ * Representation of the sample values. In the fixed point mode, the
+ * depth, pressure, temperature, setpoint, ppo2, cns and deco samples
+ * store their value in the fixed member of the sample value, as an
+ * integer in the unit documented there. All other sample types are the
+ * same in both modes.
+ */
+typedef enum dc_sample_mode_t {
+	DC_SAMPLE_MODE_DOUBLE,
+	DC_SAMPLE_MODE_FIXED
+} dc_sample_mode_t;
+
 typedef union dc_sample_value_t {
 	unsigned int time;
 	double depth;
@@ -236,8 +249,29 @@ typedef union dc_sample_value_t {
 		double depth;
 	} deco;
 	unsigned int gasmix; /* Gas mix index */
+	union {
+		int depth; /* Millimeters */
+		struct {
+			unsigned int tank;
+			int value; /* Millibar */
+		} pressure;
+		int temperature; /* Millidegrees Celsius */
+		int setpoint; /* Millibar */
+		int ppo2; /* Millibar */
+		int cns; /* Per mille */
+		struct {
+			unsigned int type;
+			unsigned int time;
+			int depth; /* Millimeters */
+		} deco;
+	} fixed; /* Fixed point values (DC_SAMPLE_MODE_FIXED) */
 } dc_sample_value_t;
 
+typedef struct dc_sample_t {
+	dc_sample_type_t type;
+	dc_sample_value_t value;
+} dc_sample_t;
+
 typedef struct dc_parser_t dc_parser_t;
 
 typedef void (*dc_sample_callback_t) (dc_sample_type_t type, dc_sample_value_t value, void *userdata);
@@ -260,9 +294,21 @@ dc_parser_get_datetime (dc_parser_t *parser, dc_datetime_t *datetime);
 dc_status_t
 dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
 
+dc_status_t
+dc_parser_set_sample_mode (dc_parser_t *parser, dc_sample_mode_t mode);
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
+/*
+ * Create an iterator over the samples. Each call to dc_iterator_next()
+ * returns the next sample (as a dc_sample_t), and DC_STATUS_DONE after
+ * the last one. The iterator keeps a reference to the dive data, and
+ * needs to be freed before the parser is destroyed or receives new data.
+ */
+dc_status_t
+dc_parser_samples_iterator (dc_parser_t *parser, dc_iterator_t **iterator);
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser);
 
@@ -0,0 +1,81 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2017 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_PIPELINE_H
+#define DC_PIPELINE_H
+
+#include "common.h"
+#include "device.h"
+#include "parser.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Pipelined download.
+ *
+ * The downloaded dives are copied into a bounded queue, and a pool of
+ * worker threads creates a parser for each dive (with the device info and
+ * clock calibration at the time the dive was received) and calls the parse
+ * callback. The results are passed to the deliver callback in download
+ * order, on the thread that called dc_device_foreach_pipeline, in between
+ * the transfers. The download only blocks when the queue is full.
+ *
+ *  - nworkers: The number of worker threads. With zero workers, or if the
+ *    library is built without thread support, every dive is parsed on the
+ *    download thread.
+ *  - capacity: The maximum number of dives in the queue. Zero selects
+ *    twice the number of workers.
+ *  - parse: Optional. Called on a worker thread, concurrently with the
+ *    download and the other workers. Returns an application defined
+ *    result, which is passed to the deliver callback.
+ *  - deliver: Called in download order. Return zero to stop the download,
+ *    just like the dc_dive_callback_t callback. The parser is destroyed
+ *    afterwards.
+ *  - release: Optional. Called for the results that are never delivered,
+ *    because the download stopped, failed or was cancelled.
+ *
+ * The log function and the allocator of the context can be called from
+ * the worker threads, and must be thread-safe when nworkers is not zero.
+ */
+typedef void *(*dc_pipeline_parse_t) (dc_parser_t *parser, const unsigned char *data, unsigned int size, void *userdata);
+
+typedef int (*dc_pipeline_deliver_t) (dc_parser_t *parser, void *result, const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata);
+
+typedef void (*dc_pipeline_release_t) (void *result, void *userdata);
+
+typedef struct dc_pipeline_t {
+	unsigned int nworkers;
+	unsigned int capacity;
+	dc_pipeline_parse_t parse;
+	dc_pipeline_deliver_t deliver;
+	dc_pipeline_release_t release;
+	void *userdata;
+} dc_pipeline_t;
+
+dc_status_t
+dc_device_foreach_pipeline (dc_device_t *device, const dc_pipeline_t *pipeline);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_PIPELINE_H */
@@ -0,0 +1,215 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_SAMPLE_VISITOR_HPP
+#define DC_SAMPLE_VISITOR_HPP
+
+#include "parser.h"
+#include "handle.hpp"
+
+namespace dc {
+
+/*
+ * Base class for sample visitors, with an empty handler for every
+ * sample type. A visitor derives from this class and hides only the
+ * handlers it needs. Because the handlers are resolved at compile time,
+ * the remaining sample types reduce to nothing after inlining.
+ *
+ * The *_fixed handlers receive the integer values of the fixed point
+ * sample mode (see dc_sample_value_t for the units), and are only
+ * called in that mode. They have distinct names, such that a visitor
+ * for one mode can never be fed the values of the other mode through
+ * an implicit conversion.
+ */
+struct sample_visitor {
+	void time (unsigned int) {}
+	void depth (double) {}
+	void pressure (unsigned int /* tank */, double /* value */) {}
+	void temperature (double) {}
+	void event (unsigned int /* type */, unsigned int /* time */, unsigned int /* flags */, unsigned int /* value */) {}
+	void rbt (unsigned int) {}
+	void heartbeat (unsigned int) {}
+	void bearing (unsigned int) {}
+	void vendor (unsigned int /* type */, unsigned int /* size */, const void * /* data */) {}
+	void setpoint (double) {}
+	void ppo2 (double) {}
+	void cns (double) {}
+	void deco (unsigned int /* type */, unsigned int /* time */, double /* depth */) {}
+	void gasmix (unsigned int) {}
+
+	void depth_fixed (int) {}
+	void pressure_fixed (unsigned int /* tank */, int /* value */) {}
+	void temperature_fixed (int) {}
+	void setpoint_fixed (int) {}
+	void ppo2_fixed (int) {}
+	void cns_fixed (int) {}
+	void deco_fixed (unsigned int /* type */, unsigned int /* time */, int /* depth */) {}
+};
+
+/*
+ * Dispatch a single sample to the matching handler of the visitor. The
+ * mode must match the sample mode of the parser that produced the
+ * sample, because it selects which member of the value is valid.
+ */
+template <typename Visitor>
+inline void
+visit_sample (Visitor &visitor, dc_sample_type_t type, const dc_sample_value_t &value, dc_sample_mode_t mode = DC_SAMPLE_MODE_DOUBLE)
+{
+	if (mode == DC_SAMPLE_MODE_FIXED) {
+		switch (type) {
+		case DC_SAMPLE_DEPTH:
+			visitor.depth_fixed (value.fixed.depth);
+			return;
+		case DC_SAMPLE_PRESSURE:
+			visitor.pressure_fixed (value.fixed.pressure.tank, value.fixed.pressure.value);
+			return;
+		case DC_SAMPLE_TEMPERATURE:
+			visitor.temperature_fixed (value.fixed.temperature);
+			return;
+		case DC_SAMPLE_SETPOINT:
+			visitor.setpoint_fixed (value.fixed.setpoint);
+			return;
+		case DC_SAMPLE_PPO2:
+			visitor.ppo2_fixed (value.fixed.ppo2);
+			return;
+		case DC_SAMPLE_CNS:
+			visitor.cns_fixed (value.fixed.cns);
+			return;
+		case DC_SAMPLE_DECO:
+			visitor.deco_fixed (value.fixed.deco.type, value.fixed.deco.time, value.fixed.deco.depth);
+			return;
+		default:
+			break;
+		}
+	}
+
+	switch (type) {
+	case DC_SAMPLE_TIME:
+		visitor.time (value.time);
+		break;
+	case DC_SAMPLE_DEPTH:
+		visitor.depth (value.depth);
+		break;
+	case DC_SAMPLE_PRESSURE:
+		visitor.pressure (value.pressure.tank, value.pressure.value);
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		visitor.temperature (value.temperature);
+		break;
+	case DC_SAMPLE_EVENT:
+		visitor.event (value.event.type, value.event.time, value.event.flags, value.event.value);
+		break;
+	case DC_SAMPLE_RBT:
+		visitor.rbt (value.rbt);
+		break;
+	case DC_SAMPLE_HEARTBEAT:
+		visitor.heartbeat (value.heartbeat);
+		break;
+	case DC_SAMPLE_BEARING:
+		visitor.bearing (value.bearing);
+		break;
+	case DC_SAMPLE_VENDOR:
+		visitor.vendor (value.vendor.type, value.vendor.size, value.vendor.data);
+		break;
+	case DC_SAMPLE_SETPOINT:
+		visitor.setpoint (value.setpoint);
+		break;
+	case DC_SAMPLE_PPO2:
+		visitor.ppo2 (value.ppo2);
+		break;
+	case DC_SAMPLE_CNS:
+		visitor.cns (value.cns);
+		break;
+	case DC_SAMPLE_DECO:
+		visitor.deco (value.deco.type, value.deco.time, value.deco.depth);
+		break;
+	case DC_SAMPLE_GASMIX:
+		visitor.gasmix (value.gasmix);
+		break;
+	default:
+		break;
+	}
+}
+
+namespace detail {
+
+template <typename Visitor, dc_sample_mode_t Mode>
+void
+sample_trampoline (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	visit_sample (*static_cast<Visitor *> (userdata), type, value, Mode);
+}
+
+} // namespace detail
+
+/*
+ * Visit all samples with the callback interface. A separate trampoline
+ * is instantiated for each visitor type and mode, so the dispatch is
+ * inlined. The sample mode of the parser is set to the requested mode.
+ */
+template <typename Visitor>
+inline dc_status_t
+samples_foreach (dc_parser_t *parser, Visitor &visitor, dc_sample_mode_t mode = DC_SAMPLE_MODE_DOUBLE)
+{
+	dc_status_t rc = dc_parser_set_sample_mode (parser, mode);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	if (mode == DC_SAMPLE_MODE_FIXED)
+		return dc_parser_samples_foreach (parser, &detail::sample_trampoline<Visitor, DC_SAMPLE_MODE_FIXED>, &visitor);
+	else
+		return dc_parser_samples_foreach (parser, &detail::sample_trampoline<Visitor, DC_SAMPLE_MODE_DOUBLE>, &visitor);
+}
+
+/*
+ * Visit all samples with the iterator interface. The visitor handlers
+ * are dispatched inline, but dc_iterator_next itself is still an
+ * indirect call per sample. Backends without a native iterator (all
+ * except the iDive) fall back to an iterator that runs the callback
+ * interface with a push callback, and buffers the entire profile first.
+ * Use it where pulling the samples is more convenient; samples_foreach
+ * is the cheaper choice (see examples/sample_visitor_bench.cpp). The
+ * sample mode of the parser is set to the requested mode.
+ */
+template <typename Visitor>
+inline dc_status_t
+samples_visit (dc_parser_t *parser, Visitor &visitor, dc_sample_mode_t mode = DC_SAMPLE_MODE_DOUBLE)
+{
+	dc_status_t rc = dc_parser_set_sample_mode (parser, mode);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	iterator samples;
+	rc = dc_parser_samples_iterator (parser, samples.out ());
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	dc_sample_t sample;
+	while ((rc = dc_iterator_next (samples, &sample)) == DC_STATUS_SUCCESS) {
+		visit_sample (visitor, sample.type, sample.value, mode);
+	}
+
+	return rc == DC_STATUS_DONE ? DC_STATUS_SUCCESS : rc;
+}
+
+} // namespace dc
+
+#endif /* DC_SAMPLE_VISITOR_HPP */
@@ -0,0 +1,103 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_SERIAL_MONITOR_H
+#define DC_SERIAL_MONITOR_H
+
+#include "common.h"
+#include "context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Opaque object representing a serial port hotplug monitor.
+ */
+typedef struct dc_serial_monitor_t dc_serial_monitor_t;
+
+/**
+ * Serial port hotplug events.
+ */
+typedef enum dc_serial_event_t {
+	DC_SERIAL_EVENT_ADD,   /**< Serial port added */
+	DC_SERIAL_EVENT_REMOVE /**< Serial port removed */
+} dc_serial_event_t;
+
+/**
+ * Serial port hotplug callback.
+ *
+ * The USB vendor and product identifiers are zero if the port is not
+ * backed by a USB device.
+ *
+ * @param[in]  event     The type of the event.
+ * @param[in]  name      The name of the device node.
+ * @param[in]  vid       The USB vendor identifier.
+ * @param[in]  pid       The USB product identifier.
+ * @param[in]  userdata  The user data pointer.
+ */
+typedef void (*dc_serial_monitor_callback_t) (dc_serial_event_t event, const char *name, unsigned int vid, unsigned int pid, void *userdata);
+
+/**
+ * Create a serial port hotplug monitor.
+ *
+ * An add event is delivered for every serial port that is already
+ * present before this function returns. Subsequent changes are only
+ * delivered from within #dc_serial_monitor_poll.
+ *
+ * @param[out]  monitor   A location to store the monitor.
+ * @param[in]   context   A valid context object.
+ * @param[in]   callback  The callback function to call.
+ * @param[in]   userdata  User data to pass to the callback function.
+ * @returns #DC_STATUS_SUCCESS on success, #DC_STATUS_UNSUPPORTED if
+ * hotplug notifications are not available on this platform, or
+ * another #dc_status_t code on failure.
+ */
+dc_status_t
+dc_serial_monitor_new (dc_serial_monitor_t **monitor, dc_context_t *context, dc_serial_monitor_callback_t callback, void *userdata);
+
+/**
+ * Wait for hotplug events and deliver them to the callback.
+ *
+ * @param[in]  monitor  A valid monitor.
+ * @param[in]  timeout  The timeout in milliseconds. A negative value
+ *                      waits forever, and zero returns immediately.
+ * @returns #DC_STATUS_SUCCESS on success, #DC_STATUS_TIMEOUT if no
+ * events arrived within the timeout, or another #dc_status_t code on
+ * failure.
+ */
+dc_status_t
+dc_serial_monitor_poll (dc_serial_monitor_t *monitor, int timeout);
+
+/**
+ * Destroy the hotplug monitor and free all resources.
+ *
+ * @param[in]  monitor  A valid monitor.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_monitor_free (dc_serial_monitor_t *monitor);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_SERIAL_MONITOR_H */
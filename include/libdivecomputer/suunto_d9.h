@@ -38,6 +38,9 @@ suunto_d9_device_open (dc_device_t **device, dc_context_t *context, const char *
 dc_status_t
 suunto_d9_device_version (dc_device_t *device, unsigned char data[], unsigned int size);
 
+dc_status_t
+suunto_d9_device_get_baudrate (dc_device_t *device, unsigned int *baudrate);
+
 dc_status_t
 suunto_d9_device_reset_maxdepth (dc_device_t *device);
 
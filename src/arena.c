@@ -0,0 +1,248 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy
+
+#include <libdivecomputer/arena.h>
+
+#include "thread.h"
+
+#define BLOCKSIZE 0x10000
+
+/*
+ * The alignment of each allocation, suitable for any type.
+ */
+typedef union dc_arena_align_t {
+	long long l;
+	long double d;
+	void *p;
+} dc_arena_align_t;
+
+#define ALIGN(size) (((size) + sizeof (dc_arena_align_t) - 1) / sizeof (dc_arena_align_t) * sizeof (dc_arena_align_t))
+
+/*
+ * Each allocation is preceded by a header with its size, which is needed
+ * to move the data to a larger allocation on realloc.
+ */
+#define HEADER ALIGN(sizeof (size_t))
+
+typedef struct dc_arena_block_t {
+	struct dc_arena_block_t *next;
+	size_t size, used;
+	dc_arena_align_t data[1];
+} dc_arena_block_t;
+
+struct dc_arena_t {
+	dc_mutex_t lock;
+	dc_arena_block_t *blocks;
+	size_t blocksize;
+	size_t nbytes;
+};
+
+dc_status_t
+dc_arena_new (dc_arena_t **out, size_t blocksize)
+{
+	dc_arena_t *arena = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	arena = (dc_arena_t *) malloc (sizeof (dc_arena_t));
+	if (arena == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	dc_mutex_init (&arena->lock);
+	arena->blocks = NULL;
+	arena->blocksize = (blocksize ? ALIGN(blocksize) : BLOCKSIZE);
+	arena->nbytes = 0;
+
+	*out = arena;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_arena_free (dc_arena_t *arena)
+{
+	if (arena == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_arena_block_t *block = arena->blocks;
+	while (block) {
+		dc_arena_block_t *next = block->next;
+		free (block);
+		block = next;
+	}
+
+	dc_mutex_free (&arena->lock);
+	free (arena);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_arena_reset (dc_arena_t *arena)
+{
+	if (arena == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_mutex_lock (&arena->lock);
+
+	// Keep one block of the default size.
+	dc_arena_block_t *keep = NULL;
+	dc_arena_block_t *block = arena->blocks;
+	while (block) {
+		dc_arena_block_t *next = block->next;
+		if (keep == NULL && block->size == arena->blocksize) {
+			keep = block;
+			keep->next = NULL;
+			keep->used = 0;
+		} else {
+			free (block);
+		}
+		block = next;
+	}
+
+	arena->blocks = keep;
+	arena->nbytes = 0;
+
+	dc_mutex_unlock (&arena->lock);
+
+	return DC_STATUS_SUCCESS;
+}
+
+size_t
+dc_arena_get_size (dc_arena_t *arena)
+{
+	if (arena == NULL)
+		return 0;
+
+	dc_mutex_lock (&arena->lock);
+	size_t nbytes = arena->nbytes;
+	dc_mutex_unlock (&arena->lock);
+
+	return nbytes;
+}
+
+static unsigned char *
+dc_arena_block_data (dc_arena_block_t *block)
+{
+	return (unsigned char *) block->data;
+}
+
+static void *
+dc_arena_malloc_locked (dc_arena_t *arena, size_t size)
+{
+	size_t needed = HEADER + ALIGN(size);
+
+	dc_arena_block_t *block = arena->blocks;
+	if (block == NULL || block->used + needed > block->size) {
+		// Allocate a new block. A large allocation gets a block of its
+		// own, which is placed behind the current block, such that the
+		// remaining space in the current block is not wasted.
+		size_t blocksize = (needed > arena->blocksize ? needed : arena->blocksize);
+		dc_arena_block_t *extra = (dc_arena_block_t *) malloc (offsetof (dc_arena_block_t, data) + blocksize);
+		if (extra == NULL)
+			return NULL;
+
+		extra->size = blocksize;
+		extra->used = 0;
+		if (block && blocksize > arena->blocksize) {
+			extra->next = block->next;
+			block->next = extra;
+		} else {
+			extra->next = block;
+			arena->blocks = extra;
+		}
+
+		block = extra;
+	}
+
+	unsigned char *ptr = dc_arena_block_data (block) + block->used + HEADER;
+	memcpy (ptr - HEADER, &size, sizeof (size));
+	block->used += needed;
+	arena->nbytes += size;
+
+	return ptr;
+}
+
+static void *
+dc_arena_malloc (void *userdata, size_t size)
+{
+	dc_arena_t *arena = (dc_arena_t *) userdata;
+
+	dc_mutex_lock (&arena->lock);
+	void *ptr = dc_arena_malloc_locked (arena, size);
+	dc_mutex_unlock (&arena->lock);
+
+	return ptr;
+}
+
+static void *
+dc_arena_realloc (void *userdata, void *ptr, size_t size)
+{
+	dc_arena_t *arena = (dc_arena_t *) userdata;
+	void *result = NULL;
+
+	if (ptr == NULL)
+		return dc_arena_malloc (userdata, size);
+
+	size_t oldsize = 0;
+	memcpy (&oldsize, (unsigned char *) ptr - HEADER, sizeof (oldsize));
+
+	dc_mutex_lock (&arena->lock);
+
+	// The most recent allocation of the current block can grow in place.
+	dc_arena_block_t *block = arena->blocks;
+	unsigned char *end = (unsigned char *) ptr + ALIGN(oldsize);
+	if (size <= oldsize) {
+		result = ptr;
+	} else if (block && end == dc_arena_block_data (block) + block->used &&
+		block->used - ALIGN(oldsize) + ALIGN(size) <= block->size) {
+		block->used = block->used - ALIGN(oldsize) + ALIGN(size);
+		arena->nbytes += size - oldsize;
+		memcpy ((unsigned char *) ptr - HEADER, &size, sizeof (size));
+		result = ptr;
+	} else {
+		result = dc_arena_malloc_locked (arena, size);
+		if (result)
+			memcpy (result, ptr, oldsize);
+	}
+
+	dc_mutex_unlock (&arena->lock);
+
+	return result;
+}
+
+dc_status_t
+dc_arena_get_allocator (dc_arena_t *arena, dc_allocator_t *allocator)
+{
+	if (arena == NULL || allocator == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	allocator->malloc = dc_arena_malloc;
+	allocator->realloc = dc_arena_realloc;
+	allocator->free = NULL;
+	allocator->userdata = arena;
+
+	return DC_STATUS_SUCCESS;
+}
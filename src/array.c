@@ -52,10 +52,108 @@ array_reverse_bits (unsigned char data[], unsigned int size)
 }
 
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARRAY_SSE2
+#include <emmintrin.h>
+#define BLOCKSIZE 16
+#endif
+
+#ifdef ARRAY_SSE2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static unsigned int
+array_ctz (unsigned int mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz (mask);
+#elif defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward (&index, mask);
+	return index;
+#else
+	unsigned int n = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static unsigned int
+array_bsr (unsigned int mask)
+{
+#if defined(__GNUC__)
+	return 31 - __builtin_clz (mask);
+#elif defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanReverse (&index, mask);
+	return index;
+#else
+	unsigned int n = 0;
+	while (mask >>= 1)
+		n++;
+	return n;
+#endif
+}
+
+/*
+ * Returns a bitmask with bit n set if a marker candidate starts at
+ * position n of the block. Both loads must be within the buffer.
+ */
+static unsigned int
+array_candidates (const unsigned char *data, unsigned int msize, __m128i first, __m128i last)
+{
+	__m128i a = _mm_loadu_si128 ((const __m128i *) data);
+	__m128i b = _mm_loadu_si128 ((const __m128i *) (data + msize - 1));
+	__m128i eq = _mm_and_si128 (_mm_cmpeq_epi8 (a, first), _mm_cmpeq_epi8 (b, last));
+	return (unsigned int) _mm_movemask_epi8 (eq);
+}
+#endif
+
+
 int
 array_isequal (const unsigned char data[], unsigned int size, unsigned char value)
 {
-	for (unsigned int i = 0; i < size; ++i) {
+	unsigned int i = 0;
+
+	// Most non-blank data is rejected on the first byte.
+	if (size && data[0] != value)
+		return 0;
+
+#ifdef ARRAY_SSE2
+	if (size >= BLOCKSIZE) {
+		const __m128i pattern = _mm_set1_epi8 ((char) value);
+		__m128i ne = _mm_setzero_si128 ();
+		for (; size - i >= 4 * BLOCKSIZE; i += 4 * BLOCKSIZE) {
+			__m128i a = _mm_loadu_si128 ((const __m128i *) (data + i + 0 * BLOCKSIZE));
+			__m128i b = _mm_loadu_si128 ((const __m128i *) (data + i + 1 * BLOCKSIZE));
+			__m128i c = _mm_loadu_si128 ((const __m128i *) (data + i + 2 * BLOCKSIZE));
+			__m128i d = _mm_loadu_si128 ((const __m128i *) (data + i + 3 * BLOCKSIZE));
+			ne = _mm_or_si128 (ne, _mm_or_si128 (
+				_mm_or_si128 (_mm_xor_si128 (a, pattern), _mm_xor_si128 (b, pattern)),
+				_mm_or_si128 (_mm_xor_si128 (c, pattern), _mm_xor_si128 (d, pattern))));
+			if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (ne, _mm_setzero_si128 ())) != 0xFFFF)
+				return 0;
+		}
+		for (; size - i >= BLOCKSIZE; i += BLOCKSIZE) {
+			__m128i a = _mm_loadu_si128 ((const __m128i *) (data + i));
+			ne = _mm_or_si128 (ne, _mm_xor_si128 (a, pattern));
+		}
+		// The final (possibly overlapping) block covers the tail.
+		if (i < size) {
+			__m128i a = _mm_loadu_si128 ((const __m128i *) (data + size - BLOCKSIZE));
+			ne = _mm_or_si128 (ne, _mm_xor_si128 (a, pattern));
+			i = size;
+		}
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (ne, _mm_setzero_si128 ())) != 0xFFFF)
+			return 0;
+	}
+#endif
+
+	for (; i < size; ++i) {
 		if (data[i] != value)
 			return 0;
 	}
@@ -64,17 +162,72 @@ array_isequal (const unsigned char data[], unsigned int size, unsigned char valu
 }
 
 
+/*
+ * Marker search engine.
+ *
+ * Candidate positions are located by comparing the first and the last byte
+ * of the marker against a whole block of input at once. Only the positions
+ * where both bytes match are verified with a full comparison. This skips
+ * over the bulk of the data (e.g. long runs of filler bytes that do not
+ * match the marker) without a memcmp call per byte.
+ */
+
+/*
+ * Returns the offset of the first occurrence of the marker at or after
+ * the start offset, or the size of the data if there is none.
+ */
+static unsigned int
+array_search_next (const unsigned char *data, unsigned int size,
+                   const unsigned char *marker, unsigned int msize,
+                   unsigned int start)
+{
+	if (msize == 0)
+		return start;
+
+	if (size < msize)
+		return size;
+
+	// Last offset where the marker can start.
+	unsigned int end = size - msize;
+	unsigned int i = start;
+
+#ifdef ARRAY_SSE2
+	const __m128i first = _mm_set1_epi8 ((char) marker[0]);
+	const __m128i last = _mm_set1_epi8 ((char) marker[msize - 1]);
+	while (i <= end && end - i >= BLOCKSIZE - 1) {
+		unsigned int mask = array_candidates (data + i, msize, first, last);
+		while (mask) {
+			unsigned int n = i + array_ctz (mask);
+			if (memcmp (data + n, marker, msize) == 0)
+				return n;
+			mask &= mask - 1;
+		}
+		i += BLOCKSIZE;
+	}
+#endif
+
+	while (i <= end) {
+		if (data[i] == marker[0] && memcmp (data + i, marker, msize) == 0)
+			return i;
+		i++;
+	}
+
+	return size;
+}
+
+
 const unsigned char *
 array_search_forward (const unsigned char *data, unsigned int size,
                       const unsigned char *marker, unsigned int msize)
 {
-	while (size >= msize) {
-		if (memcmp (data, marker, msize) == 0)
-			return data;
-		size--;
-		data++;
-	}
-	return NULL;
+	if (size < msize)
+		return NULL;
+
+	unsigned int offset = array_search_next (data, size, marker, msize, 0);
+	if (offset >= size && msize != 0)
+		return NULL;
+
+	return data + offset;
 }
 
 
@@ -82,17 +235,162 @@ const unsigned char *
 array_search_backward (const unsigned char *data, unsigned int size,
                        const unsigned char *marker, unsigned int msize)
 {
-	data += size;
-	while (size >= msize) {
-		if (memcmp (data - msize, marker, msize) == 0)
-			return data;
-		size--;
-		data--;
+	if (size < msize)
+		return NULL;
+
+	if (msize == 0)
+		return data + size;
+
+	// Number of offsets where the marker can start.
+	unsigned int n = size - msize + 1;
+
+#ifdef ARRAY_SSE2
+	const __m128i first = _mm_set1_epi8 ((char) marker[0]);
+	const __m128i last = _mm_set1_epi8 ((char) marker[msize - 1]);
+	while (n >= BLOCKSIZE) {
+		unsigned int i = n - BLOCKSIZE;
+		unsigned int mask = array_candidates (data + i, msize, first, last);
+		while (mask) {
+			unsigned int bit = array_bsr (mask);
+			if (memcmp (data + i + bit, marker, msize) == 0)
+				return data + i + bit + msize;
+			mask &= ~(1u << bit);
+		}
+		n = i;
+	}
+#endif
+
+	while (n--) {
+		if (data[n] == marker[0] && memcmp (data + n, marker, msize) == 0)
+			return data + n + msize;
 	}
+
 	return NULL;
 }
 
 
+unsigned int
+array_search_all (const unsigned char *data, unsigned int size,
+                  const unsigned char *marker, unsigned int msize,
+                  unsigned int offsets[], unsigned int count)
+{
+	unsigned int nmatches = 0;
+
+	if (msize == 0 || size < msize)
+		return 0;
+
+	unsigned int offset = array_search_next (data, size, marker, msize, 0);
+	while (offset < size) {
+		if (nmatches < count)
+			offsets[nmatches] = offset;
+		nmatches++;
+
+		offset = array_search_next (data, size, marker, msize, offset + 1);
+	}
+
+	return nmatches;
+}
+
+
+/*
+ * Hexadecimal codec.
+ *
+ * The vectorized kernels convert 16 bytes of binary data per iteration.
+ * The remaining bytes, and platforms without SIMD support, are handled
+ * with a lookup table instead of a chain of range checks per nibble.
+ * The table maps every valid character to 0x10 plus its value, and
+ * everything else to zero. It is spelled out in full, because the MSVC
+ * project compiles the library as C++, which has no array designators.
+ */
+
+static const unsigned char hex2nibble[256] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+#ifdef ARRAY_SSE2
+/*
+ * Converts 32 hexadecimal characters into 16 bytes. Returns zero if all
+ * characters are valid, or a non-zero value otherwise.
+ */
+static int
+array_hex2bin_block (const unsigned char input[], unsigned char output[])
+{
+	const __m128i bias = _mm_set1_epi8 ((char) 0x80);
+	const __m128i lowercase = _mm_set1_epi8 (0x20);
+	const __m128i mask = _mm_set1_epi16 (0x00FF);
+
+	__m128i nibbles[2];
+	__m128i invalid = _mm_setzero_si128 ();
+	for (unsigned int i = 0; i < 2; ++i) {
+		__m128i c = _mm_loadu_si128 ((const __m128i *) (input + i * 16));
+
+		// Decimal digits: '0' to '9'.
+		__m128i digit = _mm_sub_epi8 (c, _mm_set1_epi8 ('0'));
+		__m128i isdigit = _mm_cmplt_epi8 (_mm_xor_si128 (digit, bias), _mm_set1_epi8 ((char) (0x80 + 10)));
+
+		// Letters: 'A' to 'F' and 'a' to 'f'.
+		__m128i letter = _mm_sub_epi8 (_mm_or_si128 (c, lowercase), _mm_set1_epi8 ('a'));
+		__m128i isletter = _mm_cmplt_epi8 (_mm_xor_si128 (letter, bias), _mm_set1_epi8 ((char) (0x80 + 6)));
+
+		nibbles[i] = _mm_or_si128 (
+			_mm_and_si128 (isdigit, digit),
+			_mm_and_si128 (isletter, _mm_add_epi8 (letter, _mm_set1_epi8 (10))));
+		invalid = _mm_or_si128 (invalid, _mm_andnot_si128 (_mm_or_si128 (isdigit, isletter), _mm_set1_epi8 ((char) 0xFF)));
+	}
+
+	// Combine each pair of nibbles into a byte. The first character of
+	// each pair ends up in the low byte of a 16 bit lane.
+	__m128i lo = _mm_or_si128 (
+		_mm_slli_epi16 (_mm_and_si128 (nibbles[0], mask), 4),
+		_mm_srli_epi16 (nibbles[0], 8));
+	__m128i hi = _mm_or_si128 (
+		_mm_slli_epi16 (_mm_and_si128 (nibbles[1], mask), 4),
+		_mm_srli_epi16 (nibbles[1], 8));
+	_mm_storeu_si128 ((__m128i *) output, _mm_packus_epi16 (lo, hi));
+
+	return _mm_movemask_epi8 (invalid);
+}
+
+/*
+ * Converts 16 bytes into 32 hexadecimal characters.
+ */
+static void
+array_bin2hex_block (const unsigned char input[], unsigned char output[])
+{
+	const __m128i mask = _mm_set1_epi8 (0x0F);
+	const __m128i nine = _mm_set1_epi8 (9);
+	const __m128i offset = _mm_set1_epi8 ('A' - '0' - 10);
+
+	__m128i v = _mm_loadu_si128 ((const __m128i *) input);
+	__m128i msn = _mm_and_si128 (_mm_srli_epi16 (v, 4), mask);
+	__m128i lsn = _mm_and_si128 (v, mask);
+
+	msn = _mm_add_epi8 (_mm_add_epi8 (msn, _mm_set1_epi8 ('0')),
+		_mm_and_si128 (_mm_cmpgt_epi8 (msn, nine), offset));
+	lsn = _mm_add_epi8 (_mm_add_epi8 (lsn, _mm_set1_epi8 ('0')),
+		_mm_and_si128 (_mm_cmpgt_epi8 (lsn, nine), offset));
+
+	_mm_storeu_si128 ((__m128i *) output, _mm_unpacklo_epi8 (msn, lsn));
+	_mm_storeu_si128 ((__m128i *) (output + 16), _mm_unpackhi_epi8 (msn, lsn));
+}
+#endif
+
+
 int
 array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize)
 {
@@ -103,7 +401,15 @@ array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned
 		'0', '1', '2', '3', '4', '5', '6', '7',
 		'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
 
-	for (unsigned int i = 0; i < isize; ++i) {
+	unsigned int i = 0;
+
+#ifdef ARRAY_SSE2
+	for (; isize - i >= BLOCKSIZE; i += BLOCKSIZE) {
+		array_bin2hex_block (input + i, output + i * 2);
+	}
+#endif
+
+	for (; i < isize; ++i) {
 		// Set the most-significant nibble.
 		unsigned char msn = (input[i] >> 4) & 0x0F;
 		output[i * 2 + 0] = ascii[msn];
@@ -123,24 +429,22 @@ array_convert_hex2bin (const unsigned char input[], unsigned int isize, unsigned
 	if (isize != 2 * osize)
 		return -1;
 
-	for (unsigned int i = 0; i < osize; ++i) {
-		unsigned char value = 0;
-		for (unsigned int j = 0; j < 2; ++j) {
-			unsigned char number = 0;
-			unsigned char ascii = input[i * 2 + j];
-			if (ascii >= '0' && ascii <= '9')
-				number = ascii - '0';
-			else if (ascii >= 'A' && ascii <= 'F')
-				number = 10 + ascii - 'A';
-			else if (ascii >= 'a' && ascii <= 'f')
-				number = 10 + ascii - 'a';
-			else
-				return -1; /* Invalid character */
-
-			value <<= 4;
-			value += number;
-		}
-		output[i] = value;
+	unsigned int i = 0;
+
+#ifdef ARRAY_SSE2
+	for (; osize - i >= BLOCKSIZE; i += BLOCKSIZE) {
+		if (array_hex2bin_block (input + i * 2, output + i) != 0)
+			return -1; /* Invalid character */
+	}
+#endif
+
+	for (; i < osize; ++i) {
+		unsigned char msn = hex2nibble[input[i * 2 + 0]];
+		unsigned char lsn = hex2nibble[input[i * 2 + 1]];
+		if (msn == 0 || lsn == 0)
+			return -1; /* Invalid character */
+
+		output[i] = ((msn & 0x0F) << 4) | (lsn & 0x0F);
 	}
 
 	return 0;
@@ -184,65 +488,6 @@ array_uint_le (const unsigned char data[], unsigned int n)
 	return value;
 }
 
-unsigned int
-array_uint32_be (const unsigned char data[])
-{
-	return (data[0] << 24) + (data[1] << 16) + (data[2] << 8) + data[3];
-}
-
-
-unsigned int
-array_uint32_le (const unsigned char data[])
-{
-	return data[0] + (data[1] << 8) + (data[2] << 16) + (data[3] << 24);
-}
-
-
-void
-array_uint32_le_set (unsigned char data[], const unsigned int input)
-{
-	data[0] = input & 0xFF;
-	data[1] = (input >>  8) & 0xFF;
-	data[2] = (input >> 16) & 0xFF;
-	data[3] = (input >> 24) & 0xFF;
-}
-
-
-unsigned int
-array_uint24_be (const unsigned char data[])
-{
-	return (data[0] << 16) + (data[1] << 8) + data[2];
-}
-
-
-void
-array_uint24_be_set (unsigned char data[], const unsigned int input)
-{
-	data[0] = (input >> 16) & 0xFF;
-	data[1] = (input >>  8) & 0xFF;
-	data[2] = input & 0xFF;
-}
-
-
-unsigned int
-array_uint24_le (const unsigned char data[])
-{
-	return data[0] + (data[1] << 8) + (data[2] << 16);
-}
-
-unsigned short
-array_uint16_be (const unsigned char data[])
-{
-	return (data[0] << 8) + data[1];
-}
-
-
-unsigned short
-array_uint16_le (const unsigned char data[])
-{
-	return data[0] + (data[1] << 8);
-}
-
 unsigned char
 bcd2dec (unsigned char value)
 {
@@ -22,6 +22,13 @@
 #ifndef ARRAY_H
 #define ARRAY_H
 
+#include <string.h> // memcpy
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define inline __inline
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -43,6 +50,11 @@ const unsigned char *
 array_search_backward (const unsigned char *data, unsigned int size,
                        const unsigned char *marker, unsigned int msize);
 
+unsigned int
+array_search_all (const unsigned char *data, unsigned int size,
+                  const unsigned char *marker, unsigned int msize,
+                  unsigned int offsets[], unsigned int count);
+
 int
 array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize);
 
@@ -58,29 +70,107 @@ array_uint_be (const unsigned char data[], unsigned int n);
 unsigned int
 array_uint_le (const unsigned char data[], unsigned int n);
 
-unsigned int
-array_uint32_be (const unsigned char data[]);
+/*
+ * Fixed width integer accessors.
+ *
+ * These are on the hot path of every parser, and are therefore inlined.
+ * With GCC and Clang, the value is fetched with a single unaligned load
+ * (through memcpy) and byte swapped if necessary. Other compilers get the
+ * portable byte by byte version, which most of them turn into the same
+ * code anyway.
+ */
 
-unsigned int
-array_uint32_le (const unsigned char data[]);
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && defined(__ORDER_BIG_ENDIAN__)
+#define ARRAY_UNALIGNED
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ARRAY_LE16(x) (x)
+#define ARRAY_LE32(x) (x)
+#define ARRAY_BE16(x) __builtin_bswap16 (x)
+#define ARRAY_BE32(x) __builtin_bswap32 (x)
+#else
+#define ARRAY_LE16(x) __builtin_bswap16 (x)
+#define ARRAY_LE32(x) __builtin_bswap32 (x)
+#define ARRAY_BE16(x) (x)
+#define ARRAY_BE32(x) (x)
+#endif
+#endif
+
+static inline unsigned int
+array_uint32_be (const unsigned char data[])
+{
+#ifdef ARRAY_UNALIGNED
+	uint32_t value;
+	memcpy (&value, data, sizeof (value));
+	return ARRAY_BE32 (value);
+#else
+	return ((unsigned int) data[0] << 24) + (data[1] << 16) + (data[2] << 8) + data[3];
+#endif
+}
 
-void
-array_uint32_le_set (unsigned char data[], const unsigned int input);
+static inline unsigned int
+array_uint32_le (const unsigned char data[])
+{
+#ifdef ARRAY_UNALIGNED
+	uint32_t value;
+	memcpy (&value, data, sizeof (value));
+	return ARRAY_LE32 (value);
+#else
+	return data[0] + (data[1] << 8) + (data[2] << 16) + ((unsigned int) data[3] << 24);
+#endif
+}
 
-unsigned int
-array_uint24_be (const unsigned char data[]);
+static inline void
+array_uint32_le_set (unsigned char data[], const unsigned int input)
+{
+	data[0] = input & 0xFF;
+	data[1] = (input >>  8) & 0xFF;
+	data[2] = (input >> 16) & 0xFF;
+	data[3] = (input >> 24) & 0xFF;
+}
 
-void
-array_uint24_be_set (unsigned char data[], const unsigned int input);
+static inline unsigned int
+array_uint24_be (const unsigned char data[])
+{
+	return (data[0] << 16) + (data[1] << 8) + data[2];
+}
 
-unsigned int
-array_uint24_le (const unsigned char data[]);
+static inline void
+array_uint24_be_set (unsigned char data[], const unsigned int input)
+{
+	data[0] = (input >> 16) & 0xFF;
+	data[1] = (input >>  8) & 0xFF;
+	data[2] = input & 0xFF;
+}
 
-unsigned short
-array_uint16_be (const unsigned char data[]);
+static inline unsigned int
+array_uint24_le (const unsigned char data[])
+{
+	return data[0] + (data[1] << 8) + (data[2] << 16);
+}
 
-unsigned short
-array_uint16_le (const unsigned char data[]);
+static inline unsigned short
+array_uint16_be (const unsigned char data[])
+{
+#ifdef ARRAY_UNALIGNED
+	uint16_t value;
+	memcpy (&value, data, sizeof (value));
+	return ARRAY_BE16 (value);
+#else
+	return (data[0] << 8) + data[1];
+#endif
+}
+
+static inline unsigned short
+array_uint16_le (const unsigned char data[])
+{
+#ifdef ARRAY_UNALIGNED
+	uint16_t value;
+	memcpy (&value, data, sizeof (value));
+	return ARRAY_LE16 (value);
+#else
+	return data[0] + (data[1] << 8);
+#endif
+}
 
 unsigned char
 bcd2dec (unsigned char value);
@@ -39,6 +39,7 @@
 #include "device-private.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &atomics_cobalt_device_vtable)
 
@@ -374,7 +375,7 @@ atomics_cobalt_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	// Allocate a memory buffer.
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -0,0 +1,107 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include "blank.h"
+#include "context-private.h"
+#include "array.h"
+
+/*
+ * The blank index divides a memory area into fixed size records, and
+ * marks the records that contain only filler bytes (0x00 and/or 0xFF).
+ * For every record, the index of the next non-blank record is stored,
+ * such that a whole range of empty records can be skipped in a single
+ * step. The index is built with a single pass over the data.
+ */
+
+struct blank_index_t {
+	dc_context_t *context;
+	unsigned int recordsize;
+	unsigned int count;
+	unsigned int *next;
+};
+
+blank_index_t *
+blank_index_new (dc_context_t *context, const unsigned char data[], unsigned int size, unsigned int recordsize, unsigned int flags)
+{
+	if (recordsize == 0)
+		return NULL;
+
+	blank_index_t *index = (blank_index_t *) dc_context_alloc (context, sizeof (blank_index_t));
+	if (index == NULL)
+		return NULL;
+
+	index->context = context;
+	index->recordsize = recordsize;
+	index->count = size / recordsize;
+	index->next = (unsigned int *) dc_context_alloc (context, (index->count + 1) * sizeof (unsigned int));
+	if (index->next == NULL) {
+		dc_context_dealloc (context, index);
+		return NULL;
+	}
+
+	// Walk the records backwards, such that every blank record
+	// inherits the next non-blank record of its successor.
+	index->next[index->count] = index->count;
+	for (unsigned int i = index->count; i-- > 0; ) {
+		const unsigned char *record = data + i * recordsize;
+		if (((flags & BLANK_00) && array_isequal (record, recordsize, 0x00)) ||
+			((flags & BLANK_FF) && array_isequal (record, recordsize, 0xFF))) {
+			index->next[i] = index->next[i + 1];
+		} else {
+			index->next[i] = i;
+		}
+	}
+
+	return index;
+}
+
+
+void
+blank_index_free (blank_index_t *index)
+{
+	if (index == NULL)
+		return;
+
+	dc_context_dealloc (index->context, index->next);
+	dc_context_dealloc (index->context, index);
+}
+
+
+int
+blank_index_isblank (const blank_index_t *index, unsigned int offset)
+{
+	unsigned int i = offset / index->recordsize;
+	if (i >= index->count)
+		return 0;
+
+	return index->next[i] != i;
+}
+
+
+unsigned int
+blank_index_next (const blank_index_t *index, unsigned int offset)
+{
+	unsigned int i = offset / index->recordsize;
+	if (i >= index->count)
+		return offset;
+
+	return offset + (index->next[i] - i) * index->recordsize;
+}
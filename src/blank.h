@@ -0,0 +1,51 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef BLANK_H
+#define BLANK_H
+
+#include <libdivecomputer/context.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define BLANK_00 0x01
+#define BLANK_FF 0x02
+
+typedef struct blank_index_t blank_index_t;
+
+blank_index_t *
+blank_index_new (dc_context_t *context, const unsigned char data[], unsigned int size, unsigned int recordsize, unsigned int flags);
+
+void
+blank_index_free (blank_index_t *index);
+
+int
+blank_index_isblank (const blank_index_t *index, unsigned int offset);
+
+unsigned int
+blank_index_next (const blank_index_t *index, unsigned int offset);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* BLANK_H */
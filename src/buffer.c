@@ -19,51 +19,178 @@
  * MA 02110-1301 USA
  */
 
-#include <stdlib.h> // malloc, realloc, free
 #include <string.h> // memcpy, memmove
 
 #include <libdivecomputer/buffer.h>
 
+#include "buffer-private.h"
+#include "context-private.h"
+#include "thread.h"
+
+/*
+ * The storage that is shared between a buffer and its views. It is only
+ * allocated when the first view is created, and released together with
+ * the data once the last reference is gone. The reference count is
+ * updated atomically, such that a view can be released from another
+ * thread than the one that uses the original buffer.
+ */
+typedef struct dc_buffer_shared_t {
+	unsigned char *data;
+	volatile long refcount;
+} dc_buffer_shared_t;
+
 struct dc_buffer_t {
+	dc_context_t *context;
 	unsigned char *data;
 	size_t capacity, offset, size;
+	dc_buffer_shared_t *shared;
+	unsigned int readonly;
 };
 
 dc_buffer_t *
 dc_buffer_new (size_t capacity)
 {
-	dc_buffer_t *buffer = (dc_buffer_t *) malloc (sizeof (dc_buffer_t));
+	return dc_buffer_allocate (NULL, capacity);
+}
+
+
+dc_buffer_t *
+dc_buffer_allocate (dc_context_t *context, size_t capacity)
+{
+	dc_buffer_t *buffer = (dc_buffer_t *) dc_context_alloc (context, sizeof (dc_buffer_t));
 	if (buffer == NULL)
 		return NULL;
 
 	if (capacity) {
-		buffer->data = (unsigned char *) malloc (capacity);
+		buffer->data = (unsigned char *) dc_context_alloc (context, capacity);
 		if (buffer->data == NULL) {
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return NULL;
 		}
 	} else {
 		buffer->data = NULL;
 	}
 
+	buffer->context = context;
 	buffer->capacity = capacity;
 	buffer->offset = 0;
 	buffer->size = 0;
+	buffer->shared = NULL;
+	buffer->readonly = 0;
 
 	return buffer;
 }
 
 
+dc_buffer_t *
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size)
+{
+	if (buffer == NULL)
+		return NULL;
+
+	if (offset + size > buffer->size)
+		return NULL;
+
+	// Move the data to the shared storage.
+	if (buffer->shared == NULL) {
+		buffer->shared = (dc_buffer_shared_t *) dc_context_alloc (buffer->context, sizeof (dc_buffer_shared_t));
+		if (buffer->shared == NULL)
+			return NULL;
+
+		buffer->shared->data = buffer->data;
+		buffer->shared->refcount = 1;
+	}
+
+	dc_buffer_t *view = (dc_buffer_t *) dc_context_alloc (buffer->context, sizeof (dc_buffer_t));
+	if (view == NULL)
+		return NULL;
+
+	view->context = buffer->context;
+	view->data = buffer->data;
+	view->capacity = buffer->capacity;
+	view->offset = buffer->offset + offset;
+	view->size = size;
+	view->shared = buffer->shared;
+	view->readonly = 1;
+
+	dc_atomic_add (&buffer->shared->refcount, 1);
+
+	return view;
+}
+
+
+static void
+dc_buffer_release (dc_buffer_t *buffer)
+{
+	if (buffer->shared) {
+		if (dc_atomic_add (&buffer->shared->refcount, -1) == 0) {
+			dc_context_dealloc (buffer->context, buffer->shared->data);
+			dc_context_dealloc (buffer->context, buffer->shared);
+		}
+	} else if (buffer->data) {
+		dc_context_dealloc (buffer->context, buffer->data);
+	}
+}
+
+
+/*
+ * Make sure the buffer is the only owner of its data before it gets
+ * modified. If there are still other references, the data is copied, and
+ * the other buffers keep the original contents. A view only copies its
+ * own part, and becomes an ordinary buffer afterwards.
+ */
+static int
+dc_buffer_unshare (dc_buffer_t *buffer)
+{
+	dc_buffer_shared_t *shared = buffer->shared;
+	if (shared == NULL)
+		return 1;
+
+	if (dc_atomic_add (&shared->refcount, 0) == 1) {
+		dc_context_dealloc (buffer->context, shared);
+		buffer->shared = NULL;
+		buffer->readonly = 0;
+		return 1;
+	}
+
+	size_t capacity = buffer->readonly ? buffer->size : buffer->capacity;
+	size_t offset = buffer->readonly ? 0 : buffer->offset;
+
+	unsigned char *data = NULL;
+	if (capacity) {
+		data = (unsigned char *) dc_context_alloc (buffer->context, capacity);
+		if (data == NULL)
+			return 0;
+	}
+
+	if (buffer->size)
+		memcpy (data + offset, buffer->data + buffer->offset, buffer->size);
+
+	// The last other reference may have been released in the meantime.
+	if (dc_atomic_add (&shared->refcount, -1) == 0) {
+		dc_context_dealloc (buffer->context, shared->data);
+		dc_context_dealloc (buffer->context, shared);
+	}
+
+	buffer->shared = NULL;
+	buffer->readonly = 0;
+	buffer->data = data;
+	buffer->capacity = capacity;
+	buffer->offset = offset;
+
+	return 1;
+}
+
+
 void
 dc_buffer_free (dc_buffer_t *buffer)
 {
 	if (buffer == NULL)
 		return;
 
-	if (buffer->data)
-		free (buffer->data);
+	dc_buffer_release (buffer);
 
-	free (buffer);
+	dc_context_dealloc (buffer->context, buffer);
 }
 
 
@@ -95,18 +222,21 @@ dc_buffer_expand_calc (dc_buffer_t *buffer, size_t n)
 static int
 dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 {
+	if (!dc_buffer_unshare (buffer))
+		return 0;
+
 	if (n > buffer->capacity - buffer->offset) {
 		if (n > buffer->capacity) {
 			size_t capacity = dc_buffer_expand_calc (buffer, n);
 
-			unsigned char *data = (unsigned char *) malloc (capacity);
+			unsigned char *data = (unsigned char *) dc_context_alloc (buffer->context, capacity);
 			if (data == NULL)
 				return 0;
 
 			if (buffer->size)
 				memcpy (data, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			dc_context_dealloc (buffer->context, buffer->data);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -126,20 +256,23 @@ dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 static int
 dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 {
+	if (!dc_buffer_unshare (buffer))
+		return 0;
+
 	size_t available = buffer->capacity - buffer->size;
 
 	if (n > buffer->offset + buffer->size) {
 		if (n > buffer->capacity) {
 			size_t capacity = dc_buffer_expand_calc (buffer, n);
 
-			unsigned char *data = (unsigned char *) malloc (capacity);
+			unsigned char *data = (unsigned char *) dc_context_alloc (buffer->context, capacity);
 			if (data == NULL)
 				return 0;
 
 			if (buffer->size)
 				memcpy (data + capacity - buffer->size, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			dc_context_dealloc (buffer->context, buffer->data);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
@@ -165,7 +298,10 @@ dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity)
 	if (capacity <= buffer->capacity)
 		return 1;
 
-	unsigned char *data = (unsigned char *) realloc (buffer->data, capacity);
+	if (!dc_buffer_unshare (buffer))
+		return 0;
+
+	unsigned char *data = (unsigned char *) dc_context_realloc (buffer->context, buffer->data, capacity);
 	if (data == NULL)
 		return 0;
 
@@ -259,6 +395,20 @@ dc_buffer_get_size (dc_buffer_t *buffer)
 
 unsigned char *
 dc_buffer_get_data (dc_buffer_t *buffer)
+{
+	if (buffer == NULL)
+		return NULL;
+
+	// The caller may write through the pointer.
+	if (!dc_buffer_unshare (buffer))
+		return NULL;
+
+	return buffer->size ? buffer->data + buffer->offset : NULL;
+}
+
+
+const unsigned char *
+dc_buffer_get_const_data (dc_buffer_t *buffer)
 {
 	if (buffer == NULL)
 		return NULL;
@@ -41,6 +41,56 @@ checksum_xor_uint8 (const unsigned char data[], unsigned int size, unsigned char
 unsigned short
 checksum_crc_ccitt_uint16 (const unsigned char data[], unsigned int size);
 
+/*
+ * Incremental checksum contexts.
+ *
+ * The checksum is calculated over a sequence of update calls, such that
+ * the data can be verified chunk by chunk while it is being received.
+ * The result is identical to the corresponding one-shot function.
+ */
+
+typedef struct checksum_add_t {
+	unsigned short value;
+} checksum_add_t;
+
+void
+checksum_add_init (checksum_add_t *ctx, unsigned short init);
+
+void
+checksum_add_update (checksum_add_t *ctx, const unsigned char data[], unsigned int size);
+
+unsigned char
+checksum_add_final_uint8 (const checksum_add_t *ctx);
+
+unsigned short
+checksum_add_final_uint16 (const checksum_add_t *ctx);
+
+typedef struct checksum_xor_t {
+	unsigned char value;
+} checksum_xor_t;
+
+void
+checksum_xor_init (checksum_xor_t *ctx, unsigned char init);
+
+void
+checksum_xor_update (checksum_xor_t *ctx, const unsigned char data[], unsigned int size);
+
+unsigned char
+checksum_xor_final_uint8 (const checksum_xor_t *ctx);
+
+typedef struct checksum_crc_ccitt_t {
+	unsigned short value;
+} checksum_crc_ccitt_t;
+
+void
+checksum_crc_ccitt_init (checksum_crc_ccitt_t *ctx);
+
+void
+checksum_crc_ccitt_update (checksum_crc_ccitt_t *ctx, const unsigned char data[], unsigned int size);
+
+unsigned short
+checksum_crc_ccitt_final_uint16 (const checksum_crc_ccitt_t *ctx);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
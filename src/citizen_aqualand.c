@@ -30,6 +30,7 @@
 #include "checksum.h"
 #include "ringbuffer.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &citizen_aqualand_device_vtable)
 
@@ -211,7 +212,7 @@ citizen_aqualand_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 {
 	citizen_aqualand_device_t *device = (citizen_aqualand_device_t *) abstract;
 
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
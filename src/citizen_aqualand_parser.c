@@ -154,7 +154,7 @@ citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 	unsigned int maxcount = (2 * (size - SZ_HEADER) + 2) / 3;
 
 	// Allocate storage for the processed 16 bit samples.
-	unsigned short *samples = (unsigned short *) malloc(maxcount * sizeof(unsigned short));
+	unsigned short *samples = (unsigned short *) dc_context_alloc (abstract->context, maxcount * sizeof(unsigned short));
 	if (samples == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
@@ -204,7 +204,7 @@ citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 		// Verify the end marker.
 		if (offset + 2 > length || data[offset / 2] != marker) {
 			ERROR (abstract->context, "No end marker found.");
-			free(samples);
+			dc_context_dealloc (abstract->context, samples);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -261,7 +261,7 @@ citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 		}
 	}
 
-	free(samples);
+	dc_context_dealloc (abstract->context, samples);
 
 	return DC_STATUS_SUCCESS;
 }
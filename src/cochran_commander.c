@@ -571,7 +571,7 @@ cochran_commander_read_all (cochran_commander_device_t *device, cochran_data_t *
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Allocate space for log book.
-	data->logbook = (unsigned char *) malloc(data->logbook_size);
+	data->logbook = (unsigned char *) dc_context_alloc (device->base.context, data->logbook_size);
 	if (data->logbook == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -590,7 +590,7 @@ cochran_commander_read_all (cochran_commander_device_t *device, cochran_data_t *
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	if (data->sample_size > 0) {
-		data->sample = (unsigned char *) malloc(data->sample_size);
+		data->sample = (unsigned char *) dc_context_alloc (device->base.context, data->sample_size);
 		if (data->sample == NULL) {
 			ERROR (abstract->context, "Failed to allocate memory.");
 			return DC_STATUS_NOMEMORY;
@@ -850,7 +850,7 @@ cochran_commander_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 
 		// Build dive blob
 		unsigned int dive_size = device->layout->rb_logbook_entry_size + sample_size;
-		unsigned char *dive = (unsigned char *) malloc(dive_size);
+		unsigned char *dive = (unsigned char *) dc_context_alloc (abstract->context, dive_size);
 		if (dive == NULL) {
 			status = DC_STATUS_NOMEMORY;
 			goto error;
@@ -873,15 +873,15 @@ cochran_commander_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 		}
 
 		if (callback && !callback (dive, dive_size, dive, sizeof(device->fingerprint), userdata)) {
-			free(dive);
+			dc_context_dealloc (abstract->context, dive);
 			break;
 		}
 
-		free(dive);
+		dc_context_dealloc (abstract->context, dive);
 	}
 
 error:
-	free(data.logbook);
-	free(data.sample);
+	dc_context_dealloc (abstract->context, data.logbook);
+	dc_context_dealloc (abstract->context, data.sample);
 	return status;
 }
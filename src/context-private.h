@@ -72,9 +72,66 @@ dc_context_syserror (dc_context_t *context, dc_loglevel_t loglevel, const char *
 dc_status_t
 dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *prefix, const unsigned char data[], unsigned int size);
 
+/*
+ * Create a context with the same log, allocator and clock settings as the
+ * parent context, for use on another thread. The log messages are still
+ * delivered through the log function of the parent, but with the cloned
+ * context as argument. Custom transports and link parameters are not
+ * shared.
+ */
+dc_status_t
+dc_context_clone (dc_context_t **context, dc_context_t *parent);
+
 dc_custom_serial_t*
 _dc_context_custom_serial (dc_context_t *context);
 
+dc_custom_transport_t*
+_dc_context_custom_transport (dc_context_t *context);
+
+/*
+ * Memory allocation through the allocator of the context. A NULL context
+ * uses the system allocator.
+ */
+void *
+dc_context_alloc (dc_context_t *context, size_t size);
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size);
+
+void
+dc_context_dealloc (dc_context_t *context, void *ptr);
+
+char *
+dc_context_strdup (dc_context_t *context, const char *str);
+
+/*
+ * Time functions through the clock of the context. A NULL context, or a
+ * context without a custom clock, uses the system clock. The monotonic
+ * time is in microseconds.
+ */
+unsigned long long
+dc_context_monotonic (dc_context_t *context);
+
+void
+dc_context_sleep (dc_context_t *context, unsigned int milliseconds);
+
+dc_ticks_t
+dc_context_now (dc_context_t *context);
+
+/*
+ * The link parameters that were negotiated with a device on a particular
+ * interface, such that the next connection can try them first. The
+ * entries are kept per device serial number. Before the device has been
+ * identified, a zero serial number returns the entry of the device that
+ * was used most recently on the interface. A zero baudrate indicates
+ * there is no cached value.
+ */
+unsigned int
+dc_context_get_baudrate (dc_context_t *context, dc_family_t family, const char *name, unsigned int serial);
+
+void
+dc_context_set_baudrate (dc_context_t *context, dc_family_t family, const char *name, unsigned int serial, unsigned int baudrate);
+
 #define RETURN_IF_CUSTOM_SERIAL(context, block, function, ...)	\
 	do { \
 		dc_custom_serial_t *c = _dc_context_custom_serial(context); \
@@ -29,16 +29,31 @@
 #include <windows.h>
 #else
 #include <sys/time.h>
+#include <time.h>
+#include <errno.h>
 #endif
 
 #include "context-private.h"
+#include "thread.h"
 #include <libdivecomputer/custom_serial.h>
 
+#define NLINKS 8
+
+typedef struct dc_context_link_t {
+	dc_family_t family;
+	char name[64];
+	unsigned int serial;
+	unsigned int baudrate;
+	unsigned int sequence;
+} dc_context_link_t;
+
 struct dc_context_t {
 	dc_loglevel_t loglevel;
 	dc_logfunc_t logfunc;
 	void *userdata;
 #ifdef ENABLE_LOGGING
+	/* Serializes the log messages of a transfer thread with the rest. */
+	dc_mutex_t lock;
 	char msg[8192 + 32];
 #ifdef _WIN32
 	LARGE_INTEGER timestamp, frequency;
@@ -47,6 +62,14 @@ struct dc_context_t {
 #endif
 #endif
 	dc_custom_serial_t *custom_serial;
+	dc_custom_transport_t *custom_transport;
+	dc_allocator_t allocator;
+	/* Number of blocks allocated through the allocator, and not released. */
+	volatile long nallocs;
+	dc_clock_t clock;
+	dc_context_link_t links[NLINKS];
+	unsigned int nlinks;
+	unsigned int sequence;
 };
 
 #ifdef ENABLE_LOGGING
@@ -188,6 +211,7 @@ dc_context_new (dc_context_t **out)
 	context->userdata = NULL;
 
 #ifdef ENABLE_LOGGING
+	dc_mutex_init (&context->lock);
 	memset (context->msg, 0, sizeof (context->msg));
 #ifdef _WIN32
 	QueryPerformanceFrequency(&context->frequency);
@@ -198,15 +222,51 @@ dc_context_new (dc_context_t **out)
 #endif
 
 	context->custom_serial = NULL;
+	context->custom_transport = NULL;
+
+	memset (&context->allocator, 0, sizeof (context->allocator));
+	context->nallocs = 0;
+	memset (&context->clock, 0, sizeof (context->clock));
+
+	memset (context->links, 0, sizeof (context->links));
+	context->nlinks = 0;
+	context->sequence = 0;
 
 	*out = context;
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_clone (dc_context_t **out, dc_context_t *parent)
+{
+	dc_status_t status = dc_context_new (out);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	dc_context_t *context = *out;
+
+	if (parent) {
+		context->loglevel = parent->loglevel;
+		context->logfunc = parent->logfunc;
+		context->userdata = parent->userdata;
+		context->allocator = parent->allocator;
+		context->clock = parent->clock;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_context_free (dc_context_t *context)
 {
+	if (context == NULL)
+		return DC_STATUS_SUCCESS;
+
+#ifdef ENABLE_LOGGING
+	dc_mutex_free (&context->lock);
+#endif
+
 	free (context);
 
 	return DC_STATUS_SUCCESS;
@@ -219,16 +279,283 @@ dc_context_set_custom_serial (dc_context_t *context, dc_custom_serial_t *custom_
 		return DC_STATUS_INVALIDARGS;
 
 	context->custom_serial = custom_serial;
+	context->custom_transport = NULL;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_context_set_custom_transport (dc_context_t *context, dc_custom_transport_t *custom_transport)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	context->custom_serial = custom_transport ? &custom_transport->serial : NULL;
+	context->custom_transport = custom_transport;
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, const dc_allocator_t *allocator)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (allocator && (allocator->malloc == NULL || allocator->realloc == NULL))
+		return DC_STATUS_INVALIDARGS;
+
+	// Memory that is still in use must be released by the same allocator.
+	if (context->nallocs != 0) {
+		ERROR (context, "The allocator can't be changed while memory is allocated.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	if (allocator)
+		context->allocator = *allocator;
+	else
+		memset (&context->allocator, 0, sizeof (context->allocator));
+
+	return DC_STATUS_SUCCESS;
+}
+
+void *
+dc_context_alloc (dc_context_t *context, size_t size)
+{
+	if (context == NULL)
+		return malloc (size);
+
+	void *ptr = NULL;
+	if (context->allocator.malloc == NULL)
+		ptr = malloc (size);
+	else
+		ptr = context->allocator.malloc (context->allocator.userdata, size);
+
+	if (ptr)
+		dc_atomic_add (&context->nallocs, 1);
+
+	return ptr;
+}
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size)
+{
+	if (context == NULL)
+		return realloc (ptr, size);
+
+	void *result = NULL;
+	if (context->allocator.malloc == NULL)
+		result = realloc (ptr, size);
+	else
+		result = context->allocator.realloc (context->allocator.userdata, ptr, size);
+
+	if (result && ptr == NULL)
+		dc_atomic_add (&context->nallocs, 1);
+
+	return result;
+}
+
+void
+dc_context_dealloc (dc_context_t *context, void *ptr)
+{
+	if (ptr == NULL)
+		return;
+
+	if (context == NULL) {
+		free (ptr);
+		return;
+	}
+
+	dc_atomic_add (&context->nallocs, -1);
+
+	if (context->allocator.malloc == NULL) {
+		free (ptr);
+		return;
+	}
+
+	// In arena mode, the memory is released by the application.
+	if (context->allocator.free)
+		context->allocator.free (context->allocator.userdata, ptr);
+}
+
+dc_status_t
+dc_context_set_clock (dc_context_t *context, const dc_clock_t *clock)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (clock && (clock->monotonic == NULL || clock->sleep == NULL))
+		return DC_STATUS_INVALIDARGS;
+
+	if (clock)
+		context->clock = *clock;
+	else
+		memset (&context->clock, 0, sizeof (context->clock));
+
+	return DC_STATUS_SUCCESS;
+}
+
+unsigned long long
+dc_context_monotonic (dc_context_t *context)
+{
+	if (context && context->clock.monotonic)
+		return context->clock.monotonic (context->clock.userdata);
+
+#ifdef _WIN32
+	LARGE_INTEGER now, frequency;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&now);
+	// Split the conversion, because the counter multiplied by 10^6
+	// overflows after about three weeks of uptime at 10MHz.
+	unsigned long long q = now.QuadPart, f = frequency.QuadPart;
+	return (q / f) * 1000000 + (q % f) * 1000000 / f;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#else
+	struct timeval now;
+	gettimeofday (&now, NULL);
+	return (unsigned long long) now.tv_sec * 1000000 + now.tv_usec;
+#endif
+}
+
+void
+dc_context_sleep (dc_context_t *context, unsigned int milliseconds)
+{
+	if (context && context->clock.sleep) {
+		context->clock.sleep (context->clock.userdata, milliseconds);
+		return;
+	}
+
+#ifdef _WIN32
+	Sleep (milliseconds);
+#else
+	struct timespec ts;
+	ts.tv_sec  = (milliseconds / 1000);
+	ts.tv_nsec = (milliseconds % 1000) * 1000000;
+
+	while (nanosleep (&ts, &ts) != 0 && errno == EINTR)
+		;
+#endif
+}
+
+dc_ticks_t
+dc_context_now (dc_context_t *context)
+{
+	if (context && context->clock.now)
+		return context->clock.now (context->clock.userdata);
+
+	return dc_datetime_now ();
+}
+
+char *
+dc_context_strdup (dc_context_t *context, const char *str)
+{
+	size_t size = strlen (str) + 1;
+
+	char *copy = (char *) dc_context_alloc (context, size);
+	if (copy == NULL)
+		return NULL;
+
+	memcpy (copy, str, size);
+
+	return copy;
+}
+
 dc_custom_serial_t*
 _dc_context_custom_serial (dc_context_t *context)
 {
 	return context->custom_serial;
 }
 
+dc_custom_transport_t*
+_dc_context_custom_transport (dc_context_t *context)
+{
+	return context->custom_transport;
+}
+
+/*
+ * Find the entry of a particular device, or with a zero serial number, the
+ * entry that was used most recently on the interface.
+ */
+static dc_context_link_t *
+dc_context_find_link (dc_context_t *context, dc_family_t family, const char *name, unsigned int serial)
+{
+	dc_context_link_t *result = NULL;
+
+	for (unsigned int i = 0; i < context->nlinks; ++i) {
+		dc_context_link_t *link = context->links + i;
+		if (link->family != family || strcmp (link->name, name) != 0)
+			continue;
+
+		if (serial) {
+			if (link->serial == serial)
+				return link;
+		} else if (result == NULL || link->sequence > result->sequence) {
+			result = link;
+		}
+	}
+
+	return result;
+}
+
+unsigned int
+dc_context_get_baudrate (dc_context_t *context, dc_family_t family, const char *name, unsigned int serial)
+{
+	if (context == NULL || name == NULL)
+		return 0;
+
+	dc_context_link_t *link = dc_context_find_link (context, family, name, serial);
+	if (link == NULL)
+		return 0;
+
+	return link->baudrate;
+}
+
+void
+dc_context_set_baudrate (dc_context_t *context, dc_family_t family, const char *name, unsigned int serial, unsigned int baudrate)
+{
+	if (context == NULL || name == NULL)
+		return;
+
+	// Names that do not fit are not cached.
+	if (strlen (name) >= sizeof (context->links[0].name))
+		return;
+
+	// An unknown serial number only matches an entry without one.
+	dc_context_link_t *link = NULL;
+	for (unsigned int i = 0; i < context->nlinks; ++i) {
+		dc_context_link_t *candidate = context->links + i;
+		if (candidate->family == family && candidate->serial == serial &&
+			strcmp (candidate->name, name) == 0) {
+			link = candidate;
+			break;
+		}
+	}
+
+	if (link == NULL) {
+		if (context->nlinks < NLINKS) {
+			link = context->links + context->nlinks;
+			context->nlinks++;
+		} else {
+			// Replace the least recently used entry once the cache is full.
+			link = context->links;
+			for (unsigned int i = 1; i < NLINKS; ++i) {
+				if (context->links[i].sequence < link->sequence)
+					link = context->links + i;
+			}
+		}
+
+		link->family = family;
+		link->serial = serial;
+		strcpy (link->name, name);
+	}
+
+	link->baudrate = baudrate;
+	link->sequence = ++context->sequence;
+}
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel)
 {
@@ -273,11 +600,15 @@ dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file,
 	if (context->logfunc == NULL)
 		return DC_STATUS_SUCCESS;
 
+	dc_mutex_lock (&context->lock);
+
 	va_start (ap, format);
 	l_vsnprintf (context->msg, sizeof (context->msg), format, ap);
 	va_end (ap);
 
 	context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+
+	dc_mutex_unlock (&context->lock);
 #endif
 
 	return DC_STATUS_SUCCESS;
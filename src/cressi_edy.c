@@ -273,6 +273,9 @@ cressi_edy_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line.
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -505,7 +508,7 @@ cressi_edy_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, v
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Memory buffer for the profile data.
-	unsigned char *buffer = (unsigned char *) malloc (total);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (abstract->context, total);
 	if (buffer == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -534,7 +537,7 @@ cressi_edy_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, v
 		unsigned int current = array_uint_le (logbook + idx * layout->rb_logbook_size, layout->rb_logbook_size) * SZ_PAGE + layout->rb_profile_begin;
 		if (current < layout->rb_profile_begin || current >= layout->rb_profile_end) {
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%04x).", current);
-			free(buffer);
+			dc_context_dealloc (abstract->context, buffer);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -552,7 +555,7 @@ cressi_edy_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, v
 			rc = cressi_edy_device_read (abstract, address, packet, sizeof(packet));
 			if (rc != DC_STATUS_SUCCESS) {
 				ERROR (abstract->context, "Failed to read the memory page.");
-				free(buffer);
+				dc_context_dealloc (abstract->context, buffer);
 				return rc;
 			}
 
@@ -598,7 +601,7 @@ cressi_edy_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, v
 		idx--;
 	}
 
-	free(buffer);
+	dc_context_dealloc (abstract->context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
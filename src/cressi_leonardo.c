@@ -30,6 +30,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 #include "ringbuffer.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &cressi_leonardo_device_vtable)
@@ -201,6 +202,9 @@ cressi_leonardo_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the RTS line.
 	status = dc_serial_set_rts (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -317,6 +321,10 @@ cressi_leonardo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	dc_status_t status = DC_STATUS_SUCCESS;
 	cressi_leonardo_device_t *device = (cressi_leonardo_device_t *) abstract;
 
+	// Serve the memory image from the cache, if available.
+	if (device_cache_get (abstract, buffer))
+		return DC_STATUS_SUCCESS;
+
 	// Erase the current contents of the buffer and
 	// pre-allocate the required amount of memory.
 	if (!dc_buffer_clear (buffer) || !dc_buffer_resize (buffer, SZ_MEMORY)) {
@@ -354,33 +362,35 @@ cressi_leonardo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 	unsigned char *data = dc_buffer_get_data (buffer);
 
+	checksum_crc_ccitt_t ctx;
+	checksum_crc_ccitt_init (&ctx);
+
 	unsigned int nbytes = 0;
 	while (nbytes < SZ_MEMORY) {
 		// Set the minimum packet size.
 		unsigned int len = 1024;
 
-		// Increase the packet size if more data is immediately available.
-		size_t available = 0;
-		status = dc_serial_get_available (device->port, &available);
-		if (status == DC_STATUS_SUCCESS && available > len)
-			len = available;
-
 		// Limit the packet size to the total size.
 		if (nbytes + len > SZ_MEMORY)
 			len = SZ_MEMORY - nbytes;
 
-		// Read the packet.
-		status = dc_serial_read (device->port, data + nbytes, len, NULL);
+		// Read the packet, including any additional data that is
+		// immediately available.
+		size_t n = 0;
+		status = dc_serial_read_some (device->port, data + nbytes, len, SZ_MEMORY - nbytes, &n);
 		if (status != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return status;
 		}
 
+		// Update the checksum.
+		checksum_crc_ccitt_update (&ctx, data + nbytes, n);
+
 		// Update and emit a progress event.
-		progress.current += len;
+		progress.current += n;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-		nbytes += len;
+		nbytes += n;
 	}
 
 	// Receive the trailer packet.
@@ -397,34 +407,46 @@ cressi_leonardo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 	// Verify the checksum.
 	unsigned int csum1 = array_uint16_be (checksum);
-	unsigned int csum2 = checksum_crc_ccitt_uint16 (data, SZ_MEMORY);
+	unsigned int csum2 = checksum_crc_ccitt_final_uint16 (&ctx);
 	if (csum1 != csum2) {
 		ERROR (abstract->context, "Unexpected answer bytes.");
 		return DC_STATUS_PROTOCOL;
 	}
 
+	// Keep the memory image for the rest of the session.
+	device_cache_put (abstract, buffer);
+
 	return DC_STATUS_SUCCESS;
 }
 
 static dc_status_t
 cressi_leonardo_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	dc_status_t rc = cressi_leonardo_device_dump (abstract, buffer);
-	if (rc != DC_STATUS_SUCCESS) {
-		dc_buffer_free (buffer);
-		return rc;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	int cached = device_cache_get (abstract, buffer);
+	if (!cached) {
+		rc = cressi_leonardo_device_dump (abstract, buffer);
+		if (rc != DC_STATUS_SUCCESS) {
+			dc_buffer_free (buffer);
+			return rc;
+		}
 	}
 
-	unsigned char *data = dc_buffer_get_data (buffer);
-	dc_event_devinfo_t devinfo;
-	devinfo.model = data[0];
-	devinfo.firmware = 0;
-	devinfo.serial = array_uint24_le (data + 1);
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	// On a cache hit, the device info event of the original transfer
+	// has already been emitted again, unless the image was cached by a
+	// plain dump.
+	if (!cached || !device_devinfo_known (abstract)) {
+		unsigned char *data = dc_buffer_get_data (buffer);
+		dc_event_devinfo_t devinfo;
+		devinfo.model = data[0];
+		devinfo.firmware = 0;
+		devinfo.serial = array_uint24_le (data + 1);
+		device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	}
 
 	rc = cressi_leonardo_extract_dives (abstract, dc_buffer_get_data (buffer),
 		dc_buffer_get_size (buffer), callback, userdata);
@@ -474,7 +496,7 @@ cressi_leonardo_extract_dives (dc_device_t *abstract, const unsigned char data[]
 		count++;
 	}
 
-	unsigned char *buffer = (unsigned char *) malloc (RB_LOGBOOK_SIZE + RB_PROFILE_END - RB_PROFILE_BEGIN);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (context, RB_LOGBOOK_SIZE + RB_PROFILE_END - RB_PROFILE_BEGIN);
 	if (buffer == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -493,13 +515,13 @@ cressi_leonardo_extract_dives (dc_device_t *abstract, const unsigned char data[]
 			footer < RB_PROFILE_BEGIN || footer + 2 > RB_PROFILE_END)
 		{
 			ERROR (context, "Invalid ringbuffer pointer detected (0x%04x 0x%04x).", header, footer);
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_DATAFORMAT;
 		}
 
 		if (previous && previous != footer + 2) {
 			ERROR (abstract->context, "Profiles are not continuous (0x%04x 0x%04x 0x%04x).", header, footer, previous);
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -520,7 +542,7 @@ cressi_leonardo_extract_dives (dc_device_t *abstract, const unsigned char data[]
 			unsigned int footer2 = array_uint16_le (data + header);
 			if (header2 != header || footer2 != footer) {
 				ERROR (context, "Invalid ringbuffer pointer detected (0x%04x 0x%04x).", header2, footer2);
-				free (buffer);
+				dc_context_dealloc (context, buffer);
 				return DC_STATUS_DATAFORMAT;
 			}
 
@@ -548,7 +570,7 @@ cressi_leonardo_extract_dives (dc_device_t *abstract, const unsigned char data[]
 		previous = header;
 	}
 
-	free (buffer);
+	dc_context_dealloc (context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
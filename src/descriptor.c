@@ -35,6 +35,7 @@
 #include <libdivecomputer/descriptor.h>
 
 #include "iterator-private.h"
+#include "context-private.h"
 
 #define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
 
@@ -299,6 +300,7 @@ static const dc_descriptor_t g_descriptors[] = {
 
 typedef struct dc_descriptor_iterator_t {
 	dc_iterator_t base;
+	dc_context_t *context;
 	size_t current;
 } dc_descriptor_iterator_t;
 
@@ -312,17 +314,24 @@ static const dc_iterator_vtable_t dc_descriptor_iterator_vtable = {
 
 dc_status_t
 dc_descriptor_iterator (dc_iterator_t **out)
+{
+	return dc_descriptor_iterator_new (out, NULL);
+}
+
+dc_status_t
+dc_descriptor_iterator_new (dc_iterator_t **out, dc_context_t *context)
 {
 	dc_descriptor_iterator_t *iterator = NULL;
 
 	if (out == NULL)
 		return DC_STATUS_INVALIDARGS;
 
-	iterator = (dc_descriptor_iterator_t *) malloc (sizeof (dc_descriptor_iterator_t));
+	iterator = (dc_descriptor_iterator_t *) dc_context_alloc (context, sizeof (dc_descriptor_iterator_t));
 	if (iterator == NULL)
 		return DC_STATUS_NOMEMORY;
 
 	iterator->base.vtable = &dc_descriptor_iterator_vtable;
+	iterator->context = context;
 	iterator->current = 0;
 
 	*out = (dc_iterator_t *) iterator;
@@ -331,9 +340,11 @@ dc_descriptor_iterator (dc_iterator_t **out)
 }
 
 static dc_status_t
-dc_descriptor_iterator_free (dc_iterator_t *iterator)
+dc_descriptor_iterator_free (dc_iterator_t *abstract)
 {
-	free (iterator);
+	dc_descriptor_iterator_t *iterator = (dc_descriptor_iterator_t *) abstract;
+
+	dc_context_dealloc (iterator->context, iterator);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -54,6 +54,13 @@ struct dc_device_t {
 	// Cached events for the parsers.
 	dc_event_devinfo_t devinfo;
 	dc_event_clock_t clock;
+	// Cached memory image.
+	dc_buffer_t *cache;
+	// Buffer with the dives passed to the dive callback.
+	dc_buffer_t *dives;
+	// Known fingerprints (sorted).
+	dc_buffer_t *fingerprints;
+	unsigned int fpsize;
 };
 
 struct dc_device_vtable_t {
@@ -92,6 +99,37 @@ device_is_cancelled (dc_device_t *device);
 dc_status_t
 device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size, unsigned int blocksize);
 
+int
+device_devinfo_known (dc_device_t *device);
+
+int
+device_cache_get (dc_device_t *device, dc_buffer_t *buffer);
+
+void
+device_cache_put (dc_device_t *device, dc_buffer_t *buffer);
+
+void
+device_cache_invalidate (dc_device_t *device);
+
+int
+device_fingerprint_known (dc_device_t *device, const unsigned char data[], unsigned int size);
+
+/*
+ * Register the buffer that contains the dives passed to the dive
+ * callback, such that they can be retained without a copy. The buffer
+ * must not be modified in place while it is registered, and is
+ * unregistered again with NULL.
+ */
+void
+device_dives_set (dc_device_t *device, dc_buffer_t *buffer);
+
+/*
+ * Create a view on a dive passed to the dive callback. Returns NULL if
+ * the dive is not located in the registered buffer.
+ */
+dc_buffer_t *
+device_dive_view (dc_device_t *device, const unsigned char data[], unsigned int size);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
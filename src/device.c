@@ -40,6 +40,7 @@
 
 #include "device-private.h"
 #include "context-private.h"
+#include "buffer-private.h"
 
 dc_device_t *
 dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
@@ -50,7 +51,7 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 	assert(vtable->size >= sizeof(dc_device_t));
 
 	// Allocate memory.
-	device = (dc_device_t *) malloc (vtable->size);
+	device = (dc_device_t *) dc_context_alloc (context, vtable->size);
 	if (device == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return device;
@@ -70,13 +71,25 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 	memset (&device->devinfo, 0, sizeof (device->devinfo));
 	memset (&device->clock, 0, sizeof (device->clock));
 
+	device->cache = NULL;
+	device->dives = NULL;
+
+	device->fingerprints = NULL;
+	device->fpsize = 0;
+
 	return device;
 }
 
 void
 dc_device_deallocate (dc_device_t *device)
 {
-	free (device);
+	if (device == NULL)
+		return;
+
+	dc_buffer_free (device->fingerprints);
+	dc_buffer_free (device->cache);
+
+	dc_context_dealloc (device->context, device);
 }
 
 dc_status_t
@@ -254,10 +267,100 @@ dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsi
 	if (device->vtable->set_fingerprint == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
+	// A new fingerprint can change the contents of the dump.
+	device_cache_invalidate (device);
+
 	return device->vtable->set_fingerprint (device, data, size);
 }
 
 
+static unsigned int
+device_fingerprint_search (dc_device_t *device, const unsigned char data[], int *found)
+{
+	const unsigned char *fingerprints = dc_buffer_get_data (device->fingerprints);
+	unsigned int count = dc_buffer_get_size (device->fingerprints) / device->fpsize;
+
+	// Binary search for the insertion point.
+	unsigned int lo = 0, hi = count;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		int cmp = memcmp (fingerprints + mid * device->fpsize, data, device->fpsize);
+		if (cmp == 0) {
+			*found = 1;
+			return mid;
+		} else if (cmp < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*found = 0;
+	return lo;
+}
+
+
+dc_status_t
+dc_device_add_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Clear all known fingerprints.
+	if (data == NULL || size == 0) {
+		dc_buffer_free (device->fingerprints);
+		device->fingerprints = NULL;
+		device->fpsize = 0;
+		return DC_STATUS_SUCCESS;
+	}
+
+	if (device->fingerprints == NULL) {
+		device->fingerprints = dc_buffer_allocate (device->context, size * 64);
+		if (device->fingerprints == NULL) {
+			ERROR (device->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		device->fpsize = size;
+	}
+
+	// All fingerprints of a device have the same size.
+	if (size != device->fpsize)
+		return DC_STATUS_INVALIDARGS;
+
+	int found = 0;
+	unsigned int idx = device_fingerprint_search (device, data, &found);
+	if (found)
+		return DC_STATUS_SUCCESS;
+
+	// Insert the fingerprint, keeping the list sorted.
+	unsigned int offset = idx * size;
+	unsigned int length = dc_buffer_get_size (device->fingerprints);
+	if (!dc_buffer_resize (device->fingerprints, length + size)) {
+		ERROR (device->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	unsigned char *fingerprints = dc_buffer_get_data (device->fingerprints);
+	memmove (fingerprints + offset + size, fingerprints + offset, length - offset);
+	memcpy (fingerprints + offset, data, size);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+int
+device_fingerprint_known (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL || device->fingerprints == NULL || size != device->fpsize)
+		return 0;
+
+	int found = 0;
+	device_fingerprint_search (device, data, &found);
+
+	return found;
+}
+
+
 dc_status_t
 dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size)
 {
@@ -280,6 +383,9 @@ dc_device_write (dc_device_t *device, unsigned int address, const unsigned char
 	if (device->vtable->write == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
+	// The memory contents are about to change.
+	device_cache_invalidate (device);
+
 	return device->vtable->write (device, address, data, size);
 }
 
@@ -334,6 +440,123 @@ device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size,
 }
 
 
+int
+device_devinfo_known (dc_device_t *device)
+{
+	if (device == NULL)
+		return 0;
+
+	return device->devinfo.model || device->devinfo.firmware || device->devinfo.serial;
+}
+
+
+int
+device_cache_get (dc_device_t *device, dc_buffer_t *buffer)
+{
+	if (device == NULL || device->cache == NULL)
+		return 0;
+
+	// Copy the cached memory image.
+	if (!dc_buffer_clear (buffer) || !dc_buffer_append (buffer,
+		dc_buffer_get_const_data (device->cache), dc_buffer_get_size (device->cache))) {
+		return 0;
+	}
+
+	// Emit the events of the original transfer again, such that the
+	// application receives the same information as without the cache.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.current = progress.maximum = dc_buffer_get_size (buffer) ? dc_buffer_get_size (buffer) : 1;
+	device_event_emit (device, DC_EVENT_PROGRESS, &progress);
+
+	if (device->clock.systime || device->clock.devtime) {
+		dc_event_clock_t clock = device->clock;
+		device_event_emit (device, DC_EVENT_CLOCK, &clock);
+	}
+
+	if (device_devinfo_known (device)) {
+		dc_event_devinfo_t devinfo = device->devinfo;
+		device_event_emit (device, DC_EVENT_DEVINFO, &devinfo);
+	}
+
+	return 1;
+}
+
+
+void
+device_cache_put (dc_device_t *device, dc_buffer_t *buffer)
+{
+	if (device == NULL)
+		return;
+
+	// Keep a private copy of the memory image. The buffer may belong to
+	// the application, which is free to modify it afterwards. The cache
+	// is optional, so a failure only disables it.
+	if (device->cache == NULL)
+		device->cache = dc_buffer_allocate (device->context, dc_buffer_get_size (buffer));
+
+	if (device->cache == NULL || !dc_buffer_clear (device->cache) || !dc_buffer_append (device->cache,
+		dc_buffer_get_const_data (buffer), dc_buffer_get_size (buffer))) {
+		device_cache_invalidate (device);
+	}
+}
+
+
+void
+device_cache_invalidate (dc_device_t *device)
+{
+	if (device == NULL)
+		return;
+
+	dc_buffer_free (device->cache);
+	device->cache = NULL;
+}
+
+
+void
+device_dives_set (dc_device_t *device, dc_buffer_t *buffer)
+{
+	if (device == NULL)
+		return;
+
+	device->dives = buffer;
+}
+
+
+dc_buffer_t *
+device_dive_view (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL || device->dives == NULL)
+		return NULL;
+
+	const unsigned char *begin = dc_buffer_get_const_data (device->dives);
+	size_t length = dc_buffer_get_size (device->dives);
+	if (begin == NULL || data < begin || size > length || (size_t) (data - begin) > length - size)
+		return NULL;
+
+	return dc_buffer_view (device->dives, data - begin, size);
+}
+
+
+dc_buffer_t *
+dc_device_get_dive (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL || data == NULL)
+		return NULL;
+
+	dc_buffer_t *buffer = device_dive_view (device, data, size);
+	if (buffer)
+		return buffer;
+
+	buffer = dc_buffer_allocate (device->context, size);
+	if (buffer == NULL || !dc_buffer_append (buffer, data, size)) {
+		dc_buffer_free (buffer);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+
 dc_status_t
 dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata)
 {
@@ -30,6 +30,7 @@
 #include "checksum.h"
 #include "serial.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &diverite_nitekq_device_vtable)
 
@@ -253,6 +254,10 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	unsigned char packet[256] = {0};
 
+	// Serve the memory image from the cache, if available.
+	if (device_cache_get (abstract, buffer))
+		return DC_STATUS_SUCCESS;
+
 	// Erase the current contents of the buffer.
 	if (!dc_buffer_clear (buffer) || !dc_buffer_reserve (buffer, SZ_PACKET + SZ_MEMORY)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
@@ -324,6 +329,9 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 	}
 
+	// Keep the memory image for the rest of the session.
+	device_cache_put (abstract, buffer);
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -331,7 +339,7 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 diverite_nitekq_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -369,7 +377,7 @@ diverite_nitekq_extract_dives (dc_device_t *abstract, const unsigned char data[]
 	data += SZ_PACKET;
 
 	// Allocate memory.
-	unsigned char *buffer = (unsigned char *) malloc (SZ_LOGBOOK + RB_PROFILE_END - RB_PROFILE_BEGIN);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (context, SZ_LOGBOOK + RB_PROFILE_END - RB_PROFILE_BEGIN);
 	if (buffer == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -379,7 +387,7 @@ diverite_nitekq_extract_dives (dc_device_t *abstract, const unsigned char data[]
 	unsigned int eop = array_uint16_be(data + EOP);
 	if (eop < RB_PROFILE_BEGIN || eop >= RB_PROFILE_END) {
 		ERROR (context, "Invalid ringbuffer pointer detected (0x%04x).", eop);
-		free (buffer);
+		dc_context_dealloc (context, buffer);
 		return DC_STATUS_DATAFORMAT;
 	}
 
@@ -400,7 +408,7 @@ diverite_nitekq_extract_dives (dc_device_t *abstract, const unsigned char data[]
 		unsigned int address = array_uint16_be(data + ADDRESS + i * 2);
 		if (address < RB_PROFILE_BEGIN || address >= RB_PROFILE_END) {
 			ERROR (context, "Invalid ringbuffer pointer detected (0x%04x).", address);
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -431,7 +439,7 @@ diverite_nitekq_extract_dives (dc_device_t *abstract, const unsigned char data[]
 		previous = address;
 	}
 
-	free (buffer);
+	dc_context_dealloc (context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -29,6 +29,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &divesystem_idive_device_vtable)
 
@@ -38,6 +39,10 @@
 #define IX3M_REB  0x25
 
 #define MAXRETRIES 9
+#define MINDELAY   10
+#define MAXDELAY   800
+#define MAXINFLIGHT 8
+#define ANSWERTIME  1000
 
 #define MAXPACKET 0xFF
 #define START     0x55
@@ -65,6 +70,8 @@ typedef struct divesystem_idive_device_t {
 	dc_serial_t *port;
 	unsigned char fingerprint[4];
 	unsigned int model;
+	unsigned int delay;
+	unsigned int pipeline;
 } divesystem_idive_device_t;
 
 static dc_status_t divesystem_idive_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size);
@@ -123,6 +130,8 @@ divesystem_idive_device_open2 (dc_device_t **out, dc_context_t *context, const c
 	device->port = NULL;
 	memset (device->fingerprint, 0, sizeof (device->fingerprint));
 	device->model = model;
+	device->delay = 100;
+	device->pipeline = 1;
 
 	// Open the device.
 	status = dc_serial_open (&device->port, context, name);
@@ -139,7 +148,7 @@ divesystem_idive_device_open2 (dc_device_t **out, dc_context_t *context, const c
 	}
 
 	// Set the timeout for receiving data (1000ms).
-	status = dc_serial_set_timeout (device->port, 1000);
+	status = dc_serial_set_timeout (device->port, ANSWERTIME);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to set the timeout.");
 		goto error_close;
@@ -288,36 +297,26 @@ divesystem_idive_receive (divesystem_idive_device_t *device, unsigned char answe
 
 
 static dc_status_t
-divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+divesystem_idive_answer (divesystem_idive_device_t *device, const unsigned char command[], unsigned char answer[], unsigned int asize, unsigned int *busy)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
 	unsigned char packet[MAXPACKET] = {0};
-	unsigned int length = 0;
-	unsigned int nretries = 0;
+	unsigned int length = sizeof(packet);
 
-	while (1) {
-		// Send the command.
-		rc = divesystem_idive_send (device, command, csize);
-		if (rc != DC_STATUS_SUCCESS)
-			return rc;
-
-		// Receive the answer.
-		length = sizeof(packet);
-		rc = divesystem_idive_receive (device, packet, &length);
-		if (rc != DC_STATUS_SUCCESS)
-			return rc;
-
-		// Verify the command byte.
-		if (packet[0] != command[0]) {
-			ERROR (abstract->context, "Unexpected packet header.");
-			return DC_STATUS_PROTOCOL;
-		}
+	// Receive the answer.
+	rc = divesystem_idive_receive (device, packet, &length);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
 
-		// Check the ACK byte.
-		if (packet[length - 1] == ACK)
-			break;
+	// Verify the command byte.
+	if (packet[0] != command[0]) {
+		ERROR (abstract->context, "Unexpected packet header.");
+		return DC_STATUS_PROTOCOL;
+	}
 
+	// Check the ACK byte.
+	if (packet[length - 1] != ACK) {
 		// Verify the NAK byte.
 		if (packet[length - 1] != NAK) {
 			ERROR (abstract->context, "Unexpected ACK/NAK byte.");
@@ -337,12 +336,8 @@ divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned cha
 			return DC_STATUS_PROTOCOL;
 		}
 
-		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
-			return DC_STATUS_PROTOCOL;
-
-		// Delay the next attempt.
-		dc_serial_sleep(device->port, 100);
+		*busy = 1;
+		return DC_STATUS_SUCCESS;
 	}
 
 	// Verify the length of the packet.
@@ -352,10 +347,115 @@ divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned cha
 	}
 
 	memcpy(answer, packet + 1, length - 2);
+	*busy = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	unsigned int nretries = 0;
+	unsigned int delay = device->delay;
+
+	while (1) {
+		// Send the command.
+		rc = divesystem_idive_send (device, command, csize);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		// Receive the answer.
+		unsigned int busy = 0;
+		rc = divesystem_idive_answer (device, command, answer, asize, &busy);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		if (!busy)
+			break;
+
+		// Abort if the maximum number of retries is reached.
+		if (nretries++ >= MAXRETRIES)
+			return DC_STATUS_PROTOCOL;
+
+		// Delay the next attempt. The delay doubles with every attempt,
+		// starting from half the delay that was needed the last time.
+		dc_serial_sleep(device->port, delay);
+		delay *= 2;
+		if (delay > MAXDELAY)
+			delay = MAXDELAY;
+	}
+
+	// Remember the delay for the next time the device is busy.
+	if (nretries) {
+		device->delay = delay / 4;
+		if (device->delay < MINDELAY)
+			device->delay = MINDELAY;
+	}
 
 	return DC_STATUS_SUCCESS;
 }
 
+
+static dc_status_t
+divesystem_idive_samples (divesystem_idive_device_t *device, const divesystem_idive_command_t *command, unsigned int first, unsigned int count, dc_buffer_t *buffer, unsigned int *received)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	unsigned char packet[MAXPACKET - 2];
+
+	*received = 0;
+
+	// Send all requests at once, such that the device can process the
+	// next request while the previous answer is still being received.
+	for (unsigned int i = 0; i < count; ++i) {
+		unsigned int idx = first + i + 1;
+		unsigned char cmd_sample[] = {command->cmd,
+			(idx     ) & 0xFF,
+			(idx >> 8) & 0xFF};
+		rc = divesystem_idive_send (device, cmd_sample, sizeof(cmd_sample));
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+	}
+
+	// Receive the answers in the same order.
+	unsigned int i = 0;
+	for (i = 0; i < count; ++i) {
+		const unsigned char cmd_sample[] = {command->cmd};
+		unsigned int busy = 0;
+		rc = divesystem_idive_answer (device, cmd_sample, packet, command->size, &busy);
+		if (rc != DC_STATUS_SUCCESS || busy)
+			break;
+
+		dc_buffer_append(buffer, packet, command->size);
+	}
+
+	*received = i;
+
+	if (i < count) {
+		// Discard the answers to the remaining requests. After a busy
+		// answer the framing is still intact, so every outstanding answer
+		// is received and dropped. If that fails too, or the framing
+		// is lost, drain the input until the line has been idle for one
+		// answer time.
+		dc_status_t status = rc;
+		for (unsigned int j = i + 1; j < count && status == DC_STATUS_SUCCESS; ++j) {
+			const unsigned char cmd_sample[] = {command->cmd};
+			unsigned int busy = 0;
+			status = divesystem_idive_answer (device, cmd_sample, packet, command->size, &busy);
+		}
+
+		if (status != DC_STATUS_SUCCESS) {
+			while (dc_serial_wait (device->port, ANSWERTIME) == DC_STATUS_SUCCESS) {
+				dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+			}
+		}
+	}
+
+	return rc;
+}
+
+
 static dc_status_t
 divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
@@ -410,7 +510,7 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 	progress.maximum = ndives * NSTEPS;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-	dc_buffer_t *buffer = dc_buffer_new(0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
@@ -421,8 +521,10 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 			(number     ) & 0xFF,
 			(number >> 8) & 0xFF};
 		rc = divesystem_idive_transfer (device, cmd_header, sizeof(cmd_header), packet, commands->header.size);
-		if (rc != DC_STATUS_SUCCESS)
+		if (rc != DC_STATUS_SUCCESS) {
+			dc_buffer_free (buffer);
 			return rc;
+		}
 
 		if (memcmp(packet + 7, device->fingerprint, sizeof(device->fingerprint)) == 0)
 			break;
@@ -437,20 +539,51 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 		dc_buffer_reserve(buffer, commands->header.size + commands->sample.size * nsamples);
 		dc_buffer_append(buffer, packet, commands->header.size);
 
-		for (unsigned int j = 0; j < nsamples; ++j) {
-			unsigned int idx = j + 1;
-			unsigned char cmd_sample[] = {commands->sample.cmd,
-				(idx     ) & 0xFF,
-				(idx >> 8) & 0xFF};
-			rc = divesystem_idive_transfer (device, cmd_sample, sizeof(cmd_sample), packet, commands->sample.size);
-			if (rc != DC_STATUS_SUCCESS)
-				return rc;
-
-			// Update and emit a progress event.
-			progress.current = i * NSTEPS + STEP(j + 2, nsamples + 1);
-			device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
-
-			dc_buffer_append(buffer, packet, commands->sample.size);
+		unsigned int j = 0;
+		while (j < nsamples) {
+			// Request several samples at once if possible.
+			unsigned int n = 0, count = 0;
+			if (device->pipeline) {
+				n = nsamples - j;
+				if (n > MAXINFLIGHT)
+					n = MAXINFLIGHT;
+
+				rc = divesystem_idive_samples (device, &commands->sample, j, n, buffer, &count);
+				if (rc == DC_STATUS_CANCELLED || rc == DC_STATUS_IO) {
+					dc_buffer_free (buffer);
+					return rc;
+				}
+				if (rc != DC_STATUS_SUCCESS) {
+					// Fall back to one request at a time.
+					WARNING (abstract->context, "Failed to request multiple samples, disabling pipelining.");
+					device->pipeline = 0;
+				}
+				j += count;
+			}
+
+			// Request the next sample on its own if the pipelined
+			// request failed or was interrupted by a busy device.
+			if (j < nsamples && (n == 0 || count < n)) {
+				unsigned int idx = j + 1;
+				unsigned char cmd_sample[] = {commands->sample.cmd,
+					(idx     ) & 0xFF,
+					(idx >> 8) & 0xFF};
+				rc = divesystem_idive_transfer (device, cmd_sample, sizeof(cmd_sample), packet, commands->sample.size);
+				if (rc != DC_STATUS_SUCCESS) {
+					dc_buffer_free (buffer);
+					return rc;
+				}
+
+				dc_buffer_append(buffer, packet, commands->sample.size);
+				j++;
+			}
+
+			// Update and emit a progress event, but only if it changed.
+			unsigned int current = i * NSTEPS + STEP(j + 1, nsamples + 1);
+			if (current != progress.current) {
+				progress.current = current;
+				device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+			}
 		}
 
 		unsigned char *data = dc_buffer_get_data(buffer);
@@ -66,10 +66,24 @@ struct divesystem_idive_parser_t {
 	unsigned int helium[NGASMIXES];
 };
 
+typedef struct divesystem_idive_state_t {
+	unsigned int offset;
+	unsigned int time;
+	unsigned int maxdepth;
+	unsigned int ngasmixes;
+	unsigned int oxygen[NGASMIXES];
+	unsigned int helium[NGASMIXES];
+	unsigned int o2_previous;
+	unsigned int he_previous;
+	unsigned int mode_previous;
+	unsigned int divemode;
+} divesystem_idive_state_t;
+
 static dc_status_t divesystem_idive_parser_set_data (dc_parser_t *abstract, const unsigned char *data, unsigned int size);
 static dc_status_t divesystem_idive_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t divesystem_idive_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t divesystem_idive_parser_samples_iterator (dc_parser_t *abstract, dc_iterator_t **iterator);
 
 static const dc_parser_vtable_t divesystem_idive_parser_vtable = {
 	sizeof(divesystem_idive_parser_t),
@@ -78,7 +92,8 @@ static const dc_parser_vtable_t divesystem_idive_parser_vtable = {
 	divesystem_idive_parser_get_datetime, /* datetime */
 	divesystem_idive_parser_get_field, /* fields */
 	divesystem_idive_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	divesystem_idive_parser_samples_iterator /* samples_iterator */
 };
 
 
@@ -232,123 +247,167 @@ divesystem_idive_parser_get_field (dc_parser_t *abstract, dc_field_type_t type,
 }
 
 
+static void
+divesystem_idive_state_init (divesystem_idive_parser_t *parser, divesystem_idive_state_t *state)
+{
+	state->offset = parser->headersize;
+	state->time = 0;
+	state->maxdepth = 0;
+	state->ngasmixes = 0;
+	state->o2_previous = 0xFFFFFFFF;
+	state->he_previous = 0xFFFFFFFF;
+	state->mode_previous = INVALID;
+	state->divemode = INVALID;
+}
+
+
 static dc_status_t
-divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+divesystem_idive_parser_decode (dc_parser_t *abstract, void *userstate, dc_sample_callback_t callback, void *userdata)
 {
 	divesystem_idive_parser_t *parser = (divesystem_idive_parser_t *) abstract;
+	divesystem_idive_state_t *state = (divesystem_idive_state_t *) userstate;
 	const unsigned char *data = abstract->data;
 	unsigned int size = abstract->size;
+	unsigned int offset = state->offset;
 
-	unsigned int time = 0;
-	unsigned int maxdepth = 0;
-	unsigned int ngasmixes = 0;
-	unsigned int oxygen[NGASMIXES];
-	unsigned int helium[NGASMIXES];
-	unsigned int o2_previous = 0xFFFFFFFF;
-	unsigned int he_previous = 0xFFFFFFFF;
-	unsigned int mode_previous = INVALID;
-	unsigned int divemode = INVALID;
-
-	unsigned int offset = parser->headersize;
-	while (offset + parser->samplesize <= size) {
-		dc_sample_value_t sample = {0};
-
-		// Time (seconds).
-		unsigned int timestamp = array_uint32_le (data + offset + 2);
-		if (timestamp <= time) {
-			ERROR (abstract->context, "Timestamp moved backwards.");
-			return DC_STATUS_DATAFORMAT;
-		}
-		time = timestamp;
-		sample.time = timestamp;
-		if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
-
-		// Depth (1/10 m).
-		unsigned int depth = array_uint16_le (data + offset + 6);
-		if (maxdepth < depth)
-			maxdepth = depth;
-		sample.depth = depth / 10.0;
-		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
-
-		// Temperature (Celsius).
-		signed int temperature = (signed short) array_uint16_le (data + offset + 8);
-		sample.temperature = temperature / 10.0;
-		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
-
-		// Dive mode
-		unsigned int mode = data[offset + 18];
-		if (mode != mode_previous) {
-			if (mode_previous != INVALID) {
-				WARNING (abstract->context, "Dive mode changed from %02x to %02x.", mode_previous, mode);
-			}
-			mode_previous = mode;
-		}
-		if (divemode == INVALID) {
-			divemode = mode;
+	if (offset + parser->samplesize > size) {
+		// Cache the data for later use.
+		for (unsigned int i = 0; i < state->ngasmixes; ++i) {
+			parser->helium[i] = state->helium[i];
+			parser->oxygen[i] = state->oxygen[i];
 		}
+		parser->ngasmixes = state->ngasmixes;
+		parser->maxdepth = state->maxdepth;
+		parser->divetime = state->time;
+		parser->divemode = state->divemode;
+		parser->cached = 1;
 
-		// Gaschange.
-		unsigned int o2 = data[offset + 10];
-		unsigned int he = data[offset + 11];
-		if (o2 != o2_previous || he != he_previous) {
-			// Find the gasmix in the list.
-			unsigned int i = 0;
-			while (i < ngasmixes) {
-				if (o2 == oxygen[i] && he == helium[i])
-					break;
-				i++;
-			}
+		return DC_STATUS_DONE;
+	}
 
-			// Add it to list if not found.
-			if (i >= ngasmixes) {
-				if (i >= NGASMIXES) {
-					ERROR (abstract->context, "Maximum number of gas mixes reached.");
-					return DC_STATUS_DATAFORMAT;
-				}
-				oxygen[i] = o2;
-				helium[i] = he;
-				ngasmixes = i + 1;
-			}
+	dc_sample_value_t sample = {0};
+
+	// Time (seconds).
+	unsigned int timestamp = array_uint32_le (data + offset + 2);
+	if (timestamp <= state->time) {
+		ERROR (abstract->context, "Timestamp moved backwards.");
+		return DC_STATUS_DATAFORMAT;
+	}
+	state->time = timestamp;
+	sample.time = timestamp;
+	if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+
+	// Depth (1/10 m).
+	unsigned int depth = array_uint16_le (data + offset + 6);
+	if (state->maxdepth < depth)
+		state->maxdepth = depth;
+	sample.depth = depth / 10.0;
+	if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+
+	// Temperature (Celsius).
+	signed int temperature = (signed short) array_uint16_le (data + offset + 8);
+	sample.temperature = temperature / 10.0;
+	if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+
+	// Dive mode
+	unsigned int mode = data[offset + 18];
+	if (mode != state->mode_previous) {
+		if (state->mode_previous != INVALID) {
+			WARNING (abstract->context, "Dive mode changed from %02x to %02x.", state->mode_previous, mode);
+		}
+		state->mode_previous = mode;
+	}
+	if (state->divemode == INVALID) {
+		state->divemode = mode;
+	}
 
-			sample.gasmix = i;
-			if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
-			o2_previous = o2;
-			he_previous = he;
+	// Gaschange.
+	unsigned int o2 = data[offset + 10];
+	unsigned int he = data[offset + 11];
+	if (o2 != state->o2_previous || he != state->he_previous) {
+		// Find the gasmix in the list.
+		unsigned int i = 0;
+		while (i < state->ngasmixes) {
+			if (o2 == state->oxygen[i] && he == state->helium[i])
+				break;
+			i++;
 		}
 
-		// Deco stop / NDL.
-		unsigned int deco = array_uint16_le (data + offset + 21);
-		unsigned int tts  = array_uint16_le (data + offset + 23);
-		if (tts != 0xFFFF) {
-			if (deco) {
-				sample.deco.type = DC_DECO_DECOSTOP;
-				sample.deco.depth = deco / 10.0;
-			} else {
-				sample.deco.type = DC_DECO_NDL;
-				sample.deco.depth = 0.0;
+		// Add it to list if not found.
+		if (i >= state->ngasmixes) {
+			if (i >= NGASMIXES) {
+				ERROR (abstract->context, "Maximum number of gas mixes reached.");
+				return DC_STATUS_DATAFORMAT;
 			}
-			sample.deco.time = tts;
-			if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
+			state->oxygen[i] = o2;
+			state->helium[i] = he;
+			state->ngasmixes = i + 1;
 		}
 
-		// CNS
-		unsigned int cns = array_uint16_le (data + offset + 29);
-		sample.cns = cns / 100.0;
-		if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
-
-		offset += parser->samplesize;
+		sample.gasmix = i;
+		if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
+		state->o2_previous = o2;
+		state->he_previous = he;
 	}
 
-	// Cache the data for later use.
-	for (unsigned int i = 0; i < ngasmixes; ++i) {
-		parser->helium[i] = helium[i];
-		parser->oxygen[i] = oxygen[i];
+	// Deco stop / NDL.
+	unsigned int deco = array_uint16_le (data + offset + 21);
+	unsigned int tts  = array_uint16_le (data + offset + 23);
+	if (tts != 0xFFFF) {
+		if (deco) {
+			sample.deco.type = DC_DECO_DECOSTOP;
+			sample.deco.depth = deco / 10.0;
+		} else {
+			sample.deco.type = DC_DECO_NDL;
+			sample.deco.depth = 0.0;
+		}
+		sample.deco.time = tts;
+		if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 	}
-	parser->ngasmixes = ngasmixes;
-	parser->maxdepth = maxdepth;
-	parser->divetime = time;
-	parser->divemode = divemode;
-	parser->cached = 1;
+
+	// CNS
+	unsigned int cns = array_uint16_le (data + offset + 29);
+	sample.cns = cns / 100.0;
+	if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
+
+	state->offset = offset + parser->samplesize;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	divesystem_idive_parser_t *parser = (divesystem_idive_parser_t *) abstract;
+	divesystem_idive_state_t state;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	divesystem_idive_state_init (parser, &state);
+
+	do {
+		rc = divesystem_idive_parser_decode (abstract, &state, callback, userdata);
+	} while (rc == DC_STATUS_SUCCESS);
+
+	if (rc != DC_STATUS_DONE)
+		return rc;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+divesystem_idive_parser_samples_iterator (dc_parser_t *abstract, dc_iterator_t **out)
+{
+	divesystem_idive_parser_t *parser = (divesystem_idive_parser_t *) abstract;
+
+	dc_iterator_t *iterator = dc_sample_iterator_allocate (abstract, divesystem_idive_parser_decode, sizeof (divesystem_idive_state_t));
+	if (iterator == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	divesystem_idive_state_init (parser, (divesystem_idive_state_t *) dc_sample_iterator_state (iterator));
+
+	*out = iterator;
 
 	return DC_STATUS_SUCCESS;
 }
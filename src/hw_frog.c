@@ -150,18 +150,14 @@ hw_frog_transfer (hw_frog_device_t *device,
 			// Set the minimum packet size.
 			unsigned int len = 1024;
 
-			// Increase the packet size if more data is immediately available.
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > len)
-				len = available;
-
 			// Limit the packet size to the total size.
 			if (nbytes + len > osize)
 				len = osize - nbytes;
 
-			// Read the packet.
-			status = dc_serial_read (device->port, output + nbytes, len, NULL);
+			// Read the packet, including any additional data that is
+			// immediately available.
+			size_t n = 0;
+			status = dc_serial_read_some (device->port, output + nbytes, len, osize - nbytes, &n);
 			if (status != DC_STATUS_SUCCESS) {
 				ERROR (abstract->context, "Failed to receive the answer.");
 				return status;
@@ -169,11 +165,11 @@ hw_frog_transfer (hw_frog_device_t *device,
 
 			// Update and emit a progress event.
 			if (progress) {
-				progress->current += len;
+				progress->current += n;
 				device_event_emit ((dc_device_t *) device, DC_EVENT_PROGRESS, progress);
 			}
 
-			nbytes += len;
+			nbytes += n;
 		}
 	}
 
@@ -349,7 +345,7 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	// Allocate memory.
-	unsigned char *header = (unsigned char *) malloc (RB_LOGBOOK_SIZE * RB_LOGBOOK_COUNT);
+	unsigned char *header = (unsigned char *) dc_context_alloc (abstract->context, RB_LOGBOOK_SIZE * RB_LOGBOOK_COUNT);
 	if (header == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -360,7 +356,7 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
               NULL, 0, header, RB_LOGBOOK_SIZE * RB_LOGBOOK_COUNT);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to read the header.");
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return rc;
 	}
 
@@ -405,7 +401,7 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
 			end >= RB_PROFILE_END)
 		{
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).", begin, end);
-			free (header);
+			dc_context_dealloc (abstract->context, header);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -428,15 +424,15 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
 
 	// Finish immediately if there are no dives available.
 	if (ndives == 0) {
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return DC_STATUS_SUCCESS;
 	}
 
 	// Allocate enough memory for the largest dive.
-	unsigned char *profile = (unsigned char *) malloc (maxsize);
+	unsigned char *profile = (unsigned char *) dc_context_alloc (abstract->context, maxsize);
 	if (profile == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return DC_STATUS_NOMEMORY;
 	}
 
@@ -458,16 +454,16 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
 			number, sizeof (number), profile, length);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to read the dive.");
-			free (profile);
-			free (header);
+			dc_context_dealloc (abstract->context, profile);
+			dc_context_dealloc (abstract->context, header);
 			return rc;
 		}
 
 		// Verify the header in the logbook and profile are identical.
 		if (memcmp (profile, header + offset, RB_LOGBOOK_SIZE) != 0) {
 			ERROR (abstract->context, "Unexpected profile header.");
-			free (profile);
-			free (header);
+			dc_context_dealloc (abstract->context, profile);
+			dc_context_dealloc (abstract->context, header);
 			return rc;
 
 		}
@@ -476,8 +472,8 @@ hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void
 			break;
 	}
 
-	free (profile);
-	free (header);
+	dc_context_dealloc (abstract->context, profile);
+	dc_context_dealloc (abstract->context, header);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -20,7 +20,6 @@
  */
 
 #include <string.h> // memcmp, memcpy
-#include <stdlib.h> // malloc, free
 
 #include <libdivecomputer/hw_ostc.h>
 
@@ -29,6 +28,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 #include "ihex.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &hw_ostc_device_vtable)
@@ -210,8 +210,161 @@ hw_ostc_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[
 }
 
 
+/*
+ * Index of the dive header or footer markers in the profile data.
+ */
+typedef struct hw_ostc_markers_t {
+	unsigned int *offsets;
+	unsigned int count;
+	unsigned int capacity;
+} hw_ostc_markers_t;
+
+/*
+ * Incremental extraction state for a download in progress.
+ */
+typedef struct hw_ostc_scan_t {
+	hw_ostc_markers_t headers;
+	hw_ostc_markers_t footers;
+	unsigned int offset; /* First unscanned byte of the profile data. */
+} hw_ostc_scan_t;
+
+static const unsigned char hw_ostc_header[2] = {0xFA, 0xFA};
+static const unsigned char hw_ostc_footer[2] = {0xFD, 0xFD};
+
+
 static dc_status_t
-hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
+hw_ostc_markers_append (dc_context_t *context, hw_ostc_markers_t *markers, const unsigned char data[], unsigned int begin, unsigned int end, const unsigned char marker[], unsigned int msize)
+{
+	if (begin >= end)
+		return DC_STATUS_SUCCESS;
+
+	unsigned int n = array_search_all (data + begin, end - begin, marker, msize, NULL, 0);
+	if (n == 0)
+		return DC_STATUS_SUCCESS;
+
+	// Grow the index if necessary.
+	if (markers->count + n > markers->capacity) {
+		unsigned int capacity = markers->capacity ? markers->capacity * 2 : 64;
+		while (capacity < markers->count + n)
+			capacity *= 2;
+
+		unsigned int *offsets = (unsigned int *) dc_context_realloc (context, markers->offsets, capacity * sizeof (unsigned int));
+		if (offsets == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		markers->offsets = offsets;
+		markers->capacity = capacity;
+	}
+
+	unsigned int *offsets = markers->offsets + markers->count;
+	array_search_all (data + begin, end - begin, marker, msize, offsets, n);
+	for (unsigned int i = 0; i < n; ++i) {
+		offsets[i] += begin;
+	}
+
+	markers->count += n;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static void
+hw_ostc_markers_free (dc_context_t *context, hw_ostc_markers_t *markers)
+{
+	dc_context_dealloc (context, markers->offsets);
+	markers->offsets = NULL;
+	markers->count = markers->capacity = 0;
+}
+
+
+static dc_status_t
+hw_ostc_scan_update (dc_device_t *abstract, hw_ostc_scan_t *scan, const unsigned char profiles[], unsigned int length)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	rc = hw_ostc_markers_append (abstract->context, &scan->headers, profiles,
+		scan->offset, length, hw_ostc_header, sizeof (hw_ostc_header));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	rc = hw_ostc_markers_append (abstract->context, &scan->footers, profiles,
+		scan->offset, length, hw_ostc_footer, sizeof (hw_ostc_footer));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// A marker may still start in the last byte.
+	if (length > scan->offset + 1)
+		scan->offset = length - 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+hw_ostc_extract_markers (hw_ostc_device_t *device, const unsigned char profiles[], unsigned int length, const hw_ostc_markers_t *headers, const hw_ostc_markers_t *footers, dc_dive_callback_t callback, void *userdata)
+{
+	// Initialize the data stream offsets.
+	unsigned int current  = length;
+	unsigned int previous = length;
+
+	// Walk the header markers, starting with the most recent dive.
+	unsigned int f = footers->count;
+	for (unsigned int h = headers->count; h-- > 0; ) {
+		// Skip header markers overlapping with the previous one.
+		if (headers->offsets[h] + sizeof (hw_ostc_header) > current)
+			continue;
+
+		current = headers->offsets[h];
+
+		// Once a header marker is found, locate the first
+		// corresponding footer marker. The search is limited
+		// to the start of the previous dive.
+		while (f > 0 && footers->offsets[f - 1] >= current)
+			f--;
+
+		if (f < footers->count && footers->offsets[f] + sizeof (hw_ostc_footer) <= previous) {
+			// Move the offset to the end of the footer.
+			unsigned int end = footers->offsets[f] + sizeof (hw_ostc_footer);
+
+			const unsigned char *dive = profiles + current;
+			if (device && memcmp (dive + 3, device->fingerprint, sizeof (device->fingerprint)) == 0)
+				break;
+
+			if (callback && !callback (dive, end - current, dive + 3, 5, userdata))
+				break;
+		}
+
+		// Prepare for the next iteration.
+		previous = current;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static void
+hw_ostc_device_devinfo (dc_device_t *abstract, const unsigned char header[])
+{
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.firmware = array_uint16_be (header + 264);
+	devinfo.serial = array_uint16_le (header + 6);
+	if (devinfo.serial > 7000)
+		devinfo.model = 3; // OSTC 2C
+	else if (devinfo.serial > 2048)
+		devinfo.model = 2; // OSTC 2N
+	else if (devinfo.serial > 300)
+		devinfo.model = 1; // OSTC Mk2
+	else
+		devinfo.model = 0; // OSTC
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+}
+
+
+static dc_status_t
+hw_ostc_device_download (dc_device_t *abstract, dc_buffer_t *buffer, hw_ostc_scan_t *scan)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	hw_ostc_device_t *device = (hw_ostc_device_t*) abstract;
@@ -250,6 +403,11 @@ hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return DC_STATUS_DATAFORMAT;
 	}
 
+	// The device info is available before the profile data.
+	if (scan) {
+		hw_ostc_device_devinfo (abstract, header);
+	}
+
 	// Get the firmware version.
 	unsigned int firmware = array_uint16_be (header + 264);
 
@@ -281,65 +439,103 @@ hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		// Set the minimum packet size.
 		unsigned int len = 1024;
 
-		// Increase the packet size if more data is immediately available.
-		size_t available = 0;
-		status = dc_serial_get_available (device->port, &available);
-		if (status == DC_STATUS_SUCCESS && available > len)
-			len = available;
-
 		// Limit the packet size to the total size.
 		if (nbytes + len > size)
 			len = size - nbytes;
 
-		// Read the packet.
-		status = dc_serial_read (device->port, data + nbytes, len, NULL);
+		// Read the packet, including any additional data that is
+		// immediately available.
+		size_t n = 0;
+		status = dc_serial_read_some (device->port, data + nbytes, len, size - nbytes, &n);
 		if (status != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return status;
 		}
 
 		// Update and emit a progress event.
-		progress.current += len;
+		progress.current += n;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-		nbytes += len;
+		nbytes += n;
+
+		// Index the dive markers while the next packet is in flight.
+		if (scan) {
+			status = hw_ostc_scan_update (abstract, scan, data + SZ_HEADER, nbytes - SZ_HEADER);
+			if (status != DC_STATUS_SUCCESS)
+				return status;
+		}
 	}
 
 	return DC_STATUS_SUCCESS;
 }
 
 
+static dc_status_t
+hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Serve the memory image from the cache, if available.
+	if (device_cache_get (abstract, buffer))
+		return DC_STATUS_SUCCESS;
+
+	status = hw_ostc_device_download (abstract, buffer, NULL);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	// Keep the memory image for the rest of the session.
+	device_cache_put (abstract, buffer);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 static dc_status_t
 hw_ostc_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	hw_ostc_device_t *device = (hw_ostc_device_t *) abstract;
+
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	dc_status_t rc = hw_ostc_device_dump (abstract, buffer);
-	if (rc != DC_STATUS_SUCCESS) {
+	// A cached memory image is extracted in one go. The device info
+	// event of the original transfer has already been emitted again,
+	// unless the image was cached by a plain dump.
+	if (device_cache_get (abstract, buffer)) {
+		if (!device_devinfo_known (abstract))
+			hw_ostc_device_devinfo (abstract, dc_buffer_get_data (buffer));
+
+		device_dives_set (abstract, buffer);
+		dc_status_t rc = hw_ostc_extract_dives (abstract, dc_buffer_get_const_data (buffer),
+			dc_buffer_get_size (buffer), callback, userdata);
+		device_dives_set (abstract, NULL);
+
 		dc_buffer_free (buffer);
+
 		return rc;
 	}
 
-	// Emit a device info event.
-	unsigned char *data = dc_buffer_get_data (buffer);
-	dc_event_devinfo_t devinfo;
-	devinfo.firmware = array_uint16_be (data + 264);
-	devinfo.serial = array_uint16_le (data + 6);
-	if (devinfo.serial > 7000)
-		devinfo.model = 3; // OSTC 2C
-	else if (devinfo.serial > 2048)
-		devinfo.model = 2; // OSTC 2N
-	else if (devinfo.serial > 300)
-		devinfo.model = 1; // OSTC Mk2
-	else
-		devinfo.model = 0; // OSTC
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
-
-	rc = hw_ostc_extract_dives (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), callback, userdata);
+	// Otherwise the dive markers are indexed during the download, so
+	// the dives are ready as soon as the last packet arrives. The
+	// profile memory is sent oldest dive first, so the extraction itself
+	// (and the fingerprint check) still has to wait for the last packet.
+	hw_ostc_scan_t scan = {{NULL, 0, 0}, {NULL, 0, 0}, 0};
+	dc_status_t rc = hw_ostc_device_download (abstract, buffer, &scan);
+	if (rc == DC_STATUS_SUCCESS) {
+		// Keep the memory image for the rest of the session.
+		device_cache_put (abstract, buffer);
+
+		device_dives_set (abstract, buffer);
+		rc = hw_ostc_extract_markers (device,
+			dc_buffer_get_const_data (buffer) + SZ_HEADER,
+			dc_buffer_get_size (buffer) - SZ_HEADER,
+			&scan.headers, &scan.footers, callback, userdata);
+		device_dives_set (abstract, NULL);
+	}
 
+	hw_ostc_markers_free (abstract->context, &scan.headers);
+	hw_ostc_markers_free (abstract->context, &scan.footers);
 	dc_buffer_free (buffer);
 
 	return rc;
@@ -636,44 +832,35 @@ hw_ostc_device_screenshot (dc_device_t *abstract, dc_buffer_t *buffer, hw_ostc_f
 dc_status_t
 hw_ostc_extract_dives (dc_device_t *abstract, const unsigned char data[], unsigned int size, dc_dive_callback_t callback, void *userdata)
 {
+	dc_status_t rc = DC_STATUS_SUCCESS;
 	hw_ostc_device_t *device = (hw_ostc_device_t *) abstract;
+	dc_context_t *context = (abstract ? abstract->context : NULL);
 
 	if (abstract && !ISINSTANCE (abstract))
 		return DC_STATUS_INVALIDARGS;
 
-	const unsigned char header[2] = {0xFA, 0xFA};
-	const unsigned char footer[2] = {0xFD, 0xFD};
-
-	// Initialize the data stream pointers.
-	const unsigned char *current  = data + size;
-	const unsigned char *previous = data + size;
-
-	// Search the data stream for header markers.
-	while ((current = array_search_backward (data + 266, current - data - 266, header, sizeof (header))) != NULL) {
-		// Move the pointer to the begin of the header.
-		current -= sizeof (header);
-
-		// Once a header marker is found, start searching
-		// for the corresponding footer marker. The search is
-		// now limited to the start of the previous dive.
-		previous = array_search_forward (current, previous - current, footer, sizeof (footer));
-
-		if (previous) {
-			// Move the pointer to the end of the footer.
-			previous += sizeof (footer);
+	if (size < SZ_HEADER)
+		return DC_STATUS_DATAFORMAT;
 
-			if (device && memcmp (current + 3, device->fingerprint, sizeof (device->fingerprint)) == 0)
-				return DC_STATUS_SUCCESS;
+	// Index all header and footer markers in a single pass over the
+	// data, and turn the extraction into a walk over the boundary lists.
+	const unsigned char *profiles = data + SZ_HEADER;
+	unsigned int length = size - SZ_HEADER;
+	hw_ostc_markers_t headers = {NULL, 0, 0}, footers = {NULL, 0, 0};
+	rc = hw_ostc_markers_append (context, &headers, profiles, 0, length, hw_ostc_header, sizeof (hw_ostc_header));
+	if (rc != DC_STATUS_SUCCESS)
+		goto error_free;
 
-			if (callback && !callback (current, previous - current, current + 3, 5, userdata))
-				return DC_STATUS_SUCCESS;
-		}
+	rc = hw_ostc_markers_append (context, &footers, profiles, 0, length, hw_ostc_footer, sizeof (hw_ostc_footer));
+	if (rc != DC_STATUS_SUCCESS)
+		goto error_free;
 
-		// Prepare for the next iteration.
-		previous = current;
-	}
+	rc = hw_ostc_extract_markers (device, profiles, length, &headers, &footers, callback, userdata);
 
-	return DC_STATUS_SUCCESS;
+error_free:
+	hw_ostc_markers_free (context, &headers);
+	hw_ostc_markers_free (context, &footers);
+	return rc;
 }
 
 
@@ -887,7 +1074,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 		return DC_STATUS_INVALIDARGS;
 
 	// Allocate memory for the firmware data.
-	hw_ostc_firmware_t *firmware = (hw_ostc_firmware_t *) malloc (sizeof (hw_ostc_firmware_t));
+	hw_ostc_firmware_t *firmware = (hw_ostc_firmware_t *) dc_context_alloc (context, sizeof (hw_ostc_firmware_t));
 	if (firmware == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -897,7 +1084,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 	rc = hw_ostc_firmware_readfile (firmware, context, filename);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to read the firmware file.");
-		free (firmware);
+		dc_context_dealloc (context, firmware);
 		return rc;
 	}
 
@@ -914,7 +1101,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 		rc = dc_serial_configure (device->port, baudrates[i], 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to set the terminal attributes.");
-			free (firmware);
+			dc_context_dealloc (context, firmware);
 			return rc;
 		}
 
@@ -926,7 +1113,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 	}
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to setup the bootloader.");
-		free (firmware);
+		dc_context_dealloc (context, firmware);
 		return rc;
 	}
 
@@ -958,7 +1145,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 		rc = hw_ostc_firmware_write (device, packet, sizeof (packet));
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to send the packet.");
-			free (firmware);
+			dc_context_dealloc (context, firmware);
 			return rc;
 		}
 
@@ -967,7 +1154,7 @@ hw_ostc_device_fwupdate (dc_device_t *abstract, const char *filename)
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 	}
 
-	free (firmware);
+	dc_context_dealloc (context, firmware);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -21,7 +21,6 @@
  */
 
 #include <string.h> // memcmp, memcpy
-#include <stdlib.h> // malloc, free
 #include <stdio.h>  // FILE, fopen
 
 #include <libdivecomputer/hw_ostc3.h>
@@ -30,6 +29,7 @@
 #include "device-private.h"
 #include "serial.h"
 #include "array.h"
+#include "buffer-private.h"
 #include "aes.h"
 
 #ifdef _MSC_VER
@@ -256,18 +256,14 @@ hw_ostc3_transfer (hw_ostc3_device_t *device,
 			// Set the minimum packet size.
 			unsigned int len = 1024;
 
-			// Increase the packet size if more data is immediately available.
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > len)
-				len = available;
-
 			// Limit the packet size to the total size.
 			if (nbytes + len > osize)
 				len = osize - nbytes;
 
-			// Read the packet.
-			status = dc_serial_read (device->port, output + nbytes, len, NULL);
+			// Read the packet, including any additional data that is
+			// immediately available.
+			size_t n = 0;
+			status = dc_serial_read_some (device->port, output + nbytes, len, osize - nbytes, &n);
 			if (status != DC_STATUS_SUCCESS) {
 				ERROR (abstract->context, "Failed to receive the answer.");
 				return status;
@@ -275,24 +271,17 @@ hw_ostc3_transfer (hw_ostc3_device_t *device,
 
 			// Update and emit a progress event.
 			if (progress) {
-				progress->current += len;
+				progress->current += n;
 				device_event_emit ((dc_device_t *) device, DC_EVENT_PROGRESS, progress);
 			}
 
-			nbytes += len;
+			nbytes += n;
 		}
 	}
 
 	if (delay) {
-		unsigned int count = delay / 100;
-		for (unsigned int i = 0; i < count; ++i) {
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > 0)
-				break;
-
-			dc_serial_sleep (device->port, 100);
-		}
+		// Wait until the device is ready, or the delay expires.
+		dc_serial_wait (device->port, delay);
 	}
 
 	if (cmd != EXIT) {
@@ -648,7 +637,7 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	// Allocate memory.
-	unsigned char *header = (unsigned char *) malloc (RB_LOGBOOK_SIZE_FULL * RB_LOGBOOK_COUNT);
+	unsigned char *header = (unsigned char *) dc_context_alloc (abstract->context, RB_LOGBOOK_SIZE_FULL * RB_LOGBOOK_COUNT);
 	if (header == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -667,7 +656,7 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 	}
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to read the header.");
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return rc;
 	}
 
@@ -704,6 +693,7 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 	}
 
 	// Calculate the total and maximum size.
+	unsigned int nentries = 0;
 	unsigned int ndives = 0;
 	unsigned int size = 0;
 	unsigned int maxsize = 0;
@@ -732,6 +722,12 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 		if (memcmp (header + offset + logbook->fingerprint, device->fingerprint, sizeof (device->fingerprint)) == 0)
 			break;
 
+		nentries++;
+
+		// Skip dives that are already known.
+		if (device_fingerprint_known (abstract, header + offset + logbook->fingerprint, sizeof (device->fingerprint)))
+			continue;
+
 		if (length > maxsize)
 			maxsize = length;
 		size += length;
@@ -744,23 +740,27 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 
 	// Finish immediately if there are no dives available.
 	if (ndives == 0) {
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return DC_STATUS_SUCCESS;
 	}
 
 	// Allocate enough memory for the largest dive.
-	unsigned char *profile = (unsigned char *) malloc (maxsize);
+	unsigned char *profile = (unsigned char *) dc_context_alloc (abstract->context, maxsize);
 	if (profile == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
-		free (header);
+		dc_context_dealloc (abstract->context, header);
 		return DC_STATUS_NOMEMORY;
 	}
 
 	// Download the dives.
-	for (unsigned int i = 0; i < ndives; ++i) {
+	for (unsigned int i = 0; i < nentries; ++i) {
 		unsigned int idx = (latest + RB_LOGBOOK_COUNT - i) % RB_LOGBOOK_COUNT;
 		unsigned int offset = idx * logbook->size;
 
+		// Skip dives that are already known.
+		if (device_fingerprint_known (abstract, header + offset + logbook->fingerprint, sizeof (device->fingerprint)))
+			continue;
+
 		// Calculate the profile length.
 		unsigned int length = RB_LOGBOOK_SIZE_FULL + array_uint24_le (header + offset + logbook->profile) - 3;
 		if (!compact) {
@@ -776,16 +776,16 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 			number, sizeof (number), profile, length, NODELAY);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to read the dive.");
-			free (profile);
-			free (header);
+			dc_context_dealloc (abstract->context, profile);
+			dc_context_dealloc (abstract->context, header);
 			return rc;
 		}
 
 		// Verify the header in the logbook and profile are identical.
 		if (!compact && memcmp (profile, header + offset, logbook->size) != 0) {
 			ERROR (abstract->context, "Unexpected profile header.");
-			free (profile);
-			free (header);
+			dc_context_dealloc (abstract->context, profile);
+			dc_context_dealloc (abstract->context, header);
 			return rc;
 		}
 
@@ -793,8 +793,8 @@ hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, voi
 			break;
 	}
 
-	free (profile);
-	free (header);
+	dc_context_dealloc (abstract->context, profile);
+	dc_context_dealloc (abstract->context, header);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -1239,7 +1239,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Allocate memory for the firmware data.
-	hw_ostc3_firmware_t *firmware = (hw_ostc3_firmware_t *) malloc (sizeof (hw_ostc3_firmware_t));
+	hw_ostc3_firmware_t *firmware = (hw_ostc3_firmware_t *) dc_context_alloc (context, sizeof (hw_ostc3_firmware_t));
 	if (firmware == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -1248,7 +1248,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 	// Read the hex file.
 	rc = hw_ostc3_firmware_readfile3 (firmware, context, filename);
 	if (rc != DC_STATUS_SUCCESS) {
-		free (firmware);
+		dc_context_dealloc (context, firmware);
 		return rc;
 	}
 
@@ -1261,7 +1261,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 	rc = hw_ostc3_firmware_erase (device, FIRMWARE_AREA, SZ_FIRMWARE);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to erase old firmware");
-		free (firmware);
+		dc_context_dealloc (context, firmware);
 		return rc;
 	}
 
@@ -1279,7 +1279,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 		rc = hw_ostc3_firmware_block_write (device, FIRMWARE_AREA + len, firmware->data + len, SZ_FIRMWARE_BLOCK);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (context, "Failed to write block to device");
-			free(firmware);
+			dc_context_dealloc (context, firmware);
 			return rc;
 		}
 		// One block uploaded
@@ -1298,13 +1298,13 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 		rc = hw_ostc3_firmware_block_read (device, FIRMWARE_AREA + len, block, sizeof (block));
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (context, "Failed to read block.");
-			free (firmware);
+			dc_context_dealloc (context, firmware);
 			return rc;
 		}
 		if (memcmp (firmware->data + len, block, sizeof (block)) != 0) {
 			ERROR (context, "Failed verify.");
 			hw_ostc3_device_display (abstract, " Verify FAILED");
-			free (firmware);
+			dc_context_dealloc (context, firmware);
 			return DC_STATUS_PROTOCOL;
 		}
 		// One block verified
@@ -1317,7 +1317,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 	rc = hw_ostc3_firmware_upgrade (abstract, firmware->checksum);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to start programing");
-		free (firmware);
+		dc_context_dealloc (context, firmware);
 		return rc;
 	}
 
@@ -1325,7 +1325,7 @@ hw_ostc3_device_fwupdate3 (dc_device_t *abstract, const char *filename)
 	progress.current++;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-	free (firmware);
+	dc_context_dealloc (context, firmware);
 
 	// Finished!
 	return DC_STATUS_SUCCESS;
@@ -1339,7 +1339,7 @@ hw_ostc3_device_fwupdate4 (dc_device_t *abstract, const char *filename)
 	dc_context_t *context = (abstract ? abstract->context : NULL);
 
 	// Allocate memory for the firmware data.
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		status = DC_STATUS_NOMEMORY;
@@ -44,7 +44,7 @@ dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *f
 		return DC_STATUS_INVALIDARGS;
 	}
 
-	file = (dc_ihex_file_t *) malloc (sizeof (dc_ihex_file_t));
+	file = (dc_ihex_file_t *) dc_context_alloc (context, sizeof (dc_ihex_file_t));
 	if (file == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -55,7 +55,7 @@ dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *f
 	file->fp = fopen (filename, "rb");
 	if (file->fp == NULL) {
 		ERROR (context, "Failed to open the file.");
-		free (file);
+		dc_context_dealloc (context, file);
 		return DC_STATUS_IO;
 	}
 
@@ -199,7 +199,7 @@ dc_ihex_file_close (dc_ihex_file_t *file)
 {
 	if (file) {
 		fclose (file->fp);
-		free (file);
+		dc_context_dealloc (file->context, file);
 	}
 
 	return DC_STATUS_SUCCESS;
@@ -19,7 +19,6 @@
  * MA 02110-1301 USA
  */
 
-#include <stdlib.h> // malloc, free
 #include <stdio.h>	// snprintf
 #ifdef _WIN32
 	#define NOGDI
@@ -110,7 +109,7 @@ dc_irda_open (dc_irda_t **out, dc_context_t *context)
 		return DC_STATUS_INVALIDARGS;
 
 	// Allocate memory.
-	device = (dc_irda_t *) malloc (sizeof (dc_irda_t));
+	device = (dc_irda_t *) dc_context_alloc (context, sizeof (dc_irda_t));
 	if (device == NULL) {
 		SYSERROR (context, S_ENOMEM);
 		return DC_STATUS_NOMEMORY;
@@ -162,7 +161,7 @@ error_wsacleanup:
 	WSACleanup ();
 error_free:
 #endif
-	free (device);
+	dc_context_dealloc (context, device);
 	return status;
 }
 
@@ -194,7 +193,7 @@ dc_irda_close (dc_irda_t *device)
 #endif
 
 	// Free memory.
-	free (device);
+	dc_context_dealloc (device->context, device);
 
 	return status;
 }
@@ -268,11 +267,7 @@ dc_irda_discover (dc_irda_t *device, dc_irda_callback_t callback, void *userdata
 		// modified by the previous getsockopt call.
 		size = sizeof (data);
 
-#ifdef _WIN32
-		Sleep (1000);
-#else
-		sleep (1);
-#endif
+		dc_context_sleep (device->context, 1000);
 	}
 
 	if (callback) {
@@ -30,6 +30,8 @@
 
 #define MAXRETRIES 4
 
+#define CMDSIZE (2 * (4 + 2))
+
 #define FP_OFFSET 8
 #define FP_SIZE   5
 
@@ -55,6 +57,8 @@ mares_common_device_init (mares_common_device_t *device)
 	device->port = NULL;
 	device->echo = 0;
 	device->delay = 0;
+	device->packetsize = 0;
+	device->pipeline = 0;
 }
 
 
@@ -78,8 +82,22 @@ mares_common_make_ascii (const unsigned char raw[], unsigned int rsize, unsigned
 }
 
 
+static void
+mares_common_make_read (unsigned int address, unsigned int len, unsigned char command[], unsigned int csize)
+{
+	// Build the raw command.
+	unsigned char raw[] = {0x51,
+		(address     ) & 0xFF, // Low
+		(address >> 8) & 0xFF, // High
+		len}; // Count
+
+	// Build the ascii command.
+	mares_common_make_ascii (raw, sizeof (raw), command, csize);
+}
+
+
 static dc_status_t
-mares_common_packet (mares_common_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+mares_common_send (mares_common_device_t *device, const unsigned char command[], unsigned int csize)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
@@ -98,47 +116,68 @@ mares_common_packet (mares_common_device_t *device, const unsigned char command[
 		return status;
 	}
 
-	if (device->echo) {
-		// Receive the echo of the command.
-		unsigned char echo[PACKETSIZE] = {0};
-		status = dc_serial_read (device->port, echo, csize, NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to receive the echo.");
-			return status;
-		}
+	return DC_STATUS_SUCCESS;
+}
 
-		// Verify the echo.
-		if (memcmp (echo, command, csize) != 0) {
-			WARNING (abstract->context, "Unexpected echo.");
-		}
-	}
 
-	// Receive the answer of the device.
-	status = dc_serial_read (device->port, answer, asize, NULL);
+static dc_status_t
+mares_common_receive (mares_common_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_device_t *abstract = (dc_device_t *) device;
+
+	// Receive the echo of the command and the answer of the device
+	// with a single read, and verify the echo afterwards.
+	unsigned int esize = device->echo ? csize : 0;
+	unsigned char packet[CMDSIZE + 2 * (MAXPACKETSIZE + 2)] = {0};
+	assert (esize + asize <= sizeof (packet));
+	status = dc_serial_read (device->port, packet, esize + asize, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
 	}
 
+	// Verify the echo.
+	if (esize && memcmp (packet, command, esize) != 0) {
+		WARNING (abstract->context, "Unexpected echo.");
+	}
+
+	const unsigned char *data = packet + esize;
+
 	// Verify the header and trailer of the packet.
-	if (answer[0] != '<' || answer[asize - 1] != '>') {
+	if (data[0] != '<' || data[asize - 1] != '>') {
 		ERROR (abstract->context, "Unexpected answer header/trailer byte.");
 		return DC_STATUS_PROTOCOL;
 	}
 
 	// Verify the checksum of the packet.
 	unsigned char crc = 0;
-	unsigned char ccrc = checksum_add_uint8 (answer + 1, asize - 4, 0x00);
-	array_convert_hex2bin (answer + asize - 3, 2, &crc, 1);
+	unsigned char ccrc = checksum_add_uint8 (data + 1, asize - 4, 0x00);
+	array_convert_hex2bin (data + asize - 3, 2, &crc, 1);
 	if (crc != ccrc) {
 		ERROR (abstract->context, "Unexpected answer checksum.");
 		return DC_STATUS_PROTOCOL;
 	}
 
+	memcpy (answer, data, asize);
+
 	return DC_STATUS_SUCCESS;
 }
 
 
+static dc_status_t
+mares_common_packet (mares_common_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	status = mares_common_send (device, command, csize);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	return mares_common_receive (device, command, csize, answer, asize);
+}
+
+
 static dc_status_t
 mares_common_transfer (mares_common_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
 {
@@ -163,33 +202,130 @@ mares_common_transfer (mares_common_device_t *device, const unsigned char comman
 }
 
 
+static dc_status_t
+mares_common_negotiate (mares_common_device_t *device, unsigned int address, unsigned char data[])
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+
+	// Request a single large packet. There are no retries here: if the
+	// device fails to answer correctly, the packet size is considered
+	// unsupported and the default size is used for the rest of the session.
+	unsigned char command[CMDSIZE] = {0};
+	unsigned char answer[2 * (MAXPACKETSIZE + 2)] = {0};
+	mares_common_make_read (address, MAXPACKETSIZE, command, sizeof (command));
+	dc_status_t rc = mares_common_packet (device, command, sizeof (command), answer, sizeof (answer));
+	if (rc != DC_STATUS_SUCCESS) {
+		if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+			return rc;
+
+		WARNING (abstract->context, "Large packets not supported, using the default packet size.");
+		device->packetsize = PACKETSIZE;
+
+		// Discard any garbage bytes.
+		dc_serial_sleep (device->port, 100);
+		dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	device->packetsize = MAXPACKETSIZE;
+
+	// Extract the raw data from the packet.
+	array_convert_hex2bin (answer + 1, 2 * MAXPACKETSIZE, data, MAXPACKETSIZE);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 mares_common_device_read (dc_device_t *abstract, unsigned int address, unsigned char data[], unsigned int size)
 {
 	mares_common_device_t *device = (mares_common_device_t*) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
 
 	unsigned int nbytes = 0;
+
+	// Negotiate the packet size on the first read that is large enough.
+	if (device->packetsize == 0 && size >= MAXPACKETSIZE) {
+		rc = mares_common_negotiate (device, address, data);
+		if (rc == DC_STATUS_SUCCESS) {
+			nbytes += MAXPACKETSIZE;
+			address += MAXPACKETSIZE;
+			data += MAXPACKETSIZE;
+		} else if (rc != DC_STATUS_UNSUPPORTED) {
+			return rc;
+		}
+	}
+
+	unsigned int packetsize = device->packetsize ? device->packetsize : PACKETSIZE;
+
+	// Pipelining is not possible with an echo, because the echo of the
+	// next command would end up in the middle of the current answer.
+	unsigned int pipeline = device->pipeline && !device->echo;
+
+	unsigned char command[CMDSIZE] = {0};
+	unsigned int pending = 0;
 	while (nbytes < size) {
 		// Calculate the packet size.
 		unsigned int len = size - nbytes;
-		if (len > PACKETSIZE)
-			len = PACKETSIZE;
-
-		// Build the raw command.
-		unsigned char raw[] = {0x51,
-			(address     ) & 0xFF, // Low
-			(address >> 8) & 0xFF, // High
-			len}; // Count
-
-		// Build the ascii command.
-		unsigned char command[2 * (sizeof (raw) + 2)] = {0};
-		mares_common_make_ascii (raw, sizeof (raw), command, sizeof (command));
-
-		// Send the command and receive the answer.
-		unsigned char answer[2 * (PACKETSIZE + 2)] = {0};
-		dc_status_t rc = mares_common_transfer (device, command, sizeof (command), answer, 2 * (len + 2));
-		if (rc != DC_STATUS_SUCCESS)
-			return rc;
+		if (len > packetsize)
+			len = packetsize;
+
+		// Build the command, unless it has already been sent.
+		if (!pending) {
+			mares_common_make_read (address, len, command, sizeof (command));
+		}
+
+		unsigned char answer[2 * (MAXPACKETSIZE + 2)] = {0};
+		if (pipeline) {
+			if (!pending) {
+				rc = mares_common_send (device, command, sizeof (command));
+				if (rc != DC_STATUS_SUCCESS)
+					return rc;
+			}
+
+			// Send the command for the next packet before receiving the
+			// answer for the current one, such that the device can start
+			// processing it immediately.
+			unsigned char next[CMDSIZE] = {0};
+			pending = 0;
+			if (nbytes + len < size) {
+				unsigned int nlen = size - nbytes - len;
+				if (nlen > packetsize)
+					nlen = packetsize;
+				mares_common_make_read (address + len, nlen, next, sizeof (next));
+				rc = mares_common_send (device, next, sizeof (next));
+				if (rc != DC_STATUS_SUCCESS)
+					return rc;
+				pending = 1;
+			}
+
+			rc = mares_common_receive (device, command, sizeof (command), answer, 2 * (len + 2));
+			if (rc != DC_STATUS_SUCCESS) {
+				if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+					return rc;
+
+				// Fall back to the regular transfer mode for the rest of the
+				// session. The answer to the pending command is discarded.
+				WARNING (abstract->context, "Pipelined transfer failed, disabling pipelining.");
+				device->pipeline = pipeline = pending = 0;
+				dc_serial_sleep (device->port, 100);
+				dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+
+				rc = mares_common_transfer (device, command, sizeof (command), answer, 2 * (len + 2));
+				if (rc != DC_STATUS_SUCCESS)
+					return rc;
+			}
+
+			if (pending) {
+				memcpy (command, next, sizeof (command));
+			}
+		} else {
+			// Send the command and receive the answer.
+			rc = mares_common_transfer (device, command, sizeof (command), answer, 2 * (len + 2));
+			if (rc != DC_STATUS_SUCCESS)
+				return rc;
+		}
 
 		// Extract the raw data from the packet.
 		array_convert_hex2bin (answer + 1, 2 * len, data, len);
@@ -224,7 +360,7 @@ mares_common_extract_dives (dc_context_t *context, const mares_common_layout_t *
 	// Make the ringbuffer linear, to avoid having to deal
 	// with the wrap point. The buffer has extra space to
 	// store the profile data for the freedives.
-	unsigned char *buffer = (unsigned char *) malloc (
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (context,
 		layout->rb_profile_end - layout->rb_profile_begin +
 		layout->rb_freedives_end - layout->rb_freedives_begin);
 	if (buffer == NULL) {
@@ -305,7 +441,7 @@ mares_common_extract_dives (dc_context_t *context, const mares_common_layout_t *
 		unsigned int length = array_uint16_le (buffer + offset);
 		if (length != nbytes) {
 			ERROR (context, "Calculated and stored size are not equal (%u %u).", length, nbytes);
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -333,7 +469,7 @@ mares_common_extract_dives (dc_context_t *context, const mares_common_layout_t *
 			// both values are different, the profile data is incomplete.
 			if (count != nsamples) {
 				ERROR (context, "Unexpected number of freedive sessions (%u %u).", count, nsamples);
-				free (buffer);
+				dc_context_dealloc (context, buffer);
 				return DC_STATUS_DATAFORMAT;
 			}
 
@@ -346,17 +482,17 @@ mares_common_extract_dives (dc_context_t *context, const mares_common_layout_t *
 
 		unsigned int fp_offset = offset + length - extra - FP_OFFSET;
 		if (fingerprint && memcmp (buffer + fp_offset, fingerprint, FP_SIZE) == 0) {
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_SUCCESS;
 		}
 
 		if (callback && !callback (buffer + offset, nbytes, buffer + fp_offset, FP_SIZE, userdata)) {
-			free (buffer);
+			dc_context_dealloc (context, buffer);
 			return DC_STATUS_SUCCESS;
 		}
 	}
 
-	free (buffer);
+	dc_context_dealloc (context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
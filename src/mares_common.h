@@ -29,7 +29,9 @@
 extern "C" {
 #endif /* __cplusplus */
 
-#define PACKETSIZE 0x20
+#define PACKETSIZE    0x20
+#define MAXPACKETSIZE 0x80
+#define BLOCKSIZE     0x400
 
 typedef struct mares_common_layout_t {
 	unsigned int memsize;
@@ -44,6 +46,8 @@ typedef struct mares_common_device_t {
 	dc_serial_t *port;
 	unsigned int echo;
 	unsigned int delay;
+	unsigned int packetsize; /* Negotiated packet size, zero if unknown. */
+	unsigned int pipeline; /* Overlap the next request with the current answer. */
 } mares_common_device_t;
 
 void
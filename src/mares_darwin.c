@@ -30,6 +30,7 @@
 #include "device-private.h"
 #include "mares_common.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &mares_darwin_device_vtable)
 
@@ -142,6 +143,9 @@ mares_darwin_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->base.port, 0);
+
 	// Set the DTR line.
 	status = dc_serial_set_dtr (device->base.port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -224,7 +228,7 @@ mares_darwin_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	}
 
 	return device_dump_read (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), PACKETSIZE);
+		dc_buffer_get_size (buffer), BLOCKSIZE);
 }
 
 
@@ -235,7 +239,7 @@ mares_darwin_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 
 	assert (device->layout != NULL);
 
-	dc_buffer_t *buffer = dc_buffer_new (device->layout->memsize);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, device->layout->memsize);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -289,7 +293,7 @@ mares_darwin_extract_dives (dc_device_t *abstract, const unsigned char data[], u
 	}
 
 	// Allocate memory for the largest possible dive.
-	unsigned char *buffer = (unsigned char *) malloc (layout->rb_logbook_size + layout->rb_profile_end - layout->rb_profile_begin);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (abstract->context, layout->rb_logbook_size + layout->rb_profile_end - layout->rb_profile_begin);
 	if (buffer == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -329,19 +333,19 @@ mares_darwin_extract_dives (dc_device_t *abstract, const unsigned char data[], u
 		}
 
 		if (device && memcmp (buffer, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-			free (buffer);
+			dc_context_dealloc (abstract->context, buffer);
 			return DC_STATUS_SUCCESS;
 		}
 
 		if (callback && !callback (buffer, layout->rb_logbook_size + length, buffer, 6, userdata)) {
-			free (buffer);
+			dc_context_dealloc (abstract->context, buffer);
 			return DC_STATUS_SUCCESS;
 		}
 
 		remaining -= length;
 	}
 
-	free (buffer);
+	dc_context_dealloc (abstract->context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
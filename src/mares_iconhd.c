@@ -29,6 +29,7 @@
 #include "device-private.h"
 #include "serial.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
 
@@ -183,16 +184,14 @@ mares_iconhd_transfer (mares_iconhd_device_t *device,
 		}
 	}
 
-	// Read the packet.
-	status = dc_serial_read (device->port, answer, asize, NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to receive the answer.");
-		return status;
-	}
-
-	// Receive the trailer byte.
+	// Read the packet and the trailer byte.
 	unsigned char trailer[1] = {0};
-	status = dc_serial_read (device->port, trailer, sizeof (trailer), NULL);
+	dc_iovec_t iov[2];
+	iov[0].data = answer;
+	iov[0].size = asize;
+	iov[1].data = trailer;
+	iov[1].size = sizeof (trailer);
+	status = dc_serial_readv (device->port, iov, 2, NULL);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the answer.");
 		return status;
@@ -253,6 +252,9 @@ mares_iconhd_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Clear the DTR line.
 	status = dc_serial_set_dtr (device->port, 0);
 	if (status != DC_STATUS_SUCCESS) {
@@ -406,8 +408,19 @@ mares_iconhd_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	vendor.size = sizeof (device->version);
 	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
 
-	return device_dump_read (abstract, dc_buffer_get_data (buffer),
+	// Serve the memory image from the cache, if available.
+	if (device_cache_get (abstract, buffer))
+		return DC_STATUS_SUCCESS;
+
+	dc_status_t rc = device_dump_read (abstract, dc_buffer_get_data (buffer),
 		dc_buffer_get_size (buffer), device->packetsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Keep the memory image for the rest of the session.
+	device_cache_put (abstract, buffer);
+
+	return DC_STATUS_SUCCESS;
 }
 
 
@@ -416,23 +429,32 @@ mares_iconhd_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 {
 	mares_iconhd_device_t *device = (mares_iconhd_device_t *) abstract;
 
-	dc_buffer_t *buffer = dc_buffer_new (device->layout->memsize);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, device->layout->memsize);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	dc_status_t rc = mares_iconhd_device_dump (abstract, buffer);
-	if (rc != DC_STATUS_SUCCESS) {
-		dc_buffer_free (buffer);
-		return rc;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	int cached = device_cache_get (abstract, buffer);
+	if (!cached) {
+		rc = mares_iconhd_device_dump (abstract, buffer);
+		if (rc != DC_STATUS_SUCCESS) {
+			dc_buffer_free (buffer);
+			return rc;
+		}
 	}
 
-	// Emit a device info event.
-	unsigned char *data = dc_buffer_get_data (buffer);
-	dc_event_devinfo_t devinfo;
-	devinfo.model = device->model;
-	devinfo.firmware = 0;
-	devinfo.serial = array_uint32_le (data + 0x0C);
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	// On a cache hit, the device info event of the original transfer
+	// has already been emitted again, unless the image was cached by a
+	// plain dump.
+	if (!cached || !device_devinfo_known (abstract)) {
+		// Emit a device info event.
+		unsigned char *data = dc_buffer_get_data (buffer);
+		dc_event_devinfo_t devinfo;
+		devinfo.model = device->model;
+		devinfo.firmware = 0;
+		devinfo.serial = array_uint32_le (data + 0x0C);
+		device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	}
 
 	rc = mares_iconhd_extract_dives (abstract, dc_buffer_get_data (buffer),
 		dc_buffer_get_size (buffer), callback, userdata);
@@ -485,12 +507,17 @@ mares_iconhd_extract_dives (dc_device_t *abstract, const unsigned char data[], u
 	}
 
 	// Make the ringbuffer linear, to avoid having to deal with the wrap point.
-	unsigned char *buffer = (unsigned char *) malloc (layout->rb_profile_end - layout->rb_profile_begin);
-	if (buffer == NULL) {
+	// The dives are passed to the callback from this buffer, which remains
+	// unchanged afterwards, such that they can be retained without a copy.
+	dc_buffer_t *profiles = dc_buffer_allocate (context, layout->rb_profile_end - layout->rb_profile_begin);
+	if (profiles == NULL || !dc_buffer_resize (profiles, layout->rb_profile_end - layout->rb_profile_begin)) {
 		ERROR (context, "Failed to allocate memory.");
+		dc_buffer_free (profiles);
 		return DC_STATUS_NOMEMORY;
 	}
 
+	unsigned char *buffer = dc_buffer_get_data (profiles);
+
 	memcpy (buffer + 0, data + eop, layout->rb_profile_end - eop);
 	memcpy (buffer + layout->rb_profile_end - eop, data + layout->rb_profile_begin, eop - layout->rb_profile_begin);
 
@@ -565,18 +592,17 @@ mares_iconhd_extract_dives (dc_device_t *abstract, const unsigned char data[], u
 			break;
 
 		unsigned char *fp = buffer + offset + length - headersize + fingerprint;
-		if (device && memcmp (fp, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-			free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		if (device && memcmp (fp, device->fingerprint, sizeof (device->fingerprint)) == 0)
+			break;
 
-		if (callback && !callback (buffer + offset, length, fp, sizeof (device->fingerprint), userdata)) {
-			free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		device_dives_set (abstract, profiles);
+		int proceed = !callback || callback (buffer + offset, length, fp, sizeof (device->fingerprint), userdata);
+		device_dives_set (abstract, NULL);
+		if (!proceed)
+			break;
 	}
 
-	free (buffer);
+	dc_buffer_free (profiles);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -30,6 +30,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &mares_nemo_device_vtable)
 
@@ -124,6 +125,9 @@ mares_nemo_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line.
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -206,13 +210,11 @@ mares_nemo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Wait until some data arrives.
-	size_t available = 0;
-	while (dc_serial_get_available (device->port, &available) == DC_STATUS_SUCCESS && available == 0) {
+	while (dc_serial_wait (device->port, 100) == DC_STATUS_TIMEOUT) {
 		if (device_is_cancelled (abstract))
 			return DC_STATUS_CANCELLED;
 
 		device_event_emit (abstract, DC_EVENT_WAITING, NULL);
-		dc_serial_sleep (device->port, 100);
 	}
 
 	// Receive the header of the package.
@@ -283,7 +285,7 @@ mares_nemo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 mares_nemo_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (MEMORYSIZE);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, MEMORYSIZE);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
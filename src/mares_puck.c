@@ -31,6 +31,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &mares_puck_device_vtable)
 
@@ -130,6 +131,9 @@ mares_puck_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->base.port, 0);
+
 	// Clear the DTR line.
 	status = dc_serial_set_dtr (device->base.port, 0);
 	if (status != DC_STATUS_SUCCESS) {
@@ -147,6 +151,10 @@ mares_puck_device_open (dc_device_t **out, dc_context_t *context, const char *na
 	// Make sure everything is in a sane state.
 	dc_serial_purge (device->base.port, DC_DIRECTION_ALL);
 
+	// Override the base class values. The Puck has no echo, so the next
+	// request can be overlapped with the current answer.
+	device->base.pipeline = 1;
+
 	// Identify the model number.
 	unsigned char header[PACKETSIZE] = {0};
 	status = mares_common_device_read ((dc_device_t *) device, 0, header, sizeof (header));
@@ -232,7 +240,7 @@ mares_puck_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	}
 
 	return device_dump_read (abstract, dc_buffer_get_data (buffer),
-		dc_buffer_get_size (buffer), PACKETSIZE);
+		dc_buffer_get_size (buffer), BLOCKSIZE);
 }
 
 
@@ -243,7 +251,7 @@ mares_puck_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, v
 
 	assert (device->layout != NULL);
 
-	dc_buffer_t *buffer = dc_buffer_new (device->layout->memsize);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, device->layout->memsize);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -615,6 +615,9 @@ oceanic_atom2_device_open2 (dc_device_t **out, dc_context_t *context, const char
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Give the interface 100 ms to settle and draw power up.
 	dc_serial_sleep (device->port, 100);
 
@@ -120,6 +120,7 @@ static dc_status_t oceanic_atom2_parser_set_data (dc_parser_t *abstract, const u
 static dc_status_t oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t oceanic_atom2_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t oceanic_atom2_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
 static const dc_parser_vtable_t oceanic_atom2_parser_vtable = {
 	sizeof(oceanic_atom2_parser_t),
@@ -128,7 +129,9 @@ static const dc_parser_vtable_t oceanic_atom2_parser_vtable = {
 	oceanic_atom2_parser_get_datetime, /* datetime */
 	oceanic_atom2_parser_get_field, /* fields */
 	oceanic_atom2_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_iterator */
+	oceanic_atom2_parser_samples_foreach_fixed /* samples_foreach_fixed */
 };
 
 
@@ -349,7 +352,7 @@ oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetim
 		if (datetime->year < 2010) {
 			// Retrieve the current year.
 			dc_datetime_t now = {0};
-			if (dc_datetime_localtime (&now, dc_datetime_now ()) &&
+			if (dc_datetime_localtime (&now, dc_context_now (abstract->context)) &&
 				now.year >= 2010)
 			{
 				// Guess the correct decade.
@@ -613,7 +616,7 @@ oceanic_atom2_parser_vendor (oceanic_atom2_parser_t *parser, const unsigned char
 }
 
 static dc_status_t
-oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+oceanic_atom2_parser_samples (dc_parser_t *abstract, unsigned int fixed, dc_sample_callback_t callback, void *userdata)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	oceanic_atom2_parser_t *parser = (oceanic_atom2_parser_t *) abstract;
@@ -803,7 +806,10 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 				}
 
 				// Depth
-				sample.depth = 0.0;
+				if (fixed)
+					sample.fixed.depth = 0;
+				else
+					sample.depth = 0.0;
 				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 				complete = 1;
 			}
@@ -886,7 +892,10 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 					else
 						temperature += (data[offset + 7] & 0x0C) >> 2;
 				}
-				sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+				if (fixed)
+					sample.fixed.temperature = dc_fixed_scale ((int) temperature - 32, 5000, 9);
+				else
+					sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 			}
 
@@ -908,8 +917,13 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 					pressure = array_uint16_le (data + offset + 4);
 				else
 					pressure -= data[offset + 1];
-				sample.pressure.tank = tank;
-				sample.pressure.value = pressure * PSI / BAR;
+				if (fixed) {
+					sample.fixed.pressure.tank = tank;
+					sample.fixed.pressure.value = dc_fixed_scale (pressure, 689475729, 10000000);
+				} else {
+					sample.pressure.tank = tank;
+					sample.pressure.value = pressure * PSI / BAR;
+				}
 				if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 			}
 
@@ -927,7 +941,10 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 				depth = data[offset + 3] * 16;
 			else
 				depth = (data[offset + 2] + (data[offset + 3] << 8)) & 0x0FFF;
-			sample.depth = depth / 16.0 * FEET;
+			if (fixed)
+				sample.fixed.depth = dc_fixed_scale (depth, 381, 20);
+			else
+				sample.depth = depth / 16.0 * FEET;
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Gas mix
@@ -970,14 +987,16 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 				have_deco = 1;
 			}
 			if (have_deco) {
-				if (decostop) {
-					sample.deco.type = DC_DECO_DECOSTOP;
-					sample.deco.depth = decostop * 10 * FEET;
+				unsigned int type = decostop ? DC_DECO_DECOSTOP : DC_DECO_NDL;
+				if (fixed) {
+					sample.fixed.deco.type = type;
+					sample.fixed.deco.depth = decostop * 3048;
+					sample.fixed.deco.time = decotime * 60;
 				} else {
-					sample.deco.type = DC_DECO_NDL;
-					sample.deco.depth = 0.0;
+					sample.deco.type = type;
+					sample.deco.depth = decostop * 10 * FEET;
+					sample.deco.time = decotime * 60;
 				}
-				sample.deco.time = decotime * 60;
 				if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 			}
 
@@ -1008,3 +1027,17 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return oceanic_atom2_parser_samples (abstract, 0, callback, userdata);
+}
+
+
+static dc_status_t
+oceanic_atom2_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return oceanic_atom2_parser_samples (abstract, 1, callback, userdata);
+}
@@ -28,6 +28,7 @@
 #include "device-private.h"
 #include "ringbuffer.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define VTABLE(abstract)	((oceanic_common_device_vtable_t *) abstract->vtable)
 
@@ -493,7 +494,7 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 	device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
 
 	// Memory buffer for the profile data.
-	unsigned char *profiles = (unsigned char *) malloc (rb_profile_size + rb_logbook_size);
+	unsigned char *profiles = (unsigned char *) dc_context_alloc (abstract->context, rb_profile_size + rb_logbook_size);
 	if (profiles == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
@@ -528,7 +529,7 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 		{
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).",
 				rb_entry_first, rb_entry_last);
-			free (profiles);
+			dc_context_dealloc (abstract->context, profiles);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -549,6 +550,30 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 			break;
 		}
 
+		// Skip the profile data of dives that are already known. Only the
+		// part that has not been read yet is skipped; any data from the
+		// previous packet that belongs to this dive is simply discarded.
+		if (device_fingerprint_known (abstract, logbooks + entry, layout->rb_logbook_entry_size)) {
+			unsigned int skip = rb_entry_size + gap;
+			if (available >= skip) {
+				available -= skip;
+			} else {
+				unsigned int len = skip - available;
+				address = ringbuffer_decrement (address, len, layout->rb_profile_begin, layout->rb_profile_end);
+				if (address == layout->rb_profile_begin)
+					address = layout->rb_profile_end;
+				available = 0;
+
+				// Update and emit a progress event.
+				progress->maximum -= len;
+				device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+			}
+
+			remaining -= skip;
+			previous = rb_entry_first;
+			continue;
+		}
+
 		// Read the profile data.
 		unsigned int nbytes = available;
 		while (nbytes < rb_entry_size + gap) {
@@ -570,7 +595,7 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 			// Read the profile page.
 			rc = dc_device_read (abstract, address, profiles + offset, len);
 			if (rc != DC_STATUS_SUCCESS) {
-				free (profiles);
+				dc_context_dealloc (abstract->context, profiles);
 				return rc;
 			}
 
@@ -599,7 +624,7 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 		}
 	}
 
-	free (profiles);
+	dc_context_dealloc (abstract->context, profiles);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -656,7 +681,7 @@ oceanic_common_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	// Memory buffer for the logbook data.
-	dc_buffer_t *logbook = dc_buffer_new (0);
+	dc_buffer_t *logbook = dc_buffer_allocate (abstract->context, 0);
 	if (logbook == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
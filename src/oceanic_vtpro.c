@@ -443,6 +443,9 @@ oceanic_vtpro_device_open2 (dc_device_t **out, dc_context_t *context, const char
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line.
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -39,6 +39,7 @@ struct dc_parser_t {
 	dc_context_t *context;
 	const unsigned char *data;
 	unsigned int size;
+	dc_sample_mode_t samplemode;
 };
 
 struct dc_parser_vtable_t {
@@ -55,8 +56,23 @@ struct dc_parser_vtable_t {
 	dc_status_t (*samples_foreach) (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
 	dc_status_t (*destroy) (dc_parser_t *parser);
+
+	dc_status_t (*samples_iterator) (dc_parser_t *parser, dc_iterator_t **iterator);
+
+	/*
+	 * Same as samples_foreach, but with fixed point sample values. Parsers
+	 * without a native implementation get their values converted.
+	 */
+	dc_status_t (*samples_foreach_fixed) (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 };
 
+/*
+ * Create a parser from the device family, model, serial number and clock
+ * calibration, without a reference to the device itself.
+ */
+dc_status_t
+dc_parser_new_internal (dc_parser_t **parser, dc_context_t *context, dc_family_t family, unsigned int model, unsigned int serial, unsigned int devtime, dc_ticks_t systime);
+
 dc_parser_t *
 dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable);
 
@@ -66,6 +82,27 @@ dc_parser_deallocate (dc_parser_t *parser);
 int
 dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable);
 
+/*
+ * Decode the samples of the next record, and pass them to the callback
+ * function. The decoder state is kept in the sample iterator. Returns
+ * DC_STATUS_DONE once there are no more records.
+ */
+typedef dc_status_t (*dc_sample_decoder_t) (dc_parser_t *parser, void *state, dc_sample_callback_t callback, void *userdata);
+
+dc_iterator_t *
+dc_sample_iterator_allocate (dc_parser_t *parser, dc_sample_decoder_t decoder, size_t statesize);
+
+void *
+dc_sample_iterator_state (dc_iterator_t *iterator);
+
+/*
+ * Scale an integer value by the (exact or nearest rational) conversion
+ * factor numerator / denominator, rounded to the nearest integer. Used
+ * for the fixed point sample values.
+ */
+int
+dc_fixed_scale (int value, int numerator, int denominator);
+
 typedef struct sample_statistics_t {
 	unsigned int divetime;
 	double maxdepth;
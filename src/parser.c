@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <libdivecomputer/suunto.h>
@@ -40,10 +41,11 @@
 #include "context-private.h"
 #include "parser-private.h"
 #include "device-private.h"
+#include "iterator-private.h"
 
 #define REACTPROWHITE 0x4354
 
-static dc_status_t
+dc_status_t
 dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t family, unsigned int model, unsigned int serial, unsigned int devtime, dc_ticks_t systime)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
@@ -187,7 +189,7 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 	assert(vtable->size >= sizeof(dc_parser_t));
 
 	// Allocate memory.
-	parser = (dc_parser_t *) malloc (vtable->size);
+	parser = (dc_parser_t *) dc_context_alloc (context, vtable->size);
 	if (parser == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return parser;
@@ -198,6 +200,7 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 	parser->context = context;
 	parser->data = NULL;
 	parser->size = 0;
+	parser->samplemode = DC_SAMPLE_MODE_DOUBLE;
 
 	return parser;
 }
@@ -205,7 +208,10 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 void
 dc_parser_deallocate (dc_parser_t *parser)
 {
-	free (parser);
+	if (parser == NULL)
+		return;
+
+	dc_context_dealloc (parser->context, parser);
 }
 
 int
@@ -269,6 +275,94 @@ dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int fla
 }
 
 
+dc_status_t
+dc_parser_set_sample_mode (dc_parser_t *parser, dc_sample_mode_t mode)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (mode != DC_SAMPLE_MODE_DOUBLE && mode != DC_SAMPLE_MODE_FIXED)
+		return DC_STATUS_INVALIDARGS;
+
+	parser->samplemode = mode;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+int
+dc_fixed_scale (int value, int numerator, int denominator)
+{
+	long long n = (long long) value * numerator;
+	long long d = denominator;
+
+	if (d < 0) {
+		n = -n;
+		d = -d;
+	}
+
+	// Round halfway cases away from zero.
+	if (n < 0)
+		return (int) ((n - d / 2) / d);
+	else
+		return (int) ((n + d / 2) / d);
+}
+
+
+static int
+dc_fixed_round (double value, double scale)
+{
+	value *= scale;
+
+	return (int) (value < 0 ? value - 0.5 : value + 0.5);
+}
+
+
+typedef struct dc_parser_fixed_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+} dc_parser_fixed_t;
+
+static void
+dc_parser_fixed_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_parser_fixed_t *fixed = (dc_parser_fixed_t *) userdata;
+	dc_sample_value_t sample = value;
+
+	switch (type) {
+	case DC_SAMPLE_DEPTH:
+		sample.fixed.depth = dc_fixed_round (value.depth, 1000.0);
+		break;
+	case DC_SAMPLE_PRESSURE:
+		sample.fixed.pressure.tank = value.pressure.tank;
+		sample.fixed.pressure.value = dc_fixed_round (value.pressure.value, 1000.0);
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		sample.fixed.temperature = dc_fixed_round (value.temperature, 1000.0);
+		break;
+	case DC_SAMPLE_SETPOINT:
+		sample.fixed.setpoint = dc_fixed_round (value.setpoint, 1000.0);
+		break;
+	case DC_SAMPLE_PPO2:
+		sample.fixed.ppo2 = dc_fixed_round (value.ppo2, 1000.0);
+		break;
+	case DC_SAMPLE_CNS:
+		sample.fixed.cns = dc_fixed_round (value.cns, 1000.0);
+		break;
+	case DC_SAMPLE_DECO:
+		sample.fixed.deco.type = value.deco.type;
+		sample.fixed.deco.time = value.deco.time;
+		sample.fixed.deco.depth = dc_fixed_round (value.deco.depth, 1000.0);
+		break;
+	default:
+		break;
+	}
+
+	if (fixed->callback)
+		fixed->callback (type, sample, fixed->userdata);
+}
+
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata)
 {
@@ -278,10 +372,195 @@ dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, v
 	if (parser->vtable->samples_foreach == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
+	if (parser->samplemode == DC_SAMPLE_MODE_FIXED) {
+		if (parser->vtable->samples_foreach_fixed)
+			return parser->vtable->samples_foreach_fixed (parser, callback, userdata);
+
+		// Convert the floating point values.
+		dc_parser_fixed_t fixed = {callback, userdata};
+		return parser->vtable->samples_foreach (parser, dc_parser_fixed_cb, &fixed);
+	}
+
 	return parser->vtable->samples_foreach (parser, callback, userdata);
 }
 
 
+typedef struct dc_sample_iterator_t {
+	dc_iterator_t base;
+	dc_parser_t *parser;
+	dc_sample_decoder_t decoder;
+	/* Pending error, returned once the samples are exhausted. */
+	dc_status_t status;
+	unsigned int done;
+	/* Samples of the current record. */
+	dc_sample_t *samples;
+	unsigned int count;
+	unsigned int capacity;
+	unsigned int current;
+	/* Decoder state (variable size). */
+	void *state;
+} dc_sample_iterator_t;
+
+static dc_status_t dc_sample_iterator_next (dc_iterator_t *iterator, void *item);
+static dc_status_t dc_sample_iterator_free (dc_iterator_t *iterator);
+
+static const dc_iterator_vtable_t dc_sample_iterator_vtable = {
+	dc_sample_iterator_free,
+	dc_sample_iterator_next
+};
+
+dc_iterator_t *
+dc_sample_iterator_allocate (dc_parser_t *parser, dc_sample_decoder_t decoder, size_t statesize)
+{
+	dc_sample_iterator_t *iterator = NULL;
+
+	assert(decoder != NULL);
+
+	// Allocate memory for the iterator and the decoder state.
+	iterator = (dc_sample_iterator_t *) dc_context_alloc (parser->context, sizeof (dc_sample_iterator_t) + statesize);
+	if (iterator == NULL) {
+		ERROR (parser->context, "Failed to allocate memory.");
+		return NULL;
+	}
+
+	iterator->base.vtable = &dc_sample_iterator_vtable;
+	iterator->parser = parser;
+	iterator->decoder = decoder;
+	iterator->status = DC_STATUS_SUCCESS;
+	iterator->done = 0;
+	iterator->samples = NULL;
+	iterator->count = 0;
+	iterator->capacity = 0;
+	iterator->current = 0;
+	iterator->state = iterator + 1;
+	memset (iterator->state, 0, statesize);
+
+	return (dc_iterator_t *) iterator;
+}
+
+void *
+dc_sample_iterator_state (dc_iterator_t *abstract)
+{
+	dc_sample_iterator_t *iterator = (dc_sample_iterator_t *) abstract;
+
+	return iterator->state;
+}
+
+static void
+dc_sample_iterator_push (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_iterator_t *iterator = (dc_sample_iterator_t *) userdata;
+
+	if (iterator->status != DC_STATUS_SUCCESS)
+		return;
+
+	// Grow the array if necessary.
+	if (iterator->count == iterator->capacity) {
+		unsigned int capacity = iterator->capacity ? iterator->capacity * 2 : 16;
+		dc_sample_t *samples = (dc_sample_t *) dc_context_realloc (iterator->parser->context, iterator->samples, capacity * sizeof (dc_sample_t));
+		if (samples == NULL) {
+			ERROR (iterator->parser->context, "Failed to allocate memory.");
+			iterator->status = DC_STATUS_NOMEMORY;
+			return;
+		}
+
+		iterator->samples = samples;
+		iterator->capacity = capacity;
+	}
+
+	iterator->samples[iterator->count].type = type;
+	iterator->samples[iterator->count].value = value;
+	iterator->count++;
+}
+
+static dc_status_t
+dc_sample_iterator_next (dc_iterator_t *abstract, void *out)
+{
+	dc_sample_iterator_t *iterator = (dc_sample_iterator_t *) abstract;
+	dc_sample_t *sample = (dc_sample_t *) out;
+
+	// Decode records until at least one sample is available. An error
+	// is only returned after the samples that were already decoded
+	// before the error have been handed out.
+	while (iterator->current == iterator->count) {
+		if (iterator->done)
+			return iterator->status != DC_STATUS_SUCCESS ? iterator->status : DC_STATUS_DONE;
+
+		iterator->count = 0;
+		iterator->current = 0;
+
+		dc_status_t rc = iterator->decoder (iterator->parser, iterator->state, dc_sample_iterator_push, iterator);
+		if (rc == DC_STATUS_DONE) {
+			iterator->done = 1;
+		} else if (rc != DC_STATUS_SUCCESS) {
+			iterator->done = 1;
+			if (iterator->status == DC_STATUS_SUCCESS)
+				iterator->status = rc;
+		}
+
+		if (iterator->status != DC_STATUS_SUCCESS)
+			iterator->done = 1;
+	}
+
+	*sample = iterator->samples[iterator->current++];
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_sample_iterator_free (dc_iterator_t *abstract)
+{
+	dc_sample_iterator_t *iterator = (dc_sample_iterator_t *) abstract;
+
+	dc_context_dealloc (iterator->parser->context, iterator->samples);
+	dc_context_dealloc (iterator->parser->context, iterator);
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * The decoder for backends without native iterator support. The entire
+ * profile is decoded at once, and returned as a single record.
+ */
+static dc_status_t
+dc_parser_samples_decoder (dc_parser_t *parser, void *state, dc_sample_callback_t callback, void *userdata)
+{
+	unsigned int *done = (unsigned int *) state;
+
+	if (*done)
+		return DC_STATUS_DONE;
+
+	*done = 1;
+
+	return dc_parser_samples_foreach (parser, callback, userdata);
+}
+
+dc_status_t
+dc_parser_samples_iterator (dc_parser_t *parser, dc_iterator_t **out)
+{
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Native iterators produce floating point values only.
+	if (parser->vtable->samples_iterator && parser->samplemode == DC_SAMPLE_MODE_DOUBLE)
+		return parser->vtable->samples_iterator (parser, out);
+
+	if (parser->vtable->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	dc_iterator_t *iterator = dc_sample_iterator_allocate (parser, dc_parser_samples_decoder, sizeof (unsigned int));
+	if (iterator == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	*out = iterator;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser)
 {
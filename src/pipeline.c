@@ -0,0 +1,419 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2017 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdivecomputer/pipeline.h>
+
+#include "thread.h"
+#include "context-private.h"
+#include "device-private.h"
+#include "parser-private.h"
+#include "buffer-private.h"
+
+#define JOB_EMPTY  0
+#define JOB_QUEUED 1
+#define JOB_BUSY   2
+#define JOB_DONE   3
+
+typedef struct dc_pipeline_job_t {
+	unsigned int state;
+	dc_buffer_t *view; /* A view on the dive data, or NULL if copied. */
+	dc_buffer_t *buffer; /* The copied dive data, followed by the fingerprint. */
+	unsigned int size;
+	unsigned int fsize;
+	dc_event_devinfo_t devinfo;
+	dc_event_clock_t clock;
+	dc_parser_t *parser;
+	void *result;
+	dc_status_t status;
+} dc_pipeline_job_t;
+
+typedef struct dc_pipeline_state_t dc_pipeline_state_t;
+
+typedef struct dc_pipeline_worker_t {
+	dc_pipeline_state_t *state;
+	dc_context_t *context;
+	dc_thread_t thread;
+} dc_pipeline_worker_t;
+
+struct dc_pipeline_state_t {
+	dc_device_t *device;
+	const dc_pipeline_t *config;
+	dc_family_t family;
+	/* Ring of jobs, indexed by sequence number. The jobs in the range
+	 * [head, next) are being parsed or finished, and [next, tail) are
+	 * waiting for a worker. */
+	dc_pipeline_job_t *jobs;
+	unsigned int capacity;
+	unsigned int head, next, tail;
+	dc_pipeline_worker_t *workers;
+	unsigned int nworkers;
+	int stop;
+	int quit;
+	dc_status_t status;
+	dc_mutex_t lock;
+	dc_cond_t work, done;
+};
+
+static void
+dc_pipeline_lock (dc_pipeline_state_t *state)
+{
+	dc_mutex_lock (&state->lock);
+}
+
+static void
+dc_pipeline_unlock (dc_pipeline_state_t *state)
+{
+	dc_mutex_unlock (&state->lock);
+}
+
+static const unsigned char *
+dc_pipeline_job_data (dc_pipeline_job_t *job)
+{
+	if (job->view)
+		return dc_buffer_get_const_data (job->view);
+
+	return dc_buffer_get_const_data (job->buffer);
+}
+
+static const unsigned char *
+dc_pipeline_job_fingerprint (dc_pipeline_job_t *job)
+{
+	const unsigned char *data = dc_buffer_get_const_data (job->buffer);
+
+	return job->view ? data : data + job->size;
+}
+
+static void
+dc_pipeline_process (dc_pipeline_state_t *state, dc_pipeline_job_t *job, dc_context_t *context)
+{
+	const unsigned char *data = dc_pipeline_job_data (job);
+
+	job->status = dc_parser_new_internal (&job->parser, context, state->family,
+		job->devinfo.model, job->devinfo.serial,
+		job->clock.devtime, job->clock.systime);
+	if (job->status != DC_STATUS_SUCCESS)
+		return;
+
+	job->status = dc_parser_set_data (job->parser, data, job->size);
+	if (job->status != DC_STATUS_SUCCESS)
+		return;
+
+	if (state->config->parse)
+		job->result = state->config->parse (job->parser, data, job->size, state->config->userdata);
+}
+
+/*
+ * Pass a finished job to the application, or release it if the download
+ * has already been stopped. Called without holding the lock, but only
+ * from the download thread. Returns zero if the download should stop.
+ */
+static int
+dc_pipeline_deliver (dc_pipeline_state_t *state, dc_pipeline_job_t *job, int stop)
+{
+	const dc_pipeline_t *config = state->config;
+
+	if (!stop) {
+		if (job->status != DC_STATUS_SUCCESS) {
+			ERROR (state->device->context, "Failed to parse the dive.");
+			state->status = job->status;
+			stop = 1;
+		} else {
+			void *result = job->result;
+			job->result = NULL;
+			if (!config->deliver (job->parser, result,
+				dc_pipeline_job_data (job), job->size,
+				dc_pipeline_job_fingerprint (job), job->fsize, config->userdata))
+				stop = 1;
+		}
+	}
+
+	if (job->result && config->release)
+		config->release (job->result, config->userdata);
+
+	dc_parser_destroy (job->parser);
+	dc_buffer_free (job->view);
+
+	job->parser = NULL;
+	job->view = NULL;
+	job->result = NULL;
+	job->status = DC_STATUS_SUCCESS;
+	job->state = JOB_EMPTY;
+
+	return !stop;
+}
+
+/*
+ * Deliver the finished jobs in order. If wait is non-zero, also wait for
+ * the unfinished ones. Called with the lock held.
+ */
+static void
+dc_pipeline_drain (dc_pipeline_state_t *state, int wait)
+{
+	while (state->head != state->tail) {
+		dc_pipeline_job_t *job = state->jobs + state->head % state->capacity;
+		if (job->state != JOB_DONE) {
+#ifdef DC_THREADS
+			if (wait) {
+				dc_cond_wait (&state->done, &state->lock);
+				continue;
+			}
+#endif
+			break;
+		}
+
+		int stop = state->stop;
+
+		dc_pipeline_unlock (state);
+		int proceed = dc_pipeline_deliver (state, job, stop);
+		dc_pipeline_lock (state);
+
+		if (!proceed)
+			state->stop = 1;
+
+		state->head++;
+	}
+}
+
+#ifdef DC_THREADS
+static void
+dc_pipeline_worker_run (void *arg)
+{
+	dc_pipeline_worker_t *worker = (dc_pipeline_worker_t *) arg;
+	dc_pipeline_state_t *state = worker->state;
+
+	dc_pipeline_lock (state);
+	while (1) {
+		while (!state->quit && state->next == state->tail)
+			dc_cond_wait (&state->work, &state->lock);
+
+		if (state->quit)
+			break;
+
+		dc_pipeline_job_t *job = state->jobs + state->next % state->capacity;
+		job->state = JOB_BUSY;
+		state->next++;
+
+		// Don't waste any time on dives that will be discarded anyway.
+		int skip = state->stop;
+
+		dc_pipeline_unlock (state);
+		if (!skip)
+			dc_pipeline_process (state, job, worker->context);
+		dc_pipeline_lock (state);
+
+		job->state = JOB_DONE;
+		dc_cond_signal (&state->done);
+	}
+	dc_pipeline_unlock (state);
+}
+
+#endif
+
+static int
+dc_pipeline_dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dc_pipeline_state_t *state = (dc_pipeline_state_t *) userdata;
+
+	int proceed = 1;
+
+	// Deliver the finished dives, and wait for a free slot.
+	dc_pipeline_lock (state);
+	while (1) {
+		dc_pipeline_drain (state, 0);
+		if (state->stop || state->tail - state->head < state->capacity)
+			break;
+#ifdef DC_THREADS
+		dc_cond_wait (&state->done, &state->lock);
+#endif
+	}
+	int stop = state->stop;
+	dc_pipeline_unlock (state);
+
+	if (stop)
+		return 0;
+
+	// The free slot is not visible to the workers yet, so it can be
+	// filled without holding the lock. The dive data is only copied if
+	// the backend can't provide a view on it.
+	dc_pipeline_job_t *job = state->jobs + state->tail % state->capacity;
+	job->view = device_dive_view (state->device, data, size);
+	if (!dc_buffer_clear (job->buffer) ||
+		(job->view == NULL && !dc_buffer_append (job->buffer, data, size)) ||
+		!dc_buffer_append (job->buffer, fingerprint, fsize)) {
+		dc_buffer_free (job->view);
+		job->view = NULL;
+		ERROR (state->device->context, "Insufficient buffer space available.");
+		dc_pipeline_lock (state);
+		state->status = DC_STATUS_NOMEMORY;
+		state->stop = 1;
+		dc_pipeline_unlock (state);
+		return 0;
+	}
+	job->size = size;
+	job->fsize = fsize;
+	job->devinfo = state->device->devinfo;
+	job->clock = state->device->clock;
+
+	// Without workers, the dive is parsed and delivered right away.
+	if (state->nworkers == 0)
+		dc_pipeline_process (state, job, state->device->context);
+
+	dc_pipeline_lock (state);
+	state->tail++;
+	if (state->nworkers == 0) {
+		job->state = JOB_DONE;
+		state->next = state->tail;
+		dc_pipeline_drain (state, 0);
+		proceed = !state->stop;
+	} else {
+		job->state = JOB_QUEUED;
+#ifdef DC_THREADS
+		dc_cond_signal (&state->work);
+#endif
+	}
+	dc_pipeline_unlock (state);
+
+	return proceed;
+}
+
+dc_status_t
+dc_device_foreach_pipeline (dc_device_t *device, const dc_pipeline_t *pipeline)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_pipeline_state_t state;
+
+	if (device == NULL || pipeline == NULL || pipeline->deliver == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	memset (&state, 0, sizeof (state));
+	state.device = device;
+	state.config = pipeline;
+	state.family = dc_device_get_type (device);
+	state.status = DC_STATUS_SUCCESS;
+
+#ifdef DC_THREADS
+	state.nworkers = pipeline->nworkers;
+#else
+	if (pipeline->nworkers)
+		WARNING (device->context, "No thread support, parsing on the download thread.");
+	state.nworkers = 0;
+#endif
+
+	state.capacity = pipeline->capacity;
+	if (state.capacity == 0)
+		state.capacity = state.nworkers ? 2 * state.nworkers : 1;
+
+	// Allocate the jobs.
+	state.jobs = (dc_pipeline_job_t *) dc_context_alloc (device->context, state.capacity * sizeof (dc_pipeline_job_t));
+	if (state.jobs == NULL) {
+		ERROR (device->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	memset (state.jobs, 0, state.capacity * sizeof (dc_pipeline_job_t));
+	for (unsigned int i = 0; i < state.capacity; ++i) {
+		state.jobs[i].buffer = dc_buffer_allocate (device->context, 0);
+		if (state.jobs[i].buffer == NULL) {
+			ERROR (device->context, "Failed to allocate memory.");
+			status = DC_STATUS_NOMEMORY;
+			goto error_free_jobs;
+		}
+	}
+
+#ifdef DC_THREADS
+	if (state.nworkers) {
+		state.workers = (dc_pipeline_worker_t *) dc_context_alloc (device->context, state.nworkers * sizeof (dc_pipeline_worker_t));
+		if (state.workers == NULL) {
+			ERROR (device->context, "Failed to allocate memory.");
+			status = DC_STATUS_NOMEMORY;
+			goto error_free_jobs;
+		}
+	}
+
+	dc_mutex_init (&state.lock);
+	dc_cond_init (&state.work);
+	dc_cond_init (&state.done);
+
+	// Start the workers. Each worker gets its own context, because the
+	// contexts are not thread-safe.
+	unsigned int nstarted = 0;
+	while (nstarted < state.nworkers) {
+		dc_pipeline_worker_t *worker = state.workers + nstarted;
+		worker->state = &state;
+		if (dc_context_clone (&worker->context, device->context) != DC_STATUS_SUCCESS)
+			break;
+		if (dc_thread_start (&worker->thread, dc_pipeline_worker_run, worker) != DC_STATUS_SUCCESS) {
+			dc_context_free (worker->context);
+			break;
+		}
+		nstarted++;
+	}
+
+	if (nstarted < state.nworkers) {
+		WARNING (device->context, "Failed to start all workers (%u of %u).", nstarted, state.nworkers);
+		state.nworkers = nstarted;
+	}
+#endif
+
+	status = dc_device_foreach (device, dc_pipeline_dive_cb, &state);
+
+	// Deliver the remaining dives, or discard them on failure.
+	dc_pipeline_lock (&state);
+	if (status != DC_STATUS_SUCCESS)
+		state.stop = 1;
+	dc_pipeline_drain (&state, 1);
+	state.quit = 1;
+#ifdef DC_THREADS
+	dc_cond_broadcast (&state.work);
+#endif
+	dc_pipeline_unlock (&state);
+
+#ifdef DC_THREADS
+	for (unsigned int i = 0; i < state.nworkers; ++i) {
+		dc_thread_join (&state.workers[i].thread);
+		dc_context_free (state.workers[i].context);
+	}
+
+	dc_cond_free (&state.done);
+	dc_cond_free (&state.work);
+	dc_mutex_free (&state.lock);
+
+	dc_context_dealloc (device->context, state.workers);
+#endif
+
+	if (status == DC_STATUS_SUCCESS)
+		status = state.status;
+
+error_free_jobs:
+	for (unsigned int i = 0; i < state.capacity; ++i) {
+		dc_buffer_free (state.jobs[i].view);
+		dc_buffer_free (state.jobs[i].buffer);
+	}
+	dc_context_dealloc (device->context, state.jobs);
+	return status;
+}
@@ -0,0 +1,122 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2017 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stddef.h>
+
+#include "array.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define RECORD_LE     0x00
+#define RECORD_BE     0x01
+#define RECORD_SIGNED 0x02
+#define RECORD_BCD    0x04
+
+/*
+ * Record layout descriptor.
+ *
+ * A record layout is a table with one entry per field, describing where
+ * the raw value is stored (offset and width in bytes), how it is encoded
+ * (byte order, sign and bcd), and which int member of the destination
+ * structure receives it. The raw value is multiplied with the scale
+ * factor, which is typically used for fixed unit conversions (e.g.
+ * minutes to seconds). Conversions that depend on the dive settings (e.g.
+ * metric or imperial units) are left to the parser.
+ */
+typedef struct record_field_t {
+	unsigned int offset;
+	unsigned int width;
+	unsigned int flags;
+	int scale;
+	size_t member;
+} record_field_t;
+
+#define RECORD_FIELD(type,name,offset,width,flags,scale) \
+	{(offset), (width), (flags), (scale), offsetof(type, name)}
+
+static inline int
+record_field_decode (const record_field_t *field, const unsigned char data[])
+{
+	const unsigned char *p = data + field->offset;
+	unsigned int width = field->width;
+	unsigned int value = 0;
+
+	if (field->flags & RECORD_BCD) {
+		for (unsigned int i = 0; i < width; ++i)
+			value = value * 100 + bcd2dec (p[i]);
+		return value * field->scale;
+	}
+
+	switch (width) {
+	case 1:
+		value = p[0];
+		break;
+	case 2:
+		value = (field->flags & RECORD_BE) ? array_uint16_be (p) : array_uint16_le (p);
+		break;
+	case 3:
+		value = (field->flags & RECORD_BE) ? array_uint24_be (p) : array_uint24_le (p);
+		break;
+	case 4:
+		value = (field->flags & RECORD_BE) ? array_uint32_be (p) : array_uint32_le (p);
+		break;
+	default:
+		return 0;
+	}
+
+	if ((field->flags & RECORD_SIGNED) && width < 4) {
+		unsigned int sign = 1u << (width * 8 - 1);
+		return ((int) (value ^ sign) - (int) sign) * field->scale;
+	}
+
+	return (int) value * field->scale;
+}
+
+/*
+ * Decode all fields of a record into the destination structure. Returns
+ * zero if one of the fields extends beyond the end of the record, in
+ * which case the destination is left untouched.
+ */
+static inline int
+record_decode (const record_field_t fields[], unsigned int count, const unsigned char data[], unsigned int size, void *output)
+{
+	for (unsigned int i = 0; i < count; ++i) {
+		if (fields[i].offset + fields[i].width > size)
+			return 0;
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		int value = record_field_decode (&fields[i], data);
+		memcpy ((unsigned char *) output + fields[i].member, &value, sizeof (value));
+	}
+
+	return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* RECORD_H */
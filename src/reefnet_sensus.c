@@ -29,6 +29,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &reefnet_sensus_device_vtable)
 
@@ -234,7 +235,7 @@ reefnet_sensus_handshake (reefnet_sensus_device_t *device)
 	device->waiting = 1;
 
 	// Store the clock calibration values.
-	device->systime = dc_datetime_now ();
+	device->systime = dc_context_now (abstract->context);
 	device->devtime = array_uint32_le (handshake + 8);
 
 	// Store the handshake packet.
@@ -347,7 +348,7 @@ reefnet_sensus_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 reefnet_sensus_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
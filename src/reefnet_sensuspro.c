@@ -29,6 +29,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &reefnet_sensuspro_device_vtable)
 
@@ -202,7 +203,7 @@ reefnet_sensuspro_handshake (reefnet_sensuspro_device_t *device)
 	}
 
 	// Store the clock calibration values.
-	device->systime = dc_datetime_now ();
+	device->systime = dc_context_now (abstract->context);
 	device->devtime = array_uint32_le (handshake + 6);
 
 	// Store the handshake packet.
@@ -262,8 +263,8 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	reefnet_sensuspro_device_t *device = (reefnet_sensuspro_device_t*) abstract;
 
 	// Erase the current contents of the buffer and
-	// pre-allocate the required amount of memory.
-	if (!dc_buffer_clear (buffer) || !dc_buffer_reserve (buffer, SZ_MEMORY)) {
+	// allocate the required amount of memory.
+	if (!dc_buffer_clear (buffer) || !dc_buffer_resize (buffer, SZ_MEMORY)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
@@ -278,19 +279,26 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 
+	unsigned char *data = dc_buffer_get_data (buffer);
+
+	checksum_crc_ccitt_t ctx;
+	checksum_crc_ccitt_init (&ctx);
+
 	unsigned int nbytes = 0;
-	unsigned char answer[SZ_MEMORY + 2] = {0};
-	while (nbytes < sizeof (answer)) {
-		unsigned int len = sizeof (answer) - nbytes;
+	while (nbytes < SZ_MEMORY) {
+		unsigned int len = SZ_MEMORY - nbytes;
 		if (len > 256)
 			len = 256;
 
-		status = dc_serial_read (device->port, answer + nbytes, len, NULL);
+		status = dc_serial_read (device->port, data + nbytes, len, NULL);
 		if (status != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return status;
 		}
 
+		// Update the checksum.
+		checksum_crc_ccitt_update (&ctx, data + nbytes, len);
+
 		// Update and emit a progress event.
 		progress.current += len;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
@@ -298,15 +306,25 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		nbytes += len;
 	}
 
-	unsigned short crc = array_uint16_le (answer + SZ_MEMORY);
-	unsigned short ccrc = checksum_crc_ccitt_uint16 (answer, SZ_MEMORY);
+	// Receive the checksum.
+	unsigned char checksum[2] = {0};
+	status = dc_serial_read (device->port, checksum, sizeof (checksum), NULL);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to receive the answer.");
+		return status;
+	}
+
+	// Update and emit a progress event.
+	progress.current += sizeof (checksum);
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	unsigned short crc = array_uint16_le (checksum);
+	unsigned short ccrc = checksum_crc_ccitt_final_uint16 (&ctx);
 	if (crc != ccrc) {
 		ERROR (abstract->context, "Unexpected answer checksum.");
 		return DC_STATUS_PROTOCOL;
 	}
 
-	dc_buffer_append (buffer, answer, SZ_MEMORY);
-
 	return DC_STATUS_SUCCESS;
 }
 
@@ -314,7 +332,7 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 reefnet_sensuspro_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -27,9 +27,11 @@
 
 #include "context-private.h"
 #include "device-private.h"
+#include "thread.h"
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &reefnet_sensusultra_device_vtable)
 
@@ -40,6 +42,7 @@
 #define SZ_SENSE     6
 
 #define MAXRETRIES 2
+#define NQUEUE     8
 #define PROMPT 0xA5
 #define ACCEPT PROMPT
 #define REJECT 0x00
@@ -53,6 +56,20 @@ typedef struct reefnet_sensusultra_device_t {
 	dc_ticks_t systime;
 } reefnet_sensusultra_device_t;
 
+typedef struct reefnet_sensusultra_queue_t {
+	reefnet_sensusultra_device_t *device;
+	/* Ring of received pages. The pages in the range [head, tail) are
+	 * waiting to be parsed. */
+	unsigned char pages[NQUEUE][SZ_PACKET];
+	unsigned int head, tail;
+	unsigned int nbytes;
+	int stop; /* Set by the parser to stop the transfer. */
+	int done; /* Set by the receiver after the last page. */
+	dc_status_t status;
+	dc_mutex_t lock;
+	dc_cond_t cond;
+} reefnet_sensusultra_queue_t;
+
 static dc_status_t reefnet_sensusultra_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size);
 static dc_status_t reefnet_sensusultra_device_dump (dc_device_t *abstract, dc_buffer_t *buffer);
 static dc_status_t reefnet_sensusultra_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
@@ -265,6 +282,8 @@ reefnet_sensusultra_packet (reefnet_sensusultra_device_t *device, unsigned char
 static dc_status_t
 reefnet_sensusultra_handshake (reefnet_sensusultra_device_t *device, unsigned short value)
 {
+	dc_device_t *abstract = (dc_device_t *) device;
+
 	// Wake-up the device.
 	unsigned char handshake[SZ_HANDSHAKE + 2] = {0};
 	dc_status_t rc = reefnet_sensusultra_packet (device, handshake, sizeof (handshake), 0);
@@ -272,7 +291,7 @@ reefnet_sensusultra_handshake (reefnet_sensusultra_device_t *device, unsigned sh
 		return rc;
 
 	// Store the clock calibration values.
-	device->systime = dc_datetime_now ();
+	device->systime = dc_context_now (abstract->context);
 	device->devtime = array_uint32_le (handshake + 4);
 
 	// Store the handshake packet.
@@ -668,17 +687,96 @@ reefnet_sensusultra_parse (reefnet_sensusultra_device_t *device,
 }
 
 
+/*
+ * Receive and accept the next page, and append it to the queue. Called
+ * without holding the lock, and only when the queue has a free slot.
+ */
+static void
+reefnet_sensusultra_receive (reefnet_sensusultra_queue_t *queue)
+{
+	reefnet_sensusultra_device_t *device = queue->device;
+
+	// Receive the packet.
+	unsigned char packet[SZ_PACKET + 4] = {0};
+	dc_status_t rc = reefnet_sensusultra_page (device, packet, sizeof (packet), queue->nbytes / SZ_PACKET);
+	if (rc != DC_STATUS_SUCCESS)
+		goto done;
+
+	// Abort the transfer if the page contains no useful data.
+	if (array_isequal (packet + 2, SZ_PACKET, 0xFF) && queue->nbytes != 0)
+		goto done;
+
+	// Accept the packet. The device starts sending the next page
+	// immediately, while this one waits in the queue.
+	rc = reefnet_sensusultra_send_uchar (device, ACCEPT);
+	if (rc != DC_STATUS_SUCCESS)
+		goto done;
+
+	queue->nbytes += SZ_PACKET;
+
+	dc_mutex_lock (&queue->lock);
+	memcpy (queue->pages[queue->tail % NQUEUE], packet + 2, SZ_PACKET);
+	queue->tail++;
+	if (queue->nbytes >= SZ_MEMORY)
+		queue->done = 1;
+	dc_cond_broadcast (&queue->cond);
+	dc_mutex_unlock (&queue->lock);
+
+	return;
+
+done:
+	dc_mutex_lock (&queue->lock);
+	queue->status = rc;
+	queue->done = 1;
+	dc_cond_broadcast (&queue->cond);
+	dc_mutex_unlock (&queue->lock);
+}
+
+
+static void
+reefnet_sensusultra_receiver (void *arg)
+{
+	reefnet_sensusultra_queue_t *queue = (reefnet_sensusultra_queue_t *) arg;
+
+	dc_mutex_lock (&queue->lock);
+	while (!queue->stop && !queue->done) {
+		if (queue->tail - queue->head == NQUEUE) {
+			dc_cond_wait (&queue->cond, &queue->lock);
+			continue;
+		}
+
+		dc_mutex_unlock (&queue->lock);
+		reefnet_sensusultra_receive (queue);
+		dc_mutex_lock (&queue->lock);
+	}
+	dc_mutex_unlock (&queue->lock);
+}
+
+
 static dc_status_t
 reefnet_sensusultra_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
 	reefnet_sensusultra_device_t *device = (reefnet_sensusultra_device_t*) abstract;
 
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
 	}
 
+	reefnet_sensusultra_queue_t *queue = (reefnet_sensusultra_queue_t *) dc_context_alloc (abstract->context, sizeof (reefnet_sensusultra_queue_t));
+	if (queue == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
+		dc_buffer_free (buffer);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	queue->device = device;
+	queue->head = queue->tail = 0;
+	queue->nbytes = 0;
+	queue->stop = queue->done = 0;
+	queue->status = DC_STATUS_SUCCESS;
+
 	// Enable progress notifications.
 	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
 	progress.maximum = SZ_MEMORY;
@@ -687,37 +785,61 @@ reefnet_sensusultra_device_foreach (dc_device_t *abstract, dc_dive_callback_t ca
 	// Wake-up the device and send the instruction code.
 	dc_status_t rc = reefnet_sensusultra_send (device, 0xB421);
 	if (rc != DC_STATUS_SUCCESS) {
+		dc_context_dealloc (abstract->context, queue);
 		dc_buffer_free (buffer);
 		return rc;
 	}
 
+	// The pages are received and accepted on a separate thread, such
+	// that the device keeps sending while the dives are being parsed
+	// and passed to the application. The queue is bounded, so the
+	// receiver never runs more than NQUEUE pages ahead. The dive
+	// callbacks and the events stay on the calling thread, but the
+	// cancel callback is called from the receiving thread. Without
+	// thread support, the pages are received one by one on the calling
+	// thread instead.
+	dc_mutex_init (&queue->lock);
+	dc_cond_init (&queue->cond);
+
+	dc_thread_t thread;
+	int threaded = (dc_thread_start (&thread, reefnet_sensusultra_receiver, queue) == DC_STATUS_SUCCESS);
+
 	// Initialize the state for the incremental parser.
 	unsigned int remaining = 0;
 	unsigned int previous = 0;
 
-	unsigned int nbytes = 0;
-	unsigned int npages = 0;
-	while (nbytes < SZ_MEMORY) {
-		// Receive the packet.
-		unsigned char packet[SZ_PACKET + 4] = {0};
-		rc = reefnet_sensusultra_page (device, packet, sizeof (packet), npages);
-		if (rc != DC_STATUS_SUCCESS) {
-			dc_buffer_free (buffer);
-			return rc;
-		}
+	int aborted = 0;
+	while (1) {
+		if (!threaded && !queue->done)
+			reefnet_sensusultra_receive (queue);
+
+		// Wait for the next page.
+		dc_mutex_lock (&queue->lock);
+		while (queue->head == queue->tail && !queue->done)
+			dc_cond_wait (&queue->cond, &queue->lock);
+		int available = (queue->head != queue->tail);
+		dc_mutex_unlock (&queue->lock);
+
+		if (!available)
+			break;
 
 		// Update and emit a progress event.
 		progress.current += SZ_PACKET;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-		// Abort the transfer if the page contains no useful data.
-		if (array_isequal (packet + 2, SZ_PACKET, 0xFF) && nbytes != 0)
-			break;
+		// Prepend the packet to the buffer. The receiver does not touch
+		// the slot until it has been released.
+		int success = dc_buffer_prepend (buffer, queue->pages[queue->head % NQUEUE], SZ_PACKET);
 
-		// Prepend the packet to the buffer.
-		if (!dc_buffer_prepend (buffer, packet + 2, SZ_PACKET)) {
+		dc_mutex_lock (&queue->lock);
+		queue->head++;
+		dc_cond_broadcast (&queue->cond);
+		dc_mutex_unlock (&queue->lock);
+
+		if (!success) {
 			ERROR (abstract->context, "Insufficient buffer space available.");
-			return DC_STATUS_NOMEMORY;
+			rc = DC_STATUS_NOMEMORY;
+			break;
 		}
 
 		// Update the parser state.
@@ -725,30 +847,34 @@ reefnet_sensusultra_device_foreach (dc_device_t *abstract, dc_dive_callback_t ca
 		previous += SZ_PACKET;
 
 		// Parse the page data.
-		int aborted = 0;
 		rc = reefnet_sensusultra_parse (device, dc_buffer_get_data (buffer),
 			&remaining, &previous, &aborted, callback, userdata);
-		if (rc != DC_STATUS_SUCCESS) {
-			dc_buffer_free (buffer);
-			return rc;
-		}
-		if (aborted)
+		if (rc != DC_STATUS_SUCCESS || aborted)
 			break;
+	}
 
-		// Accept the packet.
-		rc = reefnet_sensusultra_send_uchar (device, ACCEPT);
-		if (rc != DC_STATUS_SUCCESS) {
-			dc_buffer_free (buffer);
-			return rc;
-		}
+	// Stop the receiver. The pages that are already accepted or in
+	// transit are discarded by the purge at the start of the next
+	// command.
+	dc_mutex_lock (&queue->lock);
+	queue->stop = 1;
+	dc_cond_broadcast (&queue->cond);
+	dc_mutex_unlock (&queue->lock);
 
-		nbytes += SZ_PACKET;
-		npages++;
-	}
+	if (threaded)
+		dc_thread_join (&thread);
 
+	dc_cond_free (&queue->cond);
+	dc_mutex_free (&queue->lock);
+
+	// A receive error is only reported if the parser did not stop first.
+	if (rc == DC_STATUS_SUCCESS && !aborted)
+		rc = queue->status;
+
+	dc_context_dealloc (abstract->context, queue);
 	dc_buffer_free (buffer);
 
-	return DC_STATUS_SUCCESS;
+	return rc;
 }
 
 
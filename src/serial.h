@@ -24,6 +24,7 @@
 
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/context.h>
+#include <libdivecomputer/serial_monitor.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -188,8 +189,10 @@ dc_serial_set_halfduplex (dc_serial_t *serial, unsigned int value);
  *
  * The effect of this setting is highly platform and driver specific. On
  * Windows it does nothing at all, on Linux it controls the low latency
- * flag (e.g. only zero vs non-zero latency), and on Mac OS X it sets
- * the receive latency as requested.
+ * flag (e.g. only zero vs non-zero latency) and the latency timer of USB
+ * serial converters (with zero mapped to the minimum of 1 ms), and on
+ * Mac OS X it sets the receive latency as requested. The original
+ * latency timer is restored when the connection is closed.
  *
  * @param[in]  serial  A valid serial connection.
  * @param[in]  value   The latency in milliseconds.
@@ -227,6 +230,50 @@ dc_serial_read (dc_serial_t *serial, void *data, size_t size, size_t *actual);
 dc_status_t
 dc_serial_write (dc_serial_t *serial, const void *data, size_t size, size_t *actual);
 
+/**
+ * Read at least the minimum number of bytes from the serial connection,
+ * and up to the maximum number of bytes if they are already available.
+ *
+ * @param[in]  serial   A valid serial connection.
+ * @param[out] data     The memory buffer to read the data into.
+ * @param[in]  minimum  The minimum number of bytes to read.
+ * @param[in]  maximum  The maximum number of bytes to read.
+ * @param[out] actual   An (optional) location to store the actual
+ *                      number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_read_some (dc_serial_t *serial, void *data, size_t minimum, size_t maximum, size_t *actual);
+
+/**
+ * Read data from the serial connection into several memory buffers.
+ *
+ * @param[in]  serial  A valid serial connection.
+ * @param[in]  iov     The memory buffers to read the data into.
+ * @param[in]  count   The number of memory buffers.
+ * @param[out] actual  An (optional) location to store the actual
+ *                     number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_readv (dc_serial_t *serial, const dc_iovec_t iov[], unsigned int count, size_t *actual);
+
+/**
+ * Write data from several memory buffers to the serial connection.
+ *
+ * @param[in]  serial  A valid serial connection.
+ * @param[in]  iov     The memory buffers to write the data from.
+ * @param[in]  count   The number of memory buffers.
+ * @param[out] actual  An (optional) location to store the actual
+ *                     number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_writev (dc_serial_t *serial, const dc_iovec_t iov[], unsigned int count, size_t *actual);
+
 /**
  * Flush the internal output buffer and wait until the data has been
  * transmitted.
@@ -294,6 +341,22 @@ dc_serial_set_rts (dc_serial_t *serial, unsigned int value);
 dc_status_t
 dc_serial_get_available (dc_serial_t *serial, size_t *value);
 
+/**
+ * Wait until data is available in the input buffer.
+ *
+ * Blocks until at least one byte can be read, or the timeout expires,
+ * without polling. Backends waiting for user interaction call this in
+ * a loop, and check for cancellation in between.
+ *
+ * @param[in]  serial   A valid serial connection.
+ * @param[in]  timeout  The timeout in milliseconds. A negative value
+ *                      waits forever, and zero returns immediately.
+ * @returns #DC_STATUS_SUCCESS if data is available, #DC_STATUS_TIMEOUT
+ * if the timeout expired, or another #dc_status_t code on failure.
+ */
+dc_status_t
+dc_serial_wait (dc_serial_t *serial, int timeout);
+
 /**
  * Query the state of the line signals.
  *
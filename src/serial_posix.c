@@ -24,14 +24,17 @@
 #endif
 
 #include <stdlib.h> // malloc, free
-#include <string.h>	// strerror
+#include <string.h>	// strerror, memcpy
 #include <errno.h>	// errno
 #include <unistd.h>	// open, close, read, write
 #include <fcntl.h>	// fcntl
 #include <termios.h>	// tcgetattr, tcsetattr, cfsetispeed, cfsetospeed, tcflush, tcsendbreak
 #include <sys/ioctl.h>	// ioctl
+#include <sys/stat.h>	// fstat
+#ifdef HAVE_SYS_SYSMACROS_H
+#include <sys/sysmacros.h>	// major, minor
+#endif
 #include <sys/time.h>	// gettimeofday
-#include <time.h>	// nanosleep
 #ifdef HAVE_LINUX_SERIAL_H
 #include <linux/serial.h>
 #endif
@@ -42,6 +45,9 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <fnmatch.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 
 #ifndef TIOCINQ
 #define TIOCINQ FIONREAD
@@ -53,6 +59,8 @@
 #define NOPTY 1
 #endif
 
+#define DEVDIR "/dev"
+
 #include "serial.h"
 #include "common-private.h"
 #include "context-private.h"
@@ -75,6 +83,11 @@ struct dc_serial_t {
 	int halfduplex;
 	unsigned int baudrate;
 	unsigned int nbits;
+	/*
+	 * The original latency timer of the USB serial converter, or
+	 * negative if it has not been changed.
+	 */
+	int latency;
 };
 
 static dc_status_t
@@ -95,12 +108,9 @@ syserror(int errcode)
 	}
 }
 
-dc_status_t
-dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
+static int
+dc_serial_match (const char *name)
 {
-	DIR *dp = NULL;
-	struct dirent *ep = NULL;
-	const char *dirname = "/dev";
 	const char *patterns[] = {
 #if defined (__APPLE__)
 		"tty.*",
@@ -113,30 +123,437 @@ dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
 		NULL
 	};
 
+	for (size_t i = 0; patterns[i] != NULL; ++i) {
+		if (fnmatch (patterns[i], name, 0) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
+dc_status_t
+dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
+{
+	DIR *dp = NULL;
+	struct dirent *ep = NULL;
+	const char *dirname = DEVDIR;
+
 	dp = opendir (dirname);
 	if (dp == NULL) {
 		return DC_STATUS_IO;
 	}
 
 	while ((ep = readdir (dp)) != NULL) {
-		for (size_t i = 0; patterns[i] != NULL; ++i) {
-			if (fnmatch (patterns[i], ep->d_name, 0) == 0) {
-				char filename[1024];
-				int n = snprintf (filename, sizeof (filename), "%s/%s", dirname, ep->d_name);
-				if (n >= sizeof (filename)) {
-					closedir (dp);
-					return DC_STATUS_NOMEMORY;
-				}
+		if (dc_serial_match (ep->d_name)) {
+			char filename[1024];
+			int n = snprintf (filename, sizeof (filename), "%s/%s", dirname, ep->d_name);
+			if (n >= sizeof (filename)) {
+				closedir (dp);
+				return DC_STATUS_NOMEMORY;
+			}
+
+			callback (filename, userdata);
+		}
+	}
+
+	closedir (dp);
+
+	return DC_STATUS_SUCCESS;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+typedef struct dc_serial_port_t {
+	struct dc_serial_port_t *next;
+	unsigned int vid;
+	unsigned int pid;
+	unsigned int seen;
+	char name[];
+} dc_serial_port_t;
+
+struct dc_serial_monitor_t {
+	/* Library context. */
+	dc_context_t *context;
+	/* The inotify descriptor watching the device directory. */
+	int fd;
+	dc_serial_monitor_callback_t callback;
+	void *userdata;
+	/* The ports reported so far. */
+	dc_serial_port_t *ports;
+};
+
+static unsigned int
+dc_serial_sysfs_read (const char *dirname, const char *attribute)
+{
+	char filename[1024];
+	int n = snprintf (filename, sizeof (filename), "%s%s", dirname, attribute);
+	if (n < 0 || n >= sizeof (filename))
+		return 0;
+
+	FILE *fp = fopen (filename, "r");
+	if (fp == NULL)
+		return 0;
+
+	unsigned int value = 0;
+	if (fscanf (fp, "%x", &value) != 1)
+		value = 0;
+
+	fclose (fp);
+
+	return value;
+}
+
+static void
+dc_serial_sysfs_ids (const char *name, unsigned int *vid, unsigned int *pid)
+{
+	char dirname[1024];
+
+	*vid = 0;
+	*pid = 0;
+
+	int n = snprintf (dirname, sizeof (dirname), "/sys/class/tty/%s/device/", name);
+	if (n < 0 || n >= sizeof (dirname))
+		return;
+
+	// The device link points to the USB interface (ttyACM) or to a
+	// child of it (ttyUSB). Walk up until the USB device is reached.
+	for (unsigned int i = 0; i < 4; ++i) {
+		*vid = dc_serial_sysfs_read (dirname, "idVendor");
+		if (*vid) {
+			*pid = dc_serial_sysfs_read (dirname, "idProduct");
+			return;
+		}
+
+		size_t length = strlen (dirname);
+		if (length + 3 >= sizeof (dirname))
+			return;
+		memcpy (dirname + length, "../", 4);
+	}
+}
+
+static void
+dc_serial_monitor_notify (dc_serial_monitor_t *monitor, dc_serial_event_t event, dc_serial_port_t *port)
+{
+	char filename[1024];
+	int n = snprintf (filename, sizeof (filename), "%s/%s", DEVDIR, port->name);
+	if (n < 0 || n >= sizeof (filename))
+		return;
+
+	INFO (monitor->context, "Hotplug: event=%s, name=%s, vid=%04x, pid=%04x",
+		event == DC_SERIAL_EVENT_ADD ? "add" : "remove",
+		filename, port->vid, port->pid);
+
+	if (monitor->callback)
+		monitor->callback (event, filename, port->vid, port->pid, monitor->userdata);
+}
+
+static dc_status_t
+dc_serial_monitor_add (dc_serial_monitor_t *monitor, const char *name)
+{
+	for (dc_serial_port_t *port = monitor->ports; port != NULL; port = port->next) {
+		if (strcmp (port->name, name) == 0) {
+			port->seen = 1;
+			return DC_STATUS_SUCCESS;
+		}
+	}
+
+	size_t length = strlen (name);
+	dc_serial_port_t *port = (dc_serial_port_t *) dc_context_alloc (monitor->context, sizeof (dc_serial_port_t) + length + 1);
+	if (port == NULL) {
+		SYSERROR (monitor->context, ENOMEM);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	memcpy (port->name, name, length + 1);
+	dc_serial_sysfs_ids (name, &port->vid, &port->pid);
+	port->seen = 1;
+	port->next = monitor->ports;
+	monitor->ports = port;
+
+	dc_serial_monitor_notify (monitor, DC_SERIAL_EVENT_ADD, port);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static void
+dc_serial_monitor_remove (dc_serial_monitor_t *monitor, const char *name)
+{
+	dc_serial_port_t **link = &monitor->ports;
+	while (*link != NULL) {
+		dc_serial_port_t *port = *link;
+		if (name ? strcmp (port->name, name) == 0 : !port->seen) {
+			*link = port->next;
+			dc_serial_monitor_notify (monitor, DC_SERIAL_EVENT_REMOVE, port);
+			dc_context_dealloc (monitor->context, port);
+		} else {
+			link = &port->next;
+		}
+	}
+}
+
+static void
+dc_serial_monitor_clear (dc_serial_monitor_t *monitor)
+{
+	while (monitor->ports) {
+		dc_serial_port_t *port = monitor->ports;
+		monitor->ports = port->next;
+		dc_context_dealloc (monitor->context, port);
+	}
+}
+
+static dc_status_t
+dc_serial_monitor_rescan (dc_serial_monitor_t *monitor)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	DIR *dp = NULL;
+	struct dirent *ep = NULL;
 
-				callback (filename, userdata);
+	dp = opendir (DEVDIR);
+	if (dp == NULL) {
+		int errcode = errno;
+		SYSERROR (monitor->context, errcode);
+		return syserror (errcode);
+	}
+
+	for (dc_serial_port_t *port = monitor->ports; port != NULL; port = port->next) {
+		port->seen = 0;
+	}
+
+	while ((ep = readdir (dp)) != NULL) {
+		if (dc_serial_match (ep->d_name)) {
+			status = dc_serial_monitor_add (monitor, ep->d_name);
+			if (status != DC_STATUS_SUCCESS)
 				break;
-			}
 		}
 	}
 
 	closedir (dp);
 
+	// Ports that are no longer present have been removed.
+	if (status == DC_STATUS_SUCCESS)
+		dc_serial_monitor_remove (monitor, NULL);
+
+	return status;
+}
+#endif
+
+dc_status_t
+dc_serial_monitor_new (dc_serial_monitor_t **out, dc_context_t *context, dc_serial_monitor_callback_t callback, void *userdata)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_monitor_t *monitor = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Allocate memory.
+	monitor = (dc_serial_monitor_t *) dc_context_alloc (context, sizeof (dc_serial_monitor_t));
+	if (monitor == NULL) {
+		SYSERROR (context, ENOMEM);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	monitor->context = context;
+	monitor->callback = callback;
+	monitor->userdata = userdata;
+	monitor->ports = NULL;
+
+	monitor->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (monitor->fd == -1) {
+		int errcode = errno;
+		SYSERROR (context, errcode);
+		status = syserror (errcode);
+		goto error_free;
+	}
+
+	// Watch the device directory before the initial scan, to ensure
+	// no port can appear unnoticed in between.
+	if (inotify_add_watch (monitor->fd, DEVDIR, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR) == -1) {
+		int errcode = errno;
+		SYSERROR (context, errcode);
+		status = syserror (errcode);
+		goto error_close;
+	}
+
+	status = dc_serial_monitor_rescan (monitor);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_close;
+	}
+
+	*out = monitor;
+
+	return DC_STATUS_SUCCESS;
+
+error_close:
+	dc_serial_monitor_clear (monitor);
+	close (monitor->fd);
+error_free:
+	dc_context_dealloc (context, monitor);
+	return status;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+}
+
+dc_status_t
+dc_serial_monitor_poll (dc_serial_monitor_t *monitor, int timeout)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (monitor == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	while (1) {
+		fd_set fds;
+		FD_ZERO (&fds);
+		FD_SET (monitor->fd, &fds);
+
+		struct timeval tvt;
+		if (timeout > 0) {
+			tvt.tv_sec  = (timeout / 1000);
+			tvt.tv_usec = (timeout % 1000) * 1000;
+		} else {
+			timerclear (&tvt);
+		}
+
+		int rc = select (monitor->fd + 1, &fds, NULL, NULL, timeout >= 0 ? &tvt : NULL);
+		if (rc < 0) {
+			int errcode = errno;
+			if (errcode == EINTR)
+				continue; // Retry.
+			SYSERROR (monitor->context, errcode);
+			return syserror (errcode);
+		} else if (rc == 0) {
+			return DC_STATUS_TIMEOUT;
+		}
+
+		break;
+	}
+
+	// Drain all pending events.
+	while (1) {
+		union {
+			struct inotify_event event;
+			char data[4096];
+		} buffer;
+
+		ssize_t n = read (monitor->fd, buffer.data, sizeof (buffer.data));
+		if (n < 0) {
+			int errcode = errno;
+			if (errcode == EINTR)
+				continue; // Retry.
+			if (errcode == EAGAIN || errcode == EWOULDBLOCK)
+				break; // No more events.
+			SYSERROR (monitor->context, errcode);
+			return syserror (errcode);
+		}
+
+		size_t offset = 0;
+		while (offset + sizeof (struct inotify_event) <= (size_t) n) {
+			const struct inotify_event *event = (const struct inotify_event *) (buffer.data + offset);
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				// Events were lost, resynchronize with a full scan.
+				status = dc_serial_monitor_rescan (monitor);
+				if (status != DC_STATUS_SUCCESS)
+					return status;
+			} else if (event->len && dc_serial_match (event->name)) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					status = dc_serial_monitor_add (monitor, event->name);
+					if (status != DC_STATUS_SUCCESS)
+						return status;
+				} else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+					dc_serial_monitor_remove (monitor, event->name);
+				}
+			}
+
+			offset += sizeof (struct inotify_event) + event->len;
+		}
+	}
+
 	return DC_STATUS_SUCCESS;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+}
+
+dc_status_t
+dc_serial_monitor_free (dc_serial_monitor_t *monitor)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (monitor == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_serial_monitor_clear (monitor);
+
+	if (close (monitor->fd) != 0) {
+		int errcode = errno;
+		SYSERROR (monitor->context, errcode);
+		status = syserror (errcode);
+	}
+
+	dc_context_dealloc (monitor->context, monitor);
+
+	return status;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+}
+
+static dc_status_t
+dc_serial_latency_timer (dc_serial_t *device, int value, int *previous)
+{
+#ifdef __linux__
+	// The latency timer of USB serial converters (e.g. FTDI) is exposed
+	// as a sysfs attribute of the usb-serial port behind the tty.
+	struct stat st;
+	if (fstat (device->fd, &st) != 0 || !S_ISCHR (st.st_mode)) {
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	char filename[1024];
+	int n = snprintf (filename, sizeof (filename), "/sys/dev/char/%u:%u/device/latency_timer",
+		(unsigned int) major (st.st_rdev), (unsigned int) minor (st.st_rdev));
+	if (n < 0 || n >= sizeof (filename)) {
+		return DC_STATUS_NOMEMORY;
+	}
+
+	FILE *fp = fopen (filename, "r+");
+	if (fp == NULL) {
+		int errcode = errno;
+		if (errcode == ENOENT)
+			return DC_STATUS_UNSUPPORTED;
+		return syserror (errcode);
+	}
+
+	int current = 0;
+	if (fscanf (fp, "%d", &current) != 1) {
+		fclose (fp);
+		return DC_STATUS_IO;
+	}
+
+	if (previous)
+		*previous = current;
+
+	if (current != value) {
+		rewind (fp);
+		fprintf (fp, "%d", value);
+		if (fflush (fp) != 0) {
+			int errcode = errno;
+			fclose (fp);
+			return syserror (errcode);
+		}
+	}
+
+	fclose (fp);
+
+	return DC_STATUS_SUCCESS;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
 }
 
 dc_status_t
@@ -150,7 +567,7 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	INFO (context, "Open: name=%s", name ? name : "");
 
 	// Allocate memory.
-	dc_serial_t *device = (dc_serial_t *) malloc (sizeof (dc_serial_t));
+	dc_serial_t *device = (dc_serial_t *) dc_context_alloc (context, sizeof (dc_serial_t));
 	if (device == NULL) {
 		SYSERROR (context, ENOMEM);
 		return DC_STATUS_NOMEMORY;
@@ -167,6 +584,9 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	device->baudrate = 0;
 	device->nbits = 0;
 
+	// Default to the driver latency timer.
+	device->latency = -1;
+
 	RETURN_IF_CUSTOM_SERIAL(context, *out = device, open, name);
 
 	// Open the device in non-blocking mode, to return immediately
@@ -207,7 +627,7 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 error_close:
 	close (device->fd);
 error_free:
-	free (device);
+	dc_context_dealloc (context, device);
 	return status;
 }
 
@@ -219,7 +639,12 @@ dc_serial_close (dc_serial_t *device)
 	if (device == NULL)
 		return DC_STATUS_SUCCESS;
 
-	RETURN_IF_CUSTOM_SERIAL(device->context, free(device), close);
+	RETURN_IF_CUSTOM_SERIAL(device->context, dc_context_dealloc (device->context, device), close);
+
+	// Restore the original latency timer.
+	if (device->latency >= 0) {
+		dc_serial_latency_timer (device, device->latency, NULL);
+	}
 
 	// Restore the initial terminal attributes.
 	if (tcsetattr (device->fd, TCSANOW, &device->tty) != 0) {
@@ -241,7 +666,7 @@ dc_serial_close (dc_serial_t *device)
 	}
 
 	// Free memory.
-	free (device);
+	dc_context_dealloc (device->context, device);
 
 	return status;
 }
@@ -511,7 +936,7 @@ dc_serial_set_timeout (dc_serial_t *device, int timeout)
 
 	INFO (device->context, "Timeout: value=%i", timeout);
 
-	RETURN_IF_CUSTOM_SERIAL(device->context, , set_timeout, timeout);
+	RETURN_IF_CUSTOM_SERIAL(device->context, device->timeout = timeout, set_timeout, timeout);
 
 	device->timeout = timeout;
 
@@ -537,6 +962,10 @@ dc_serial_set_latency (dc_serial_t *device, unsigned int milliseconds)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+	// There is no latency setting for a custom serial interface.
+	if (_dc_context_custom_serial (device->context))
+		return DC_STATUS_SUCCESS;
+
 #if defined(TIOCGSERIAL) && defined(TIOCSSERIAL) && !defined(__ANDROID__)
 	// Get the current settings.
 	struct serial_struct ss;
@@ -571,9 +1000,117 @@ dc_serial_set_latency (dc_serial_t *device, unsigned int milliseconds)
 	}
 #endif
 
+	// The low latency flag has no effect on the latency timer of a USB
+	// serial converter, which buffers small packets for up to 16 ms by
+	// default. Adjust it directly (1 to 255 ms), and remember the
+	// original value to restore it when closing the port. Changing the
+	// timer usually requires elevated privileges, so failures are not
+	// fatal.
+	int timer = milliseconds == 0 ? 1 : (milliseconds > 255 ? 255 : milliseconds);
+	int previous = -1;
+	dc_status_t rc = dc_serial_latency_timer (device, timer, &previous);
+	if (rc == DC_STATUS_SUCCESS) {
+		if (device->latency < 0)
+			device->latency = previous;
+	} else if (rc != DC_STATUS_UNSUPPORTED) {
+		WARNING (device->context, "Failed to set the latency timer (%d ms).", timer);
+	}
+
 	return DC_STATUS_SUCCESS;
 }
 
+static dc_status_t
+dc_serial_wait_poll (dc_serial_t *device, int timeout)
+{
+	const unsigned int interval = 10;
+	unsigned long long start = dc_context_monotonic (device->context);
+
+	while (1) {
+		size_t available = 0;
+		dc_status_t status = dc_serial_get_available (device, &available);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		if (available)
+			return DC_STATUS_SUCCESS;
+
+		if (timeout >= 0 && dc_context_monotonic (device->context) - start >= (unsigned long long) timeout * 1000)
+			return DC_STATUS_TIMEOUT;
+
+		dc_context_sleep (device->context, interval);
+	}
+}
+
+static dc_status_t
+dc_serial_select (dc_serial_t *device, int fd, int timeout)
+{
+	while (1) {
+		fd_set fds;
+		FD_ZERO (&fds);
+		FD_SET (fd, &fds);
+
+		struct timeval tvt;
+		if (timeout > 0) {
+			tvt.tv_sec  = (timeout / 1000);
+			tvt.tv_usec = (timeout % 1000) * 1000;
+		} else {
+			timerclear (&tvt);
+		}
+
+		int rc = select (fd + 1, &fds, NULL, NULL, timeout >= 0 ? &tvt : NULL);
+		if (rc < 0) {
+			int errcode = errno;
+			if (errcode == EINTR)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			return syserror (errcode);
+		} else if (rc == 0) {
+			return DC_STATUS_TIMEOUT;
+		}
+
+		return DC_STATUS_SUCCESS;
+	}
+}
+
+static dc_status_t
+dc_serial_custom_wait (dc_serial_t *device)
+{
+	dc_custom_transport_t *transport = _dc_context_custom_transport (device->context);
+	if (transport == NULL || transport->get_fd == NULL)
+		return DC_STATUS_SUCCESS;
+
+	// Check whether the transport provides a readiness descriptor.
+	int fd = transport->get_fd (&transport->serial.userdata);
+	if (fd < 0)
+		return DC_STATUS_SUCCESS;
+
+	return dc_serial_select (device, fd, device->timeout);
+}
+
+dc_status_t
+dc_serial_wait (dc_serial_t *device, int timeout)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (_dc_context_custom_serial (device->context)) {
+		dc_custom_transport_t *transport = _dc_context_custom_transport (device->context);
+		if (transport && transport->wait)
+			return transport->wait (&transport->serial.userdata, timeout);
+
+		if (transport && transport->get_fd) {
+			int fd = transport->get_fd (&transport->serial.userdata);
+			if (fd >= 0)
+				return dc_serial_select (device, fd, timeout);
+		}
+
+		// Without any native support, poll the number of available bytes.
+		return dc_serial_wait_poll (device, timeout);
+	}
+
+	return dc_serial_select (device, device->fd, timeout);
+}
+
 dc_status_t
 dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 {
@@ -585,6 +1122,13 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 		goto out;
 	}
 
+	// Wait until the custom transport has data available.
+	if (size && _dc_context_custom_serial (device->context)) {
+		status = dc_serial_custom_wait (device);
+		if (status != DC_STATUS_SUCCESS)
+			goto out;
+	}
+
 	RETURN_IF_CUSTOM_SERIAL(device->context,
 			{
 				HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Read", (unsigned char *) data, nbytes);
@@ -788,6 +1332,157 @@ out:
 	return status;
 }
 
+dc_status_t
+dc_serial_read_some (dc_serial_t *device, void *data, size_t minimum, size_t maximum, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL || minimum > maximum) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	dc_custom_transport_t *transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->read_some) {
+		status = dc_serial_custom_wait (device);
+		if (status == DC_STATUS_SUCCESS)
+			status = transport->read_some (&transport->serial.userdata, data, minimum, maximum, &nbytes);
+		HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Read", (unsigned char *) data, nbytes);
+		goto out;
+	}
+
+	// Read the minimum amount of data.
+	status = dc_serial_read (device, data, minimum, &nbytes);
+	if (status != DC_STATUS_SUCCESS)
+		goto out;
+
+	// Read the data that is already available, up to the maximum.
+	size_t available = 0;
+	status = dc_serial_get_available (device, &available);
+	if (status != DC_STATUS_SUCCESS)
+		goto out;
+
+	if (available > maximum - nbytes)
+		available = maximum - nbytes;
+
+	if (available) {
+		size_t n = 0;
+		status = dc_serial_read (device, (char *) data + nbytes, available, &n);
+		nbytes += n;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_serial_readv (dc_serial_t *device, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_custom_transport_t *transport = NULL;
+	size_t nbytes = 0;
+
+	if (device == NULL || (iov == NULL && count)) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->readv) {
+		status = dc_serial_custom_wait (device);
+		if (status == DC_STATUS_SUCCESS)
+			status = transport->readv (&transport->serial.userdata, iov, count, &nbytes);
+		size_t remaining = nbytes;
+		for (unsigned int i = 0; i < count && remaining; ++i) {
+			size_t n = (iov[i].size < remaining ? iov[i].size : remaining);
+			HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Read", (unsigned char *) iov[i].data, n);
+			remaining -= n;
+		}
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		size_t n = 0;
+		status = dc_serial_read (device, iov[i].data, iov[i].size, &n);
+		nbytes += n;
+		if (status != DC_STATUS_SUCCESS)
+			break;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_serial_writev (dc_serial_t *device, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_custom_transport_t *transport = NULL;
+	size_t nbytes = 0;
+	unsigned char buffer[256];
+	size_t nbuffer = 0, n = 0;
+
+	if (device == NULL || (iov == NULL && count)) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->writev) {
+		status = transport->writev (&transport->serial.userdata, iov, count, &nbytes);
+		size_t remaining = nbytes;
+		for (unsigned int i = 0; i < count && remaining; ++i) {
+			size_t n = (iov[i].size < remaining ? iov[i].size : remaining);
+			HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Write", (unsigned char *) iov[i].data, n);
+			remaining -= n;
+		}
+		goto out;
+	}
+
+	// Gather the buffers into larger blocks, because each write waits
+	// until all data has been transmitted.
+	for (unsigned int i = 0; i < count; ++i) {
+		const unsigned char *data = (const unsigned char *) iov[i].data;
+		size_t offset = 0;
+		while (offset < iov[i].size) {
+			// Flush the block if it's full.
+			if (nbuffer == sizeof (buffer)) {
+				status = dc_serial_write (device, buffer, nbuffer, &n);
+				nbytes += n;
+				if (status != DC_STATUS_SUCCESS)
+					goto out;
+				nbuffer = 0;
+			}
+
+			size_t len = iov[i].size - offset;
+			if (len > sizeof (buffer) - nbuffer)
+				len = sizeof (buffer) - nbuffer;
+			memcpy (buffer + nbuffer, data + offset, len);
+			nbuffer += len;
+			offset += len;
+		}
+	}
+
+	// Flush the remaining data.
+	if (nbuffer) {
+		status = dc_serial_write (device, buffer, nbuffer, &n);
+		nbytes += n;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
 dc_status_t
 dc_serial_purge (dc_serial_t *device, dc_direction_t direction)
 {
@@ -958,17 +1653,7 @@ dc_serial_sleep (dc_serial_t *device, unsigned int timeout)
 
 	INFO (device->context, "Sleep: value=%u", timeout);
 
-	struct timespec ts;
-	ts.tv_sec  = (timeout / 1000);
-	ts.tv_nsec = (timeout % 1000) * 1000000;
-
-	while (nanosleep (&ts, &ts) != 0) {
-		int errcode = errno;
-		if (errcode != EINTR ) {
-			SYSERROR (device->context, errcode);
-			return syserror (errcode);
-		}
-	}
+	dc_context_sleep (device->context, timeout);
 
 	return DC_STATUS_SUCCESS;
 }
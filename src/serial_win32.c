@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #define NOGDI
 #include <windows.h>
@@ -119,6 +120,24 @@ dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_monitor_new (dc_serial_monitor_t **out, dc_context_t *context, dc_serial_monitor_callback_t callback, void *userdata)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_serial_monitor_poll (dc_serial_monitor_t *monitor, int timeout)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_serial_monitor_free (dc_serial_monitor_t *monitor)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
 dc_status_t
 dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 {
@@ -143,7 +162,7 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	}
 
 	// Allocate memory.
-	dc_serial_t *device = (dc_serial_t *) malloc (sizeof (dc_serial_t));
+	dc_serial_t *device = (dc_serial_t *) dc_context_alloc (context, sizeof (dc_serial_t));
 	if (device == NULL) {
 		SYSERROR (context, ERROR_OUTOFMEMORY);
 		return DC_STATUS_NOMEMORY;
@@ -192,7 +211,7 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 error_close:
 	CloseHandle (device->hFile);
 error_free:
-	free (device);
+	dc_context_dealloc (context, device);
 	return status;
 }
 
@@ -204,7 +223,7 @@ dc_serial_close (dc_serial_t *device)
 	if (device == NULL)
 		return DC_STATUS_SUCCESS;
 
-	RETURN_IF_CUSTOM_SERIAL(device->context, free(device), close);
+	RETURN_IF_CUSTOM_SERIAL(device->context, dc_context_dealloc (device->context, device), close);
 
 	// Restore the initial communication settings and timeouts.
 	if (!SetCommState (device->hFile, &device->dcb) ||
@@ -222,7 +241,7 @@ dc_serial_close (dc_serial_t *device)
 	}
 
 	// Free memory.
-	free (device);
+	dc_context_dealloc (device->context, device);
 
 	return status;
 }
@@ -535,6 +554,153 @@ out:
 	return status;
 }
 
+dc_status_t
+dc_serial_read_some (dc_serial_t *device, void *data, size_t minimum, size_t maximum, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL || minimum > maximum) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	dc_custom_transport_t *transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->read_some) {
+		status = transport->read_some (&transport->serial.userdata, data, minimum, maximum, &nbytes);
+		HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Read", (unsigned char *) data, nbytes);
+		goto out;
+	}
+
+	// Read the minimum amount of data.
+	status = dc_serial_read (device, data, minimum, &nbytes);
+	if (status != DC_STATUS_SUCCESS)
+		goto out;
+
+	// Read the data that is already available, up to the maximum.
+	size_t available = 0;
+	status = dc_serial_get_available (device, &available);
+	if (status != DC_STATUS_SUCCESS)
+		goto out;
+
+	if (available > maximum - nbytes)
+		available = maximum - nbytes;
+
+	if (available) {
+		size_t n = 0;
+		status = dc_serial_read (device, (char *) data + nbytes, available, &n);
+		nbytes += n;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_serial_readv (dc_serial_t *device, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_custom_transport_t *transport = NULL;
+	size_t nbytes = 0;
+
+	if (device == NULL || (iov == NULL && count)) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->readv) {
+		status = transport->readv (&transport->serial.userdata, iov, count, &nbytes);
+		size_t remaining = nbytes;
+		for (unsigned int i = 0; i < count && remaining; ++i) {
+			size_t n = (iov[i].size < remaining ? iov[i].size : remaining);
+			HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Read", (unsigned char *) iov[i].data, n);
+			remaining -= n;
+		}
+		goto out;
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		size_t n = 0;
+		status = dc_serial_read (device, iov[i].data, iov[i].size, &n);
+		nbytes += n;
+		if (status != DC_STATUS_SUCCESS)
+			break;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_serial_writev (dc_serial_t *device, const dc_iovec_t iov[], unsigned int count, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_custom_transport_t *transport = NULL;
+	size_t nbytes = 0;
+	unsigned char buffer[256];
+	size_t nbuffer = 0, n = 0;
+
+	if (device == NULL || (iov == NULL && count)) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out;
+	}
+
+	transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->writev) {
+		status = transport->writev (&transport->serial.userdata, iov, count, &nbytes);
+		size_t remaining = nbytes;
+		for (unsigned int i = 0; i < count && remaining; ++i) {
+			size_t n = (iov[i].size < remaining ? iov[i].size : remaining);
+			HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Custom Write", (unsigned char *) iov[i].data, n);
+			remaining -= n;
+		}
+		goto out;
+	}
+
+	// Gather the buffers into larger blocks, because each write waits
+	// until all data has been transmitted.
+	for (unsigned int i = 0; i < count; ++i) {
+		const unsigned char *data = (const unsigned char *) iov[i].data;
+		size_t offset = 0;
+		while (offset < iov[i].size) {
+			// Flush the block if it's full.
+			if (nbuffer == sizeof (buffer)) {
+				status = dc_serial_write (device, buffer, nbuffer, &n);
+				nbytes += n;
+				if (status != DC_STATUS_SUCCESS)
+					goto out;
+				nbuffer = 0;
+			}
+
+			size_t len = iov[i].size - offset;
+			if (len > sizeof (buffer) - nbuffer)
+				len = sizeof (buffer) - nbuffer;
+			memcpy (buffer + nbuffer, data + offset, len);
+			nbuffer += len;
+			offset += len;
+		}
+	}
+
+	// Flush the remaining data.
+	if (nbuffer) {
+		status = dc_serial_write (device, buffer, nbuffer, &n);
+		nbytes += n;
+	}
+
+out:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
 dc_status_t
 dc_serial_purge (dc_serial_t *device, dc_direction_t direction)
 {
@@ -678,6 +844,44 @@ dc_serial_get_available (dc_serial_t *device, size_t *value)
 	return DC_STATUS_SUCCESS;
 }
 
+static dc_status_t
+dc_serial_wait_poll (dc_serial_t *device, int timeout)
+{
+	const unsigned int interval = 10;
+	unsigned long long start = dc_context_monotonic (device->context);
+
+	while (1) {
+		size_t available = 0;
+		dc_status_t status = dc_serial_get_available (device, &available);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		if (available)
+			return DC_STATUS_SUCCESS;
+
+		if (timeout >= 0 && dc_context_monotonic (device->context) - start >= (unsigned long long) timeout * 1000)
+			return DC_STATUS_TIMEOUT;
+
+		dc_context_sleep (device->context, interval);
+	}
+}
+
+dc_status_t
+dc_serial_wait (dc_serial_t *device, int timeout)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_custom_transport_t *transport = _dc_context_custom_transport (device->context);
+	if (transport && transport->wait)
+		return transport->wait (&transport->serial.userdata, timeout);
+
+	// The port is opened without overlapped I/O, and WaitCommEvent can't
+	// be combined with a timeout in that mode. Poll the input queue at a
+	// short interval instead.
+	return dc_serial_wait_poll (device, timeout);
+}
+
 dc_status_t
 dc_serial_get_lines (dc_serial_t *device, unsigned int *value)
 {
@@ -716,7 +920,7 @@ dc_serial_sleep (dc_serial_t *device, unsigned int timeout)
 
 	INFO (device->context, "Sleep: value=%u", timeout);
 
-	Sleep (timeout);
+	dc_context_sleep (device->context, timeout);
 
 	return DC_STATUS_SUCCESS;
 }
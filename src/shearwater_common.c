@@ -35,6 +35,16 @@
 #define ESC_END   0xDC
 #define ESC_ESC   0xDD
 
+static void
+shearwater_common_purge (shearwater_common_device_t *device)
+{
+	dc_serial_purge (device->port, DC_DIRECTION_ALL);
+
+	// Empty the receive buffer, because it contains data from the port.
+	device->roffset = 0;
+	device->rsize = 0;
+}
+
 dc_status_t
 shearwater_common_open (shearwater_common_device_t *device, dc_context_t *context, const char *name)
 {
@@ -64,7 +74,7 @@ shearwater_common_open (shearwater_common_device_t *device, dc_context_t *contex
 
 	// Make sure everything is in a sane state.
 	dc_serial_sleep (device->port, 300);
-	dc_serial_purge (device->port, DC_DIRECTION_ALL);
+	shearwater_common_purge (device);
 
 	return DC_STATUS_SUCCESS;
 
@@ -144,68 +154,93 @@ shearwater_common_decompress_xor (unsigned char *data, unsigned int size)
 static dc_status_t
 shearwater_common_slip_write (shearwater_common_device_t *device, const unsigned char data[], unsigned int size)
 {
-	dc_status_t status = DC_STATUS_SUCCESS;
-	const unsigned char end[] = {END};
-	const unsigned char esc_end[] = {ESC, ESC_END};
-	const unsigned char esc_esc[] = {ESC, ESC_ESC};
-	unsigned char buffer[32];
-	unsigned int nbytes = 0;
+	static const unsigned char end[] = {END};
+	static const unsigned char esc_end[] = {ESC, ESC_END};
+	static const unsigned char esc_esc[] = {ESC, ESC_ESC};
+	dc_iovec_t iov[2 * (SZ_PACKET + 4) + 3];
+	unsigned int count = 0;
+
+	if (size > SZ_PACKET + 4)
+		return DC_STATUS_INVALIDARGS;
 
 #if 0
 	// Send an initial END character to flush out any data that may have
 	// accumulated in the receiver due to line noise.
-	status = dc_serial_write (device->port, end, sizeof (end), NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		return status;
-	}
+	iov[count].data = (void *) end;
+	iov[count].size = sizeof (end);
+	count++;
 #endif
 
+	// Split the packet into runs of normal characters and escape
+	// sequences, and send them all with a single write.
+	unsigned int begin = 0;
 	for (unsigned int i = 0; i < size; ++i) {
 		const unsigned char *seq = NULL;
-		unsigned int len = 0;
 		switch (data[i]) {
 		case END:
 			// Escape the END character.
 			seq = esc_end;
-			len = sizeof (esc_end);
 			break;
 		case ESC:
 			// Escape the ESC character.
 			seq = esc_esc;
-			len = sizeof (esc_esc);
 			break;
 		default:
 			// Normal character.
-			seq = data + i;
-			len = 1;
-			break;
+			continue;
 		}
 
-		// Flush the buffer if necessary.
-		if (nbytes + len + sizeof(end) > sizeof(buffer)) {
-			status = dc_serial_write (device->port, buffer, nbytes, NULL);
-			if (status != DC_STATUS_SUCCESS) {
-				return status;
-			}
-
-			nbytes = 0;
+		// Append the preceding normal characters.
+		if (i > begin) {
+			iov[count].data = (void *) (data + begin);
+			iov[count].size = i - begin;
+			count++;
 		}
 
-		// Append the escaped character.
-		memcpy(buffer + nbytes, seq, len);
-		nbytes += len;
+		// Append the escape sequence.
+		iov[count].data = (void *) seq;
+		iov[count].size = 2;
+		count++;
+
+		begin = i + 1;
+	}
+
+	// Append the remaining normal characters.
+	if (size > begin) {
+		iov[count].data = (void *) (data + begin);
+		iov[count].size = size - begin;
+		count++;
 	}
 
 	// Append the END character to indicate the end of the packet.
-	memcpy(buffer + nbytes, end, sizeof(end));
-	nbytes += sizeof(end);
+	iov[count].data = (void *) end;
+	iov[count].size = sizeof (end);
+	count++;
 
-	// Flush the buffer.
-	status = dc_serial_write (device->port, buffer, nbytes, NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		return status;
+	return dc_serial_writev (device->port, iov, count, NULL);
+}
+
+
+static dc_status_t
+shearwater_common_slip_getc (shearwater_common_device_t *device, unsigned char *c)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Refill the receive buffer with all the data that is available,
+	// instead of reading the packet one byte at a time.
+	if (device->roffset == device->rsize) {
+		size_t nbytes = 0;
+		status = dc_serial_read_some (device->port, device->rbuf, 1, sizeof (device->rbuf), &nbytes);
+		if (status != DC_STATUS_SUCCESS) {
+			return status;
+		}
+
+		device->roffset = 0;
+		device->rsize = nbytes;
 	}
 
+	*c = device->rbuf[device->roffset++];
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -224,7 +259,7 @@ shearwater_common_slip_read (shearwater_common_device_t *device, unsigned char d
 		unsigned char c = 0;
 
 		// Get a single character to process.
-		status = dc_serial_read (device->port, &c, 1, NULL);
+		status = shearwater_common_slip_getc (device, &c);
 		if (status != DC_STATUS_SUCCESS) {
 			return status;
 		}
@@ -243,7 +278,7 @@ shearwater_common_slip_read (shearwater_common_device_t *device, unsigned char d
 		case ESC:
 			// If it's an ESC character, get another character and then
 			// figure out what to store in the packet based on that.
-			status = dc_serial_read (device->port, &c, 1, NULL);
+			status = shearwater_common_slip_getc (device, &c);
 			if (status != DC_STATUS_SUCCESS) {
 				return status;
 			}
@@ -318,12 +353,14 @@ shearwater_common_transfer (shearwater_common_device_t *device, const unsigned c
 	status = shearwater_common_slip_read (device, packet, sizeof (packet), &n);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to receive the response packet.");
+		shearwater_common_purge (device);
 		return status;
 	}
 
 	// Validate the packet header.
 	if (n < 4 || packet[0] != 0x01 || packet[1] != 0xFF || packet[3] != 0x00) {
 		ERROR (abstract->context, "Invalid packet header.");
+		shearwater_common_purge (device);
 		return DC_STATUS_PROTOCOL;
 	}
 
@@ -343,7 +380,7 @@ shearwater_common_transfer (shearwater_common_device_t *device, const unsigned c
 
 
 dc_status_t
-shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buffer, unsigned int address, unsigned int size, unsigned int compression)
+shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buffer, unsigned int address, unsigned int size, unsigned int compression, dc_event_progress_t *progress)
 {
 	dc_device_t *abstract = (dc_device_t *) device;
 	dc_status_t rc = DC_STATUS_SUCCESS;
@@ -370,10 +407,16 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 		return DC_STATUS_NOMEMORY;
 	}
 
-	// Enable progress notifications.
-	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
-	progress.maximum = 3 + size + 1;
-	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+	// Enable progress notifications. If the caller supplies the progress
+	// state, only the amount of (uncompressed) data is reported, and the
+	// caller is responsible for the maximum.
+	unsigned int external = (progress != NULL);
+	dc_event_progress_t local = EVENT_PROGRESS_INITIALIZER;
+	if (!external) {
+		local.maximum = 3 + size + 1;
+		progress = &local;
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+	}
 
 	// Transfer the init request.
 	rc = shearwater_common_transfer (device, req_init, sizeof (req_init), response, 3, &n);
@@ -388,8 +431,10 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	}
 
 	// Update and emit a progress event.
-	progress.current += 3;
-	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+	if (!external) {
+		progress->current += 3;
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+	}
 
 	unsigned int done = 0;
 	unsigned char block = 1;
@@ -408,16 +453,15 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 			return DC_STATUS_PROTOCOL;
 		}
 
-		// Verify the block length.
+		// Verify the block length. For compressed transfers, the size
+		// refers to the uncompressed data, and is verified afterwards.
 		unsigned int length = n - 2;
-		if (nbytes + length > size) {
+		if (!compression && nbytes + length > size) {
 			ERROR (abstract->context, "Unexpected packet size.");
 			return DC_STATUS_PROTOCOL;
 		}
 
-		// Update and emit a progress event.
-		progress.current += length;
-		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+		unsigned int previous = dc_buffer_get_size (buffer);
 
 		if (compression) {
 			if (shearwater_common_decompress_lre (response + 2, length, buffer, &done) != 0) {
@@ -431,7 +475,25 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 			}
 		}
 
-		nbytes += length;
+		// Update and emit a progress event.
+		if (external) {
+			progress->current += dc_buffer_get_size (buffer) - previous;
+			if (progress->current > progress->maximum)
+				progress->current = progress->maximum;
+		} else {
+			progress->current += length;
+		}
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+
+		if (compression) {
+			nbytes = dc_buffer_get_size (buffer);
+			if (nbytes > size) {
+				ERROR (abstract->context, "Unexpected packet size.");
+				return DC_STATUS_PROTOCOL;
+			}
+		} else {
+			nbytes += length;
+		}
 		block++;
 	}
 
@@ -455,8 +517,10 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	}
 
 	// Update and emit a progress event.
-	progress.current += 1;
-	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+	if (!external) {
+		progress->current += 1;
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+	}
 
 	return DC_STATUS_SUCCESS;
 }
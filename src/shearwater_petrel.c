@@ -29,6 +29,7 @@
 #include "context-private.h"
 #include "device-private.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &shearwater_petrel_device_vtable)
 
@@ -41,6 +42,9 @@
 #define RECORD_SIZE   0x20
 #define RECORD_COUNT  (MANIFEST_SIZE / RECORD_SIZE)
 
+#define EXTENT_DEFAULT 0x4000
+#define EXTENT_MAX     0x40000
+
 typedef struct shearwater_petrel_device_t {
 	shearwater_common_device_t base;
 	unsigned char fingerprint[4];
@@ -149,13 +153,13 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 	shearwater_petrel_device_t *device = (shearwater_petrel_device_t *) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
-	// Allocate memory buffers for the manifests.
-	dc_buffer_t *buffer = dc_buffer_new (MANIFEST_SIZE);
-	dc_buffer_t *manifests = dc_buffer_new (MANIFEST_SIZE);
-	if (buffer == NULL || manifests == NULL) {
+	// Allocate memory buffers for the manifest and the dives.
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, MANIFEST_SIZE);
+	dc_buffer_t *manifest = dc_buffer_allocate (abstract->context, MANIFEST_SIZE);
+	if (buffer == NULL || manifest == NULL) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
+		dc_buffer_free (manifest);
 		return DC_STATUS_NOMEMORY;
 	}
 
@@ -164,7 +168,7 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to read the serial number.");
 		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
+		dc_buffer_free (manifest);
 		return rc;
 	}
 
@@ -174,7 +178,7 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 		serial, sizeof (serial)) != 0 ) {
 		ERROR (abstract->context, "Failed to convert the serial number.");
 		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
+		dc_buffer_free (manifest);
 		return DC_STATUS_DATAFORMAT;
 
 	}
@@ -184,7 +188,7 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to read the firmware version.");
 		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
+		dc_buffer_free (manifest);
 		return rc;
 	}
 
@@ -198,19 +202,57 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 	devinfo.serial = array_uint32_be (serial);
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
-	while (1) {
-		// Download a manifest.
-		rc = shearwater_common_download (&device->base, buffer, MANIFEST_ADDR, MANIFEST_SIZE, 0);
+	// Enable progress notifications. The number of dives is only known
+	// once the last manifest is read, so the maximum grows with each
+	// manifest, by the amount of dive data that needs to be downloaded.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	unsigned char first[RECORD_SIZE] = {0};
+	unsigned int page = 0, skip = 0, rewound = 0;
+	unsigned int previous = 0, nrecords = 0;
+	unsigned int total = 0, nvalid = 0;
+	unsigned int done = 0;
+	while (!done) {
+		// Download the next manifest.
+		rc = shearwater_common_download (&device->base, manifest, MANIFEST_ADDR, MANIFEST_SIZE, 0, NULL);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to download the manifest.");
 			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
+			dc_buffer_free (manifest);
 			return rc;
 		}
 
 		// Cache the buffer pointer and size.
-		unsigned char *data = dc_buffer_get_data (buffer);
-		unsigned int size = dc_buffer_get_size (buffer);
+		unsigned char *data = dc_buffer_get_data (manifest);
+		unsigned int size = dc_buffer_get_size (manifest);
+
+		// Skip the manifests that are already processed.
+		if (skip) {
+			skip--;
+			continue;
+		}
+
+		// The device keeps track of the next manifest, and the dives are
+		// downloaded in between the manifests. If a dive download resets
+		// the manifest cursor, the first manifest is returned again, and
+		// the manifests that are already processed need to be skipped.
+		if (page == 0) {
+			if (size >= RECORD_SIZE)
+				memcpy (first, data, RECORD_SIZE);
+		} else if (size >= RECORD_SIZE && memcmp (data, first, RECORD_SIZE) == 0) {
+			if (rewound) {
+				ERROR (abstract->context, "Unexpected manifest.");
+				dc_buffer_free (buffer);
+				dc_buffer_free (manifest);
+				return DC_STATUS_PROTOCOL;
+			}
+			WARNING (abstract->context, "Manifest cursor reset by the dive download.");
+			skip = page - 1;
+			rewound = 1;
+			continue;
+		}
+		rewound = 0;
 
 		// Process the records in the manifest.
 		unsigned int count = 0;
@@ -229,46 +271,93 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 			count++;
 		}
 
-		// Append the manifest records to the main buffer.
-		if (!dc_buffer_append (manifests, data, count * RECORD_SIZE)) {
-			ERROR (abstract->context, "Insufficient buffer space available.");
-			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
-			return DC_STATUS_NOMEMORY;
+		// Calculate the size of each dive from the addresses in the manifest.
+		// The dives are stored sequentially, and the manifest records are
+		// ordered from the most recent to the oldest dive. Thus the size of a
+		// dive is the distance to the start of the next (more recent) dive.
+		// The size of the most recent dive, and of the dives where the
+		// addresses wrap around, is unknown.
+		unsigned int extents[RECORD_COUNT];
+		for (unsigned int i = 0; i < count; ++i) {
+			unsigned int address = array_uint32_be (data + i * RECORD_SIZE + 20);
+			extents[i] = 0;
+			if (nrecords && previous > address && previous - address <= EXTENT_MAX) {
+				extents[i] = previous - address;
+				total += extents[i];
+				nvalid++;
+			}
+			previous = address;
+			nrecords++;
 		}
 
-		// Stop downloading manifest if there are no more records.
-		if (count != RECORD_COUNT)
-			break;
-	}
-
-	// Cache the buffer pointer and size.
-	unsigned char *data = dc_buffer_get_data (manifests);
-	unsigned int size = dc_buffer_get_size (manifests);
-
-	unsigned int offset = 0;
-	while (offset < size) {
-		// Get the address of the dive.
-		unsigned int address = array_uint32_be (data + offset + 20);
-
-		// Download the dive.
-		rc = shearwater_common_download (&device->base, buffer, DIVE_ADDR + address, DIVE_SIZE, 1);
-		if (rc != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to download the dive.");
-			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
-			return rc;
+		// Update and emit a progress event. The average size is used for
+		// the dives with an unknown size.
+		unsigned int average = nvalid ? total / nvalid : EXTENT_DEFAULT;
+		for (unsigned int i = 0; i < count; ++i) {
+			if (!device_fingerprint_known (abstract, data + i * RECORD_SIZE + 4, sizeof (device->fingerprint)))
+				progress.maximum += (extents[i] ? extents[i] : average);
+		}
+		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			unsigned int offset = i * RECORD_SIZE;
+
+			// Skip dives that are already known.
+			if (device_fingerprint_known (abstract, data + offset + 4, sizeof (device->fingerprint)))
+				continue;
+
+			// Get the address of the dive.
+			unsigned int address = array_uint32_be (data + offset + 20);
+
+			// Only request the size of the dive if it's known. Otherwise the
+			// maximum size is requested, and the device ends the transfer
+			// at the end of the dive.
+			unsigned int length = (extents[i] ? extents[i] : DIVE_SIZE);
+			unsigned int estimate = (extents[i] ? extents[i] : average);
+
+			// Preallocate the buffer for the dive.
+			dc_buffer_reserve (buffer, estimate);
+
+			// Download the dive.
+			unsigned int begin = progress.current;
+			rc = shearwater_common_download (&device->base, buffer, DIVE_ADDR + address, length, 1, &progress);
+			if (rc != DC_STATUS_SUCCESS) {
+				ERROR (abstract->context, "Failed to download the dive.");
+				dc_buffer_free (buffer);
+				dc_buffer_free (manifest);
+				return rc;
+			}
+
+			// Update and emit a progress event. The actual size of the dive
+			// may differ from the estimate, so the progress is synchronized
+			// with the end of the dive.
+			if (progress.current < begin + estimate)
+				progress.current = begin + estimate;
+			if (progress.current > progress.maximum)
+				progress.current = progress.maximum;
+			device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+			// The next download replaces the contents of the buffer, so a
+			// view on the dive keeps the current contents.
+			const unsigned char *buf = dc_buffer_get_const_data (buffer);
+			unsigned int len = dc_buffer_get_size (buffer);
+			device_dives_set (abstract, buffer);
+			int proceed = !callback || callback (buf, len, buf + 12, sizeof (device->fingerprint), userdata);
+			device_dives_set (abstract, NULL);
+			if (!proceed) {
+				done = 1;
+				break;
+			}
 		}
 
-		unsigned char *buf = dc_buffer_get_data (buffer);
-		unsigned int len = dc_buffer_get_size (buffer);
-		if (callback && !callback (buf, len, buf + 12, sizeof (device->fingerprint), userdata))
+		// Stop downloading manifests if there are no more records.
+		if (count != RECORD_COUNT)
 			break;
 
-		offset += RECORD_SIZE;
+		page++;
 	}
 
-	dc_buffer_free (manifests);
+	dc_buffer_free (manifest);
 	dc_buffer_free (buffer);
 
 	return rc;
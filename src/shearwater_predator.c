@@ -29,6 +29,7 @@
 #include "context-private.h"
 #include "device-private.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &shearwater_predator_device_vtable)
 
@@ -135,14 +136,14 @@ shearwater_predator_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return DC_STATUS_NOMEMORY;
 	}
 
-	return shearwater_common_download (device, buffer, 0xDD000000, SZ_MEMORY, 0);
+	return shearwater_common_download (device, buffer, 0xDD000000, SZ_MEMORY, 0, NULL);
 }
 
 
 static dc_status_t
 shearwater_predator_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -233,7 +234,7 @@ shearwater_predator_extract_predator (dc_device_t *abstract, const unsigned char
 	}
 
 	// Allocate memory for the profiles.
-	unsigned char *buffer = (unsigned char *) malloc (RB_PROFILE_END - RB_PROFILE_BEGIN + SZ_BLOCK);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (context, RB_PROFILE_END - RB_PROFILE_BEGIN + SZ_BLOCK);
 	if (buffer == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
@@ -271,7 +272,7 @@ shearwater_predator_extract_predator (dc_device_t *abstract, const unsigned char
 		}
 	}
 
-	free (buffer);
+	dc_context_dealloc (context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -284,7 +285,7 @@ shearwater_predator_extract_petrel (dc_device_t *abstract, const unsigned char d
 	dc_context_t *context = (abstract ? abstract->context : NULL);
 
 	// Allocate memory for the profiles.
-	unsigned char *buffer = (unsigned char *) malloc (RB_PROFILE_END - RB_PROFILE_BEGIN + SZ_BLOCK);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc (context, RB_PROFILE_END - RB_PROFILE_BEGIN + SZ_BLOCK);
 	if (buffer == NULL) {
 		return DC_STATUS_NOMEMORY;
 	}
@@ -310,7 +311,7 @@ shearwater_predator_extract_petrel (dc_device_t *abstract, const unsigned char d
 			// The dive number in the header and footer should be identical.
 			if (memcmp (data + header + 2, data + offset + 2, 2) != 0) {
 				ERROR (context, "Unexpected dive number.");
-				free (buffer);
+				dc_context_dealloc (context, buffer);
 				return DC_STATUS_DATAFORMAT;
 			}
 
@@ -333,7 +334,7 @@ shearwater_predator_extract_petrel (dc_device_t *abstract, const unsigned char d
 		offset += SZ_BLOCK;
 	}
 
-	free (buffer);
+	dc_context_dealloc (context, buffer);
 
 	return DC_STATUS_SUCCESS;
 }
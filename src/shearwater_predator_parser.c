@@ -34,6 +34,8 @@
 #include "context-private.h"
 #include "parser-private.h"
 #include "array.h"
+#include "record.h"
+#include "blank.h"
 
 #define ISINSTANCE(parser)	( \
 	dc_parser_isinstance((parser), &shearwater_predator_parser_vtable) || \
@@ -54,8 +56,43 @@
 
 #define NGASMIXES 10
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 typedef struct shearwater_predator_parser_t shearwater_predator_parser_t;
 
+typedef struct shearwater_predator_sample_t {
+	int depth;
+	int decostop;
+	int ppo2;
+	int o2;
+	int he;
+	int decotime;
+	int status;
+	int temperature;
+	int setpoint;
+	int cns;
+} shearwater_predator_sample_t;
+
+#define FIELD(name,offset,width,flags,scale) \
+	RECORD_FIELD(shearwater_predator_sample_t, name, offset, width, flags, scale)
+
+static const record_field_t shearwater_predator_sample_layout[] = {
+	FIELD (depth,        0, 2, RECORD_BE,     1),
+	FIELD (decostop,     2, 2, RECORD_BE,     1),
+	FIELD (ppo2,         6, 1, 0,             1),
+	FIELD (o2,           7, 1, 0,             1),
+	FIELD (he,           8, 1, 0,             1),
+	FIELD (decotime,     9, 1, 0,            60),
+	FIELD (status,      11, 1, 0,             1),
+	FIELD (temperature, 13, 1, RECORD_SIGNED, 1),
+	// Petrel only.
+	FIELD (setpoint,    18, 1, 0,             1),
+	FIELD (cns,         22, 1, 0,             1),
+};
+
+#define NFIELDS_PREDATOR 8
+#define NFIELDS_PETREL   C_ARRAY_SIZE(shearwater_predator_sample_layout)
+
 struct shearwater_predator_parser_t {
 	dc_parser_t base;
 	unsigned int petrel;
@@ -69,12 +106,15 @@ struct shearwater_predator_parser_t {
 	unsigned int helium[NGASMIXES];
 	unsigned int serial;
 	dc_divemode_t mode;
+	blank_index_t *blank;
 };
 
 static dc_status_t shearwater_predator_parser_set_data (dc_parser_t *abstract, const unsigned char *data, unsigned int size);
 static dc_status_t shearwater_predator_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t shearwater_predator_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t shearwater_predator_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t shearwater_predator_parser_destroy (dc_parser_t *abstract);
 
 static const dc_parser_vtable_t shearwater_predator_parser_vtable = {
 	sizeof(shearwater_predator_parser_t),
@@ -83,7 +123,9 @@ static const dc_parser_vtable_t shearwater_predator_parser_vtable = {
 	shearwater_predator_parser_get_datetime, /* datetime */
 	shearwater_predator_parser_get_field, /* fields */
 	shearwater_predator_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	shearwater_predator_parser_destroy, /* destroy */
+	NULL, /* samples_iterator */
+	shearwater_predator_parser_samples_foreach_fixed /* samples_foreach_fixed */
 };
 
 static const dc_parser_vtable_t shearwater_petrel_parser_vtable = {
@@ -93,7 +135,9 @@ static const dc_parser_vtable_t shearwater_petrel_parser_vtable = {
 	shearwater_predator_parser_get_datetime, /* datetime */
 	shearwater_predator_parser_get_field, /* fields */
 	shearwater_predator_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	shearwater_predator_parser_destroy, /* destroy */
+	NULL, /* samples_iterator */
+	shearwater_predator_parser_samples_foreach_fixed /* samples_foreach_fixed */
 };
 
 
@@ -155,6 +199,7 @@ shearwater_common_parser_create (dc_parser_t **out, dc_context_t *context, unsig
 		parser->helium[i] = 0;
 	}
 	parser->mode = DC_DIVEMODE_OC;
+	parser->blank = NULL;
 
 	*out = (dc_parser_t *) parser;
 
@@ -191,6 +236,19 @@ shearwater_predator_parser_set_data (dc_parser_t *abstract, const unsigned char
 		parser->helium[i] = 0;
 	}
 	parser->mode = DC_DIVEMODE_OC;
+	blank_index_free (parser->blank);
+	parser->blank = NULL;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+shearwater_predator_parser_destroy (dc_parser_t *abstract)
+{
+	shearwater_predator_parser_t *parser = (shearwater_predator_parser_t *) abstract;
+
+	blank_index_free (parser->blank);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -252,12 +310,19 @@ shearwater_predator_parser_cache (shearwater_predator_parser_t *parser)
 	unsigned int helium[NGASMIXES] = {0};
 	unsigned int o2_previous = 0, he_previous = 0;
 
+	// Index the empty samples.
+	blank_index_t *blank = blank_index_new (abstract->context, data + headersize, size - headersize, parser->samplesize, BLANK_00);
+	if (blank == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
 	unsigned int offset = headersize;
 	unsigned int length = size - footersize;
 	while (offset < length) {
 		// Ignore empty samples.
-		if (array_isequal (data + offset, parser->samplesize, 0x00)) {
-			offset += parser->samplesize;
+		if (blank_index_isblank (blank, offset - headersize)) {
+			offset = headersize + blank_index_next (blank, offset - headersize);
 			continue;
 		}
 
@@ -283,6 +348,7 @@ shearwater_predator_parser_cache (shearwater_predator_parser_t *parser)
 			if (idx >= ngasmixes) {
 				if (idx >= NGASMIXES) {
 					ERROR (abstract->context, "Maximum number of gas mixes reached.");
+					blank_index_free (blank);
 					return DC_STATUS_NOMEMORY;
 				}
 				oxygen[idx] = o2;
@@ -306,6 +372,7 @@ shearwater_predator_parser_cache (shearwater_predator_parser_t *parser)
 		parser->helium[i] = helium[i];
 	}
 	parser->mode = mode;
+	parser->blank = blank;
 	parser->cached = 1;
 
 	return DC_STATUS_SUCCESS;
@@ -430,7 +497,7 @@ shearwater_predator_parser_get_field (dc_parser_t *abstract, dc_field_type_t typ
 
 
 static dc_status_t
-shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+shearwater_predator_parser_samples (dc_parser_t *abstract, unsigned int fixed, dc_sample_callback_t callback, void *userdata)
 {
 	shearwater_predator_parser_t *parser = (shearwater_predator_parser_t *) abstract;
 
@@ -455,26 +522,42 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 		dc_sample_value_t sample = {0};
 
 		// Ignore empty samples.
-		if (array_isequal (data + offset, parser->samplesize, 0x00)) {
-			offset += parser->samplesize;
+		if (blank_index_isblank (parser->blank, offset - parser->headersize)) {
+			offset = parser->headersize + blank_index_next (parser->blank, offset - parser->headersize);
 			continue;
 		}
 
+		// Decode the sample record.
+		shearwater_predator_sample_t record = {0};
+		if (!record_decode (shearwater_predator_sample_layout,
+			parser->petrel ? NFIELDS_PETREL : NFIELDS_PREDATOR,
+			data + offset, length - offset, &record)) {
+			ERROR (abstract->context, "Buffer overflow detected!");
+			return DC_STATUS_DATAFORMAT;
+		}
+
 		// Time (seconds).
 		time += 10;
 		sample.time = time;
 		if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 		// Depth (1/10 m or ft).
-		unsigned int depth = array_uint16_be (data + offset);
-		if (units == IMPERIAL)
-			sample.depth = depth * FEET / 10.0;
-		else
-			sample.depth = depth / 10.0;
+		unsigned int depth = record.depth;
+		if (fixed) {
+			if (units == IMPERIAL)
+				sample.fixed.depth = dc_fixed_scale (depth, 762, 25);
+			else
+				sample.fixed.depth = depth * 100;
+		} else {
+			if (units == IMPERIAL)
+				sample.depth = depth * FEET / 10.0;
+			else
+				sample.depth = depth / 10.0;
+		}
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Temperature (°C or °F).
-		int temperature = (signed char) data[offset + 13];
+		int temperature = record.temperature;
 		if (temperature < 0) {
 			// Fix negative temperatures.
 			temperature += 102;
@@ -482,42 +565,60 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 				temperature = 0;
 			}
 		}
-		if (units == IMPERIAL)
-			sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
-		else
-			sample.temperature = temperature;
+		if (fixed) {
+			if (units == IMPERIAL)
+				sample.fixed.temperature = dc_fixed_scale (temperature - 32, 5000, 9);
+			else
+				sample.fixed.temperature = temperature * 1000;
+		} else {
+			if (units == IMPERIAL)
+				sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+			else
+				sample.temperature = temperature;
+		}
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		// Status flags.
-		unsigned int status = data[offset + 11];
+		unsigned int status = record.status;
 
 		if ((status & OC) == 0) {
 			// PPO2 -- only return PPO2 if we are in closed circuit mode
-			sample.ppo2 = data[offset + 6] / 100.0;
+			if (fixed)
+				sample.fixed.ppo2 = record.ppo2 * 10;
+			else
+				sample.ppo2 = record.ppo2 / 100.0;
 			if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
 
 			// Setpoint
+			unsigned int setpoint = 0;
 			if (parser->petrel) {
-				sample.setpoint = data[offset + 18] / 100.0;
+				setpoint = record.setpoint;
 			} else {
 				if (status & SETPOINT_HIGH) {
-					sample.setpoint = data[18] / 100.0;
+					setpoint = data[18];
 				} else {
-					sample.setpoint = data[17] / 100.0;
+					setpoint = data[17];
 				}
 			}
+			if (fixed)
+				sample.fixed.setpoint = setpoint * 10;
+			else
+				sample.setpoint = setpoint / 100.0;
 			if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 		}
 
 		// CNS
 		if (parser->petrel) {
-			sample.cns = data[offset + 22] / 100.0;
+			if (fixed)
+				sample.fixed.cns = record.cns * 10;
+			else
+				sample.cns = record.cns / 100.0;
 			if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
 		}
 
 		// Gaschange.
-		unsigned int o2 = data[offset + 7];
-		unsigned int he = data[offset + 8];
+		unsigned int o2 = record.o2;
+		unsigned int he = record.he;
 		if (o2 != o2_previous || he != he_previous) {
 			unsigned int idx = shearwater_predator_find_gasmix (parser, o2, he);
 			if (idx >= parser->ngasmixes) {
@@ -532,18 +633,23 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 		}
 
 		// Deco stop / NDL.
-		unsigned int decostop = array_uint16_be (data + offset + 2);
-		if (decostop) {
-			sample.deco.type = DC_DECO_DECOSTOP;
+		unsigned int decostop = record.decostop;
+		unsigned int decotype = decostop ? DC_DECO_DECOSTOP : DC_DECO_NDL;
+		if (fixed) {
+			sample.fixed.deco.type = decotype;
+			if (units == IMPERIAL)
+				sample.fixed.deco.depth = dc_fixed_scale (decostop, 1524, 5);
+			else
+				sample.fixed.deco.depth = decostop * 1000;
+			sample.fixed.deco.time = record.decotime;
+		} else {
+			sample.deco.type = decotype;
 			if (units == IMPERIAL)
 				sample.deco.depth = decostop * FEET;
 			else
 				sample.deco.depth = decostop;
-		} else {
-			sample.deco.type = DC_DECO_NDL;
-			sample.deco.depth = 0.0;
+			sample.deco.time = record.decotime;
 		}
-		sample.deco.time = data[offset + 9] * 60;
 		if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 
 		offset += parser->samplesize;
@@ -551,3 +657,17 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return shearwater_predator_parser_samples (abstract, 0, callback, userdata);
+}
+
+
+static dc_status_t
+shearwater_predator_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return shearwater_predator_parser_samples (abstract, 1, callback, userdata);
+}
@@ -24,6 +24,7 @@
 #include <assert.h> // assert
 
 #include "suunto_common.h"
+#include "context-private.h"
 #include "ringbuffer.h"
 #include "array.h"
 
@@ -89,7 +90,7 @@ suunto_common_extract_dives (suunto_common_device_t *device, const suunto_common
 
 	// Memory buffer for the profile ringbuffer.
 	unsigned int length = layout->rb_profile_end - layout->rb_profile_begin;
-	unsigned char *buffer = (unsigned char *) malloc (length);
+	unsigned char *buffer = (unsigned char *) dc_context_alloc ((device ? device->base.context : NULL), length);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -120,12 +121,12 @@ suunto_common_extract_dives (suunto_common_device_t *device, const suunto_common
 			}
 
 			if (device && memcmp (buffer + layout->fp_offset, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-				free (buffer);
+				dc_context_dealloc ((device ? device->base.context : NULL), buffer);
 				return DC_STATUS_SUCCESS;
 			}
 
 			if (callback && !callback (buffer, len, buffer + layout->fp_offset, sizeof (device->fingerprint), userdata)) {
-				free (buffer);
+				dc_context_dealloc ((device ? device->base.context : NULL), buffer);
 				return DC_STATUS_SUCCESS;
 			}
 
@@ -133,7 +134,7 @@ suunto_common_extract_dives (suunto_common_device_t *device, const suunto_common
 		}
 	}
 
-	free (buffer);
+	dc_context_dealloc ((device ? device->base.context : NULL), buffer);
 
 	if (data[current] != 0x82)
 		return DC_STATUS_DATAFORMAT;
@@ -98,17 +98,24 @@ suunto_common2_device_set_fingerprint (dc_device_t *abstract, const unsigned cha
 }
 
 
-dc_status_t
-suunto_common2_device_version (dc_device_t *abstract, unsigned char data[], unsigned int size)
+static dc_status_t
+suunto_common2_version (dc_device_t *abstract, unsigned char data[], unsigned int size, unsigned int retry)
 {
 	if (size < SZ_VERSION) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_INVALIDARGS;
 	}
 
+	if (VTABLE (abstract)->packet == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
 	unsigned char answer[SZ_VERSION + 4] = {0};
 	unsigned char command[4] = {0x0F, 0x00, 0x00, 0x0F};
-	dc_status_t rc = suunto_common2_transfer (abstract, command, sizeof (command), answer, sizeof (answer), 4);
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	if (retry)
+		rc = suunto_common2_transfer (abstract, command, sizeof (command), answer, sizeof (answer), 4);
+	else
+		rc = VTABLE (abstract)->packet (abstract, command, sizeof (command), answer, sizeof (answer), 4);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 
@@ -118,6 +125,20 @@ suunto_common2_device_version (dc_device_t *abstract, unsigned char data[], unsi
 }
 
 
+dc_status_t
+suunto_common2_device_version (dc_device_t *abstract, unsigned char data[], unsigned int size)
+{
+	return suunto_common2_version (abstract, data, size, 1);
+}
+
+
+dc_status_t
+suunto_common2_device_probe (dc_device_t *abstract, unsigned char data[], unsigned int size)
+{
+	return suunto_common2_version (abstract, data, size, 0);
+}
+
+
 dc_status_t
 suunto_common2_device_reset_maxdepth (dc_device_t *abstract)
 {
@@ -296,7 +317,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 
 	// Memory buffer to store all the dives.
 
-	unsigned char *data = (unsigned char *) malloc (layout->rb_profile_end - layout->rb_profile_begin + SZ_MINIMUM);
+	unsigned char *data = (unsigned char *) dc_context_alloc (abstract->context, layout->rb_profile_end - layout->rb_profile_begin + SZ_MINIMUM);
 	if (data == NULL) {
 		ERROR (abstract->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -333,7 +354,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 
 		if (size < 4 || size > remaining) {
 			ERROR (abstract->context, "Unexpected profile size (%u %u).", size, remaining);
-			free (data);
+			dc_context_dealloc (abstract->context, data);
 			return DC_STATUS_DATAFORMAT;
 		}
 
@@ -370,7 +391,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 			rc = suunto_common2_device_read (abstract, address - extra, data + offset - extra, len + extra);
 			if (rc != DC_STATUS_SUCCESS) {
 				ERROR (abstract->context, "Failed to read the memory.");
-				free (data);
+				dc_context_dealloc (abstract->context, data);
 				return rc;
 			}
 
@@ -398,24 +419,24 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 			next >= layout->rb_profile_end)
 		{
 			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%04x 0x%04x).", prev, next);
-			free (data);
+			dc_context_dealloc (abstract->context, data);
 			return DC_STATUS_DATAFORMAT;
 		}
 		if (next != previous && next != current) {
 			ERROR (abstract->context, "Profiles are not continuous (0x%04x 0x%04x 0x%04x).", current, next, previous);
-			free (data);
+			dc_context_dealloc (abstract->context, data);
 			return DC_STATUS_DATAFORMAT;
 		}
 
 		if (next != current) {
 			unsigned int fp_offset = layout->fingerprint + 4;
 			if (memcmp (p + fp_offset, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-				free (data);
+				dc_context_dealloc (abstract->context, data);
 				return DC_STATUS_SUCCESS;
 			}
 
 			if (callback && !callback (p + 4, size - 4, p + fp_offset, sizeof (device->fingerprint), userdata)) {
-				free (data);
+				dc_context_dealloc (abstract->context, data);
 				return DC_STATUS_SUCCESS;
 			}
 		} else {
@@ -428,7 +449,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 		current = prev;
 	}
 
-	free (data);
+	dc_context_dealloc (abstract->context, data);
 
 	return status;
 }
@@ -61,6 +61,13 @@ suunto_common2_device_set_fingerprint (dc_device_t *device, const unsigned char
 dc_status_t
 suunto_common2_device_version (dc_device_t *device, unsigned char data[], unsigned int size);
 
+/*
+ * Read the version info once, without the automatic retries. Used to
+ * probe the link settings.
+ */
+dc_status_t
+suunto_common2_device_probe (dc_device_t *device, unsigned char data[], unsigned int size);
+
 dc_status_t
 suunto_common2_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size);
 
@@ -45,6 +45,8 @@
 typedef struct suunto_d9_device_t {
 	suunto_common2_device_t base;
 	dc_serial_t *port;
+	unsigned int baudrate;
+	char name[64];
 } suunto_d9_device_t;
 
 static dc_status_t suunto_d9_device_packet (dc_device_t *abstract, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size);
@@ -90,13 +92,43 @@ static const suunto_common2_layout_t suunto_dx_layout = {
 
 
 static dc_status_t
-suunto_d9_device_autodetect (suunto_d9_device_t *device, unsigned int model)
+suunto_d9_device_probe (suunto_d9_device_t *device, unsigned int baudrate, unsigned int quick)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_device_t *abstract = (dc_device_t *) device;
+
+	// Adjust the baudrate.
+	status = dc_serial_configure (device->port, baudrate, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to set the terminal attributes.");
+		return status;
+	}
+
+	if (!quick) {
+		// Try reading the version info.
+		return suunto_common2_device_version (abstract, device->base.version, sizeof (device->base.version));
+	}
+
+	// Try reading the version info once, without any retries.
+	status = suunto_common2_device_probe (abstract, device->base.version, sizeof (device->base.version));
+	if (status != DC_STATUS_SUCCESS) {
+		// Discard any garbage bytes.
+		dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+		return status;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+suunto_d9_device_autodetect (suunto_d9_device_t *device, const char *name, unsigned int model)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
 
 	// The list with possible baudrates.
-	const int baudrates[] = {9600, 115200};
+	unsigned int baudrates[] = {9600, 115200};
 
 	// Use the model number as a hint to speedup the detection.
 	unsigned int hint = 0;
@@ -104,24 +136,53 @@ suunto_d9_device_autodetect (suunto_d9_device_t *device, unsigned int model)
 		model == DX || model == VYPERNOVO || model == ZOOPNOVO)
 		hint = 1;
 
+	// Prefer the baudrate that worked the last time on this interface. The
+	// device is not identified yet, so that is the most recent device.
+	unsigned int cached = dc_context_get_baudrate (abstract->context, DC_FAMILY_SUUNTO_D9, name, 0);
 	for (unsigned int i = 0; i < C_ARRAY_SIZE(baudrates); ++i) {
-		// Use the baudrate array as circular array, starting from the hint.
-		unsigned int idx = (hint + i) % C_ARRAY_SIZE(baudrates);
+		if (baudrates[i] == cached)
+			hint = i;
+	}
 
-		// Adjust the baudrate.
-		status = dc_serial_configure (device->port, baudrates[idx], 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
+	// The first pass probes every baudrate once with a short timeout. Only
+	// if that fails, the second pass uses the regular timeout and retries.
+	unsigned int baudrate = 0;
+	for (unsigned int pass = 0; pass < 2 && baudrate == 0; ++pass) {
+		status = dc_serial_set_timeout (device->port, pass ? 3000 : 500);
 		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to set the terminal attributes.");
+			ERROR (abstract->context, "Failed to set the timeout.");
 			return status;
 		}
 
-		// Try reading the version info.
-		status = suunto_common2_device_version ((dc_device_t *) device, device->base.version, sizeof (device->base.version));
-		if (status == DC_STATUS_SUCCESS)
-			break;
+		for (unsigned int i = 0; i < C_ARRAY_SIZE(baudrates); ++i) {
+			// Use the baudrate array as circular array, starting from the hint.
+			unsigned int idx = (hint + i) % C_ARRAY_SIZE(baudrates);
+
+			status = suunto_d9_device_probe (device, baudrates[idx], pass == 0);
+			if (status == DC_STATUS_SUCCESS) {
+				baudrate = baudrates[idx];
+				break;
+			}
+
+			if (status != DC_STATUS_TIMEOUT && status != DC_STATUS_PROTOCOL)
+				return status;
+		}
 	}
 
-	return status;
+	if (baudrate == 0)
+		return status;
+
+	// Restore the regular timeout.
+	status = dc_serial_set_timeout (device->port, 3000);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to set the timeout.");
+		return status;
+	}
+
+	INFO (abstract->context, "Negotiated baudrate: %u", baudrate);
+	device->baudrate = baudrate;
+
+	return DC_STATUS_SUCCESS;
 }
 
 
@@ -146,6 +207,10 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 
 	// Set the default values.
 	device->port = NULL;
+	device->baudrate = 0;
+	memset (device->name, 0, sizeof (device->name));
+	if (name && strlen (name) < sizeof (device->name))
+		strcpy (device->name, name);
 
 	// Open the device.
 	status = dc_serial_open (&device->port, context, name);
@@ -168,6 +233,9 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line (power supply for the interface).
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -182,7 +250,7 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 	dc_serial_purge (device->port, DC_DIRECTION_ALL);
 
 	// Try to autodetect the protocol variant.
-	status = suunto_d9_device_autodetect (device, model);
+	status = suunto_d9_device_autodetect (device, name, model);
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to identify the protocol variant.");
 		goto error_close;
@@ -217,6 +285,13 @@ suunto_d9_device_close (dc_device_t *abstract)
 	suunto_d9_device_t *device = (suunto_d9_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	// Remember the negotiated baudrate for the next connection. The
+	// serial number is known once the device info has been read.
+	if (device->baudrate && device->name[0]) {
+		dc_context_set_baudrate (abstract->context, DC_FAMILY_SUUNTO_D9,
+			device->name, abstract->devinfo.serial, device->baudrate);
+	}
+
 	// Close the device.
 	rc = dc_serial_close (device->port);
 	if (rc != DC_STATUS_SUCCESS) {
@@ -311,6 +386,20 @@ suunto_d9_device_version (dc_device_t *abstract, unsigned char data[], unsigned
 }
 
 
+dc_status_t
+suunto_d9_device_get_baudrate (dc_device_t *abstract, unsigned int *baudrate)
+{
+	suunto_d9_device_t *device = (suunto_d9_device_t *) abstract;
+
+	if (!ISINSTANCE (abstract) || baudrate == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*baudrate = device->baudrate;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 suunto_d9_device_reset_maxdepth (dc_device_t *abstract)
 {
@@ -95,6 +95,7 @@ static dc_status_t suunto_d9_parser_set_data (dc_parser_t *abstract, const unsig
 static dc_status_t suunto_d9_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t suunto_d9_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t suunto_d9_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
 static const dc_parser_vtable_t suunto_d9_parser_vtable = {
 	sizeof(suunto_d9_parser_t),
@@ -103,7 +104,9 @@ static const dc_parser_vtable_t suunto_d9_parser_vtable = {
 	suunto_d9_parser_get_datetime, /* datetime */
 	suunto_d9_parser_get_field, /* fields */
 	suunto_d9_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_iterator */
+	suunto_d9_parser_samples_foreach_fixed /* samples_foreach_fixed */
 };
 
 static unsigned int
@@ -412,7 +415,7 @@ suunto_d9_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigne
 
 
 static dc_status_t
-suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+suunto_d9_parser_samples (dc_parser_t *abstract, unsigned int fixed, dc_sample_callback_t callback, void *userdata)
 {
 	suunto_d9_parser_t *parser = (suunto_d9_parser_t*) abstract;
 
@@ -511,19 +514,30 @@ suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t ca
 				switch (info[i].type) {
 				case 0x64: // Depth
 					value = array_uint16_le (data + offset);
-					sample.depth = value / (double) info[i].divisor;
+					if (fixed)
+						sample.fixed.depth = dc_fixed_scale (value, 1000, info[i].divisor);
+					else
+						sample.depth = value / (double) info[i].divisor;
 					if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 					break;
 				case 0x68: // Pressure
 					value = array_uint16_le (data + offset);
 					if (value != 0xFFFF) {
-						sample.pressure.tank = 0;
-						sample.pressure.value = value / (double) info[i].divisor;
+						if (fixed) {
+							sample.fixed.pressure.tank = 0;
+							sample.fixed.pressure.value = dc_fixed_scale (value, 1000, info[i].divisor);
+						} else {
+							sample.pressure.tank = 0;
+							sample.pressure.value = value / (double) info[i].divisor;
+						}
 						if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 					}
 					break;
 				case 0x74: // Temperature
-					sample.temperature = (signed char) data[offset] / (double) info[i].divisor;
+					if (fixed)
+						sample.fixed.temperature = dc_fixed_scale ((signed char) data[offset], 1000, info[i].divisor);
+					else
+						sample.temperature = (signed char) data[offset] / (double) info[i].divisor;
 					if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 					break;
 				default: // Unknown sample type
@@ -763,17 +777,23 @@ suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t ca
 			}
 		}
 
+		unsigned int decotype = DC_DECO_NDL;
 		if (in_deco & DEEPSTOP) {
-			sample.deco.type = DC_DECO_DEEPSTOP;
+			decotype = DC_DECO_DEEPSTOP;
 		} else if (in_deco & DECOSTOP) {
-			sample.deco.type = DC_DECO_DECOSTOP;
+			decotype = DC_DECO_DECOSTOP;
 		} else if (in_deco & SAFETYSTOP) {
-			sample.deco.type = DC_DECO_SAFETYSTOP;
+			decotype = DC_DECO_SAFETYSTOP;
+		}
+		if (fixed) {
+			sample.fixed.deco.type = decotype;
+			sample.fixed.deco.time = 0;
+			sample.fixed.deco.depth = 0;
 		} else {
-			sample.deco.type = DC_DECO_NDL;
+			sample.deco.type = decotype;
+			sample.deco.time = 0;
+			sample.deco.depth = 0.0;
 		}
-		sample.deco.time = 0;
-		sample.deco.depth = 0.0;
 		if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 
 		time += interval_sample;
@@ -782,3 +802,17 @@ suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t ca
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return suunto_d9_parser_samples (abstract, 0, callback, userdata);
+}
+
+
+static dc_status_t
+suunto_d9_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return suunto_d9_parser_samples (abstract, 1, callback, userdata);
+}
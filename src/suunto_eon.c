@@ -30,6 +30,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &suunto_eon_device_vtable)
 
@@ -107,6 +108,9 @@ suunto_eon_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Clear the RTS line.
 	status = dc_serial_set_rts (device->port, 0);
 	if (status != DC_STATUS_SUCCESS) {
@@ -176,28 +180,24 @@ suunto_eon_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		// Set the minimum packet size.
 		unsigned int len = 64;
 
-		// Increase the packet size if more data is immediately available.
-		size_t available = 0;
-		status = dc_serial_get_available (device->port, &available);
-		if (status == DC_STATUS_SUCCESS && available > len)
-			len = available;
-
 		// Limit the packet size to the total size.
 		if (nbytes + len > sizeof(answer))
 			len = sizeof(answer) - nbytes;
 
-		// Read the packet.
-		status = dc_serial_read (device->port, answer + nbytes, len, NULL);
+		// Read the packet, including any additional data that is
+		// immediately available.
+		size_t n = 0;
+		status = dc_serial_read_some (device->port, answer + nbytes, len, sizeof(answer) - nbytes, &n);
 		if (status != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return status;
 		}
 
 		// Update and emit a progress event.
-		progress.current += len;
+		progress.current += n;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-		nbytes += len;
+		nbytes += n;
 	}
 
 	// Verify the checksum of the package.
@@ -217,7 +217,7 @@ suunto_eon_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 suunto_eon_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
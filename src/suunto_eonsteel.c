@@ -28,6 +28,7 @@
 #include "context-private.h"
 #include "device-private.h"
 #include "array.h"
+#include "buffer-private.h"
 #include "usbhid.h"
 
 #ifdef _MSC_VER
@@ -87,11 +88,11 @@ static const dc_device_vtable_t suunto_eonsteel_device_vtable = {
 
 static const char dive_directory[] = "0:/dives";
 
-static struct directory_entry *alloc_dirent(int type, int len, const char *name)
+static struct directory_entry *alloc_dirent(dc_context_t *context, int type, int len, const char *name)
 {
 	struct directory_entry *res;
 
-	res = (struct directory_entry *) malloc(offsetof(struct directory_entry, name) + len + 1);
+	res = (struct directory_entry *) dc_context_alloc(context, offsetof(struct directory_entry, name) + len + 1);
 	if (res) {
 		res->next = NULL;
 		res->type = type;
@@ -445,7 +446,7 @@ static struct directory_entry *parse_dirent(suunto_eonsteel_device_t *eon, int n
 
 		p += 8 + namelen + 1;
 		len -= 8 + namelen + 1;
-		entry = alloc_dirent(type, namelen, (const char *) name);
+		entry = alloc_dirent(eon->base.context, type, namelen, (const char *) name);
 		if (!entry) {
 			ERROR(eon->base.context, "out of memory");
 			break;
@@ -586,7 +587,7 @@ suunto_eonsteel_device_open(dc_device_t **out, dc_context_t *context, const char
 error_close:
 	dc_usbhid_close(eon->usbhid);
 error_free:
-	free(eon);
+	dc_device_deallocate((dc_device_t *) eon);
 	return status;
 }
 
@@ -643,7 +644,7 @@ suunto_eonsteel_device_foreach(dc_device_t *abstract, dc_dive_callback_t callbac
 		return DC_STATUS_SUCCESS;
 	}
 
-	file = dc_buffer_new(0);
+	file = dc_buffer_allocate (abstract->context, 0);
 	progress.maximum = count;
 	progress.current = 0;
 	device_event_emit(abstract, DC_EVENT_PROGRESS, &progress);
@@ -671,9 +672,18 @@ suunto_eonsteel_device_foreach(dc_device_t *abstract, dc_dive_callback_t callbac
 			if (len >= sizeof(pathname))
 				break;
 
+			// The fingerprint is the timestamp from the filename, so
+			// it can be checked before reading the file.
+			put_le32(time, buf);
+			if (memcmp (buf, eon->fingerprint, sizeof (eon->fingerprint)) == 0) {
+				skip = 1;
+				break;
+			}
+			if (device_fingerprint_known (abstract, buf, sizeof (eon->fingerprint)))
+				break;
+
 			// Reset the membuffer, put the 4-byte length at the head.
 			dc_buffer_clear(file);
-			put_le32(time, buf);
 			dc_buffer_append(file, buf, 4);
 
 			// Then read the filename into the rest of the buffer
@@ -684,18 +694,13 @@ suunto_eonsteel_device_foreach(dc_device_t *abstract, dc_dive_callback_t callbac
 			data = dc_buffer_get_data(file);
 			size = dc_buffer_get_size(file);
 
-			if (memcmp (data, eon->fingerprint, sizeof (eon->fingerprint)) == 0) {
-				skip = 1;
-				break;
-			}
-
 			if (callback && !callback(data, size, data, sizeof(eon->fingerprint), userdata))
 				skip = 1;
 		}
 		progress.current++;
 		device_event_emit(abstract, DC_EVENT_PROGRESS, &progress);
 
-		free(de);
+		dc_context_dealloc(abstract->context, de);
 		de = next;
 	}
 	dc_buffer_free(file);
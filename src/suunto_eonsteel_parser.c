@@ -293,12 +293,12 @@ static int fill_in_desc_details(suunto_eonsteel_parser_t *eon, struct type_desc
 }
 
 static void
-desc_free (struct type_desc desc[], unsigned int count)
+desc_free (dc_context_t *context, struct type_desc desc[], unsigned int count)
 {
 	for (unsigned int i = 0; i < count; ++i) {
-		free((void *)desc[i].desc);
-		free((void *)desc[i].format);
-		free((void *)desc[i].mod);
+		dc_context_dealloc(context, (void *)desc[i].desc);
+		dc_context_dealloc(context, (void *)desc[i].format);
+		dc_context_dealloc(context, (void *)desc[i].mod);
 	}
 }
 
@@ -326,10 +326,10 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			ERROR(eon->base.context, "Unexpected type description: %.*s", len, name);
 			return -1;
 		}
-		p = (char *) malloc(len-4);
+		p = (char *) dc_context_alloc(eon->base.context, len-4);
 		if (!p) {
 			ERROR(eon->base.context, "out of memory");
-			desc_free(&desc, 1);
+			desc_free(eon->base.context, &desc, 1);
 			return -1;
 		}
 		memcpy(p, name+5, len-5);
@@ -349,8 +349,8 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			break;
 		default:
 			ERROR(eon->base.context, "Unknown type descriptor: %.*s", len, name);
-			desc_free(&desc, 1);
-			free(p);
+			desc_free(eon->base.context, &desc, 1);
+			dc_context_dealloc(eon->base.context, p);
 			return -1;
 		}
 	} while ((name = next) != NULL);
@@ -361,13 +361,13 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			desc.desc ? desc.desc : "",
 			desc.format ? desc.format : "",
 			desc.mod ? desc.mod : "");
-		desc_free(&desc, 1);
+		desc_free(eon->base.context, &desc, 1);
 		return -1;
 	}
 
 	fill_in_desc_details(eon, &desc);
 
-	desc_free(eon->type_desc + type, 1);
+	desc_free(eon->base.context, eon->type_desc + type, 1);
 	eon->type_desc[type] = desc;
 	return 0;
 }
@@ -619,7 +619,7 @@ static void sample_gas_switch_event(struct sample_data *info, unsigned short idx
  *
  * "enum:0=NoFly Time,1=Depth,2=Surface Time,3=..."
  */
-static const char *lookup_enum(const struct type_desc *desc, unsigned char value)
+static const char *lookup_enum(dc_context_t *context, const struct type_desc *desc, unsigned char value)
 {
 	const char *str = desc->format;
 	unsigned char c;
@@ -663,7 +663,7 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
 		if (n != value)
 			continue;
 
-		ret = (char *)malloc(end - begin + 1);
+		ret = (char *)dc_context_alloc(context, end - begin + 1);
 		if (!ret)
 			break;
 
@@ -680,7 +680,7 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
  */
 static void sample_event_state_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->state_type = lookup_enum(desc, type);
+	info->state_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_state_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -702,7 +702,7 @@ static void sample_event_state_value(const struct type_desc *desc, struct sample
 
 static void sample_event_notify_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->notify_type = lookup_enum(desc, type);
+	info->notify_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_notify_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -725,7 +725,7 @@ static void sample_event_notify_value(const struct type_desc *desc, struct sampl
 
 static void sample_event_warning_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->warning_type = lookup_enum(desc, type);
+	info->warning_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 static void sample_event_warning_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -747,7 +747,7 @@ static void sample_event_warning_value(const struct type_desc *desc, struct samp
 
 static void sample_event_alarm_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->alarm_type = lookup_enum(desc, type);
+	info->alarm_type = lookup_enum(info->eon->base.context, desc, type);
 }
 
 
@@ -772,7 +772,7 @@ static void sample_event_alarm_value(const struct type_desc *desc, struct sample
 static void sample_setpoint_type(const struct type_desc *desc, struct sample_data *info, unsigned char value)
 {
 	dc_sample_value_t sample = {0};
-	const char *type = lookup_enum(desc, value);
+	const char *type = lookup_enum(info->eon->base.context, desc, value);
 
 	if (!type) {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) did not match anything in %s", value, desc->format);
@@ -1116,7 +1116,7 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 		return 0;
 
 	eon->cache.ngases = idx+1;
-	name = lookup_enum(desc, type);
+	name = lookup_enum(eon->base.context, desc, type);
 	if (!name)
 		DEBUG(eon->base.context, "Unable to look up gas type %u in %s", type, desc->format);
 	else if (!strcasecmp(name, "Diluent"))
@@ -1528,7 +1528,7 @@ suunto_eonsteel_parser_set_data(dc_parser_t *parser, const unsigned char *data,
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
+	desc_free(parser->context, eon->type_desc, MAXTYPE);
 	memset(eon->type_desc, 0, sizeof(eon->type_desc));
 	initialize_field_caches(eon);
 	show_all_descriptors(eon);
@@ -1540,7 +1540,7 @@ suunto_eonsteel_parser_destroy(dc_parser_t *parser)
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
+	desc_free(parser->context, eon->type_desc, MAXTYPE);
 
 	return DC_STATUS_SUCCESS;
 }
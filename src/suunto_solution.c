@@ -29,6 +29,7 @@
 #include "ringbuffer.h"
 #include "serial.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &suunto_solution_device_vtable)
 
@@ -98,6 +99,9 @@ suunto_solution_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Clear the RTS line.
 	status = dc_serial_set_rts (device->port, 0);
 	if (status != DC_STATUS_SUCCESS) {
@@ -250,7 +254,7 @@ suunto_solution_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 suunto_solution_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (SZ_MEMORY);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
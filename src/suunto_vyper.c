@@ -31,6 +31,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &suunto_vyper_device_vtable)
 
@@ -127,6 +128,9 @@ suunto_vyper_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
+	// Minimize the latency of the USB serial interface (if any).
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line (power supply for the interface).
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -515,7 +519,7 @@ suunto_vyper_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	// Allocate a memory buffer.
-	dc_buffer_t *buffer = dc_buffer_new (layout->rb_profile_end - layout->rb_profile_begin);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, layout->rb_profile_end - layout->rb_profile_begin);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -0,0 +1,184 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thread.h"
+
+#if defined(_WIN32)
+static DWORD WINAPI
+dc_thread_main (LPVOID arg)
+{
+	dc_thread_t *thread = (dc_thread_t *) arg;
+	thread->func (thread->arg);
+	return 0;
+}
+#elif defined(DC_THREADS)
+static void *
+dc_thread_main (void *arg)
+{
+	dc_thread_t *thread = (dc_thread_t *) arg;
+	thread->func (thread->arg);
+	return NULL;
+}
+#endif
+
+dc_status_t
+dc_thread_start (dc_thread_t *thread, dc_thread_func_t func, void *arg)
+{
+	if (thread == NULL || func == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	thread->func = func;
+	thread->arg = arg;
+
+#if defined(_WIN32)
+	thread->handle = CreateThread (NULL, 0, dc_thread_main, thread, 0, NULL);
+	if (thread->handle == NULL)
+		return DC_STATUS_IO;
+#elif defined(DC_THREADS)
+	if (pthread_create (&thread->handle, NULL, dc_thread_main, thread) != 0)
+		return DC_STATUS_IO;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+
+	return DC_STATUS_SUCCESS;
+}
+
+void
+dc_thread_join (dc_thread_t *thread)
+{
+#if defined(_WIN32)
+	WaitForSingleObject (thread->handle, INFINITE);
+	CloseHandle (thread->handle);
+#elif defined(DC_THREADS)
+	pthread_join (thread->handle, NULL);
+#endif
+}
+
+void
+dc_mutex_init (dc_mutex_t *mutex)
+{
+#if defined(_WIN32)
+	InitializeCriticalSection (mutex);
+#elif defined(DC_THREADS)
+	pthread_mutex_init (mutex, NULL);
+#endif
+}
+
+void
+dc_mutex_free (dc_mutex_t *mutex)
+{
+#if defined(_WIN32)
+	DeleteCriticalSection (mutex);
+#elif defined(DC_THREADS)
+	pthread_mutex_destroy (mutex);
+#endif
+}
+
+void
+dc_mutex_lock (dc_mutex_t *mutex)
+{
+#if defined(_WIN32)
+	EnterCriticalSection (mutex);
+#elif defined(DC_THREADS)
+	pthread_mutex_lock (mutex);
+#endif
+}
+
+void
+dc_mutex_unlock (dc_mutex_t *mutex)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection (mutex);
+#elif defined(DC_THREADS)
+	pthread_mutex_unlock (mutex);
+#endif
+}
+
+void
+dc_cond_init (dc_cond_t *cond)
+{
+#if defined(_WIN32)
+	InitializeConditionVariable (cond);
+#elif defined(DC_THREADS)
+	pthread_cond_init (cond, NULL);
+#endif
+}
+
+void
+dc_cond_free (dc_cond_t *cond)
+{
+#if defined(DC_THREADS) && !defined(_WIN32)
+	pthread_cond_destroy (cond);
+#endif
+}
+
+void
+dc_cond_wait (dc_cond_t *cond, dc_mutex_t *mutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableCS (cond, mutex, INFINITE);
+#elif defined(DC_THREADS)
+	pthread_cond_wait (cond, mutex);
+#endif
+}
+
+void
+dc_cond_signal (dc_cond_t *cond)
+{
+#if defined(_WIN32)
+	WakeConditionVariable (cond);
+#elif defined(DC_THREADS)
+	pthread_cond_signal (cond);
+#endif
+}
+
+void
+dc_cond_broadcast (dc_cond_t *cond)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable (cond);
+#elif defined(DC_THREADS)
+	pthread_cond_broadcast (cond);
+#endif
+}
+
+long
+dc_atomic_add (volatile long *value, long amount)
+{
+#if defined(_WIN32)
+	return InterlockedExchangeAdd (value, amount) + amount;
+#elif defined(DC_THREADS) && defined(__GNUC__)
+	return __sync_add_and_fetch (value, amount);
+#elif defined(DC_THREADS)
+	static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_lock (&mutex);
+	long result = (*value += amount);
+	pthread_mutex_unlock (&mutex);
+	return result;
+#else
+	return *value += amount;
+#endif
+}
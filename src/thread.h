@@ -0,0 +1,116 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_THREAD_H
+#define DC_THREAD_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(_WIN32)
+#define NOGDI
+#include <windows.h>
+#define DC_THREADS
+#elif defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define DC_THREADS
+#endif
+
+#include <libdivecomputer/common.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A minimal wrapper around the native threads (Win32 or POSIX). Without
+ * thread support (DC_THREADS not defined), the mutex and condition
+ * variable functions do nothing, and no thread can be started. The
+ * callers must fall back to doing the work on the calling thread.
+ */
+
+#if defined(_WIN32)
+typedef CRITICAL_SECTION dc_mutex_t;
+typedef CONDITION_VARIABLE dc_cond_t;
+#elif defined(DC_THREADS)
+typedef pthread_mutex_t dc_mutex_t;
+typedef pthread_cond_t dc_cond_t;
+#else
+typedef int dc_mutex_t;
+typedef int dc_cond_t;
+#endif
+
+typedef void (*dc_thread_func_t) (void *arg);
+
+typedef struct dc_thread_t {
+#if defined(_WIN32)
+	HANDLE handle;
+#elif defined(DC_THREADS)
+	pthread_t handle;
+#endif
+	dc_thread_func_t func;
+	void *arg;
+} dc_thread_t;
+
+dc_status_t
+dc_thread_start (dc_thread_t *thread, dc_thread_func_t func, void *arg);
+
+void
+dc_thread_join (dc_thread_t *thread);
+
+void
+dc_mutex_init (dc_mutex_t *mutex);
+
+void
+dc_mutex_free (dc_mutex_t *mutex);
+
+void
+dc_mutex_lock (dc_mutex_t *mutex);
+
+void
+dc_mutex_unlock (dc_mutex_t *mutex);
+
+void
+dc_cond_init (dc_cond_t *cond);
+
+void
+dc_cond_free (dc_cond_t *cond);
+
+void
+dc_cond_wait (dc_cond_t *cond, dc_mutex_t *mutex);
+
+void
+dc_cond_signal (dc_cond_t *cond);
+
+void
+dc_cond_broadcast (dc_cond_t *cond);
+
+/*
+ * Atomically add a value to a counter, and return the new value.
+ */
+long
+dc_atomic_add (volatile long *value, long amount);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_THREAD_H */
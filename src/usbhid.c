@@ -94,7 +94,7 @@ dc_usbhid_open (dc_usbhid_t **out, dc_context_t *context, unsigned int vid, unsi
 	INFO (context, "Open: vid=%04x, pid=%04x", vid, pid);
 
 	// Allocate memory.
-	usbhid = (dc_usbhid_t *) malloc (sizeof (dc_usbhid_t));
+	usbhid = (dc_usbhid_t *) dc_context_alloc (context, sizeof (dc_usbhid_t));
 	if (usbhid == NULL) {
 		ERROR (context, "Out of memory.");
 		return DC_STATUS_NOMEMORY;
@@ -274,7 +274,7 @@ error_hid_exit:
 	hid_exit ();
 #endif
 error_free:
-	free (usbhid);
+	dc_context_dealloc (context, usbhid);
 	return status;
 #else
 	return DC_STATUS_UNSUPPORTED;
@@ -298,7 +298,7 @@ dc_usbhid_close (dc_usbhid_t *usbhid)
 	hid_close(usbhid->handle);
 	hid_exit();
 #endif
-	free (usbhid);
+	dc_context_dealloc (usbhid->context, usbhid);
 
 	return status;
 #else
@@ -30,6 +30,7 @@
 #include "serial.h"
 #include "checksum.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &uwatec_memomouse_device_vtable)
 
@@ -357,7 +358,8 @@ uwatec_memomouse_dump_internal (uwatec_memomouse_device_t *device, dc_buffer_t *
 			return status;
 		}
 
-		dc_serial_sleep (device->port, 300);
+		// Wait for the greeting message.
+		dc_serial_wait (device->port, 300);
 	}
 
 	// Read the ID string.
@@ -411,16 +413,15 @@ uwatec_memomouse_dump_internal (uwatec_memomouse_device_t *device, dc_buffer_t *
 	}
 
 	// Wait for the data packet.
-	while (dc_serial_get_available (device->port, &available) == DC_STATUS_SUCCESS && available == 0) {
+	while (dc_serial_wait (device->port, 100) == DC_STATUS_TIMEOUT) {
 		if (device_is_cancelled (abstract))
 			return DC_STATUS_CANCELLED;
 
 		device_event_emit (&device->base, DC_EVENT_WAITING, NULL);
-		dc_serial_sleep (device->port, 100);
 	}
 
 	// Fetch the current system time.
-	dc_ticks_t now = dc_datetime_now ();
+	dc_ticks_t now = dc_context_now (abstract->context);
 
 	// Read the data packet.
 	rc = uwatec_memomouse_read_packet_inner (device, buffer, &progress);
@@ -482,7 +483,7 @@ uwatec_memomouse_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 uwatec_memomouse_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
@@ -30,6 +30,7 @@
 #include "checksum.h"
 #include "serial.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &uwatec_meridian_device_vtable)
 
@@ -282,6 +283,10 @@ uwatec_meridian_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	uwatec_meridian_device_t *device = (uwatec_meridian_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	// Serve the memory image from the cache, if available.
+	if (device_cache_get (abstract, buffer))
+		return DC_STATUS_SUCCESS;
+
 	// Erase the current contents of the buffer.
 	if (!dc_buffer_clear (buffer)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
@@ -325,7 +330,7 @@ uwatec_meridian_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return rc;
 
 	// Store the clock calibration values.
-	device->systime = dc_datetime_now ();
+	device->systime = dc_context_now (abstract->context);
 	device->devtime = array_uint32_le (devtime);
 
 	// Update and emit a progress event.
@@ -437,6 +442,9 @@ uwatec_meridian_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		nbytes += packetsize - 1;
 	}
 
+	// Keep the memory image for the rest of the session.
+	device_cache_put (abstract, buffer);
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -444,7 +452,7 @@ uwatec_meridian_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 uwatec_meridian_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
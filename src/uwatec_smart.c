@@ -28,6 +28,7 @@
 #include "device-private.h"
 #include "irda.h"
 #include "array.h"
+#include "buffer-private.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &uwatec_smart_device_vtable)
 
@@ -276,7 +277,7 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return rc;
 
 	// Store the clock calibration values.
-	device->systime = dc_datetime_now ();
+	device->systime = dc_context_now (abstract->context);
 	device->devtime = array_uint32_le (devtime);
 
 	// Update and emit a progress event.
@@ -384,7 +385,7 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 uwatec_smart_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	dc_buffer_t *buffer = dc_buffer_allocate (abstract->context, 0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
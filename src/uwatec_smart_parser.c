@@ -157,6 +157,7 @@ static dc_status_t uwatec_smart_parser_set_data (dc_parser_t *abstract, const un
 static dc_status_t uwatec_smart_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t uwatec_smart_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t uwatec_smart_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
 static const dc_parser_vtable_t uwatec_smart_parser_vtable = {
 	sizeof(uwatec_smart_parser_t),
@@ -165,7 +166,9 @@ static const dc_parser_vtable_t uwatec_smart_parser_vtable = {
 	uwatec_smart_parser_get_datetime, /* datetime */
 	uwatec_smart_parser_get_field, /* fields */
 	uwatec_smart_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_iterator */
+	uwatec_smart_parser_samples_foreach_fixed /* samples_foreach_fixed */
 };
 
 static const
@@ -869,7 +872,7 @@ uwatec_smart_fixsignbit (unsigned int x, unsigned int n)
 
 
 static dc_status_t
-uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+uwatec_smart_parser_samples (dc_parser_t *abstract, unsigned int fixed, dc_sample_callback_t callback, void *userdata)
 {
 	uwatec_smart_parser_t *parser = (uwatec_smart_parser_t*) abstract;
 
@@ -908,6 +911,11 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 	double depth = 0, depth_calibration = 0;
 	double temperature = 0;
 	double pressure = 0;
+	// The same values in the raw units (1/50 m, 1/2.5 °C and 1/4 bar),
+	// for the fixed point samples.
+	int rawdepth = 0, rawcalibration = 0;
+	int rawtemperature = 0;
+	int rawpressure = 0;
 	unsigned int heartrate = 0;
 	unsigned int bearing = 0;
 	unsigned int bookmark = 0;
@@ -916,6 +924,7 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 	unsigned int gasmix_previous = 0xFFFFFFFF;
 
 	double salinity = (parser->watertype == DC_WATER_SALT ? SALT : FRESH);
+	int density = (parser->watertype == DC_WATER_SALT ? 1025 : 1000);
 
 	unsigned int interval = 4;
 	if (parser->divemode == DC_DIVEMODE_FREEDIVE) {
@@ -990,6 +999,8 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 		case PRESSURE_DEPTH:
 			pressure += ((signed char) ((svalue >> NBITS) & 0xFF)) / 4.0;
 			depth += ((signed char) (svalue & 0xFF)) / 50.0;
+			rawpressure += (signed char) ((svalue >> NBITS) & 0xFF);
+			rawdepth += (signed char) (svalue & 0xFF);
 			complete = 1;
 			break;
 		case RBT:
@@ -1003,9 +1014,11 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 		case TEMPERATURE:
 			if (table[id].absolute) {
 				temperature = svalue / 2.5;
+				rawtemperature = svalue;
 				have_temperature = 1;
 			} else {
 				temperature += svalue / 2.5;
+				rawtemperature += svalue;
 			}
 			break;
 		case PRESSURE:
@@ -1013,26 +1026,32 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 				if (parser->trimix) {
 					tank = (value & 0xF000) >> 12;
 					pressure = (value & 0x0FFF) / 4.0;
+					rawpressure = value & 0x0FFF;
 				} else {
 					tank = table[id].index;
 					pressure = value / 4.0;
+					rawpressure = value;
 				}
 				have_pressure = 1;
 				gasmix = tank;
 			} else {
 				pressure += svalue / 4.0;
+				rawpressure += svalue;
 			}
 			break;
 		case DEPTH:
 			if (table[id].absolute) {
 				depth = value / 50.0;
+				rawdepth = value;
 				if (!calibrated) {
 					calibrated = 1;
 					depth_calibration = depth;
+					rawcalibration = rawdepth;
 				}
 				have_depth = 1;
 			} else {
 				depth += svalue / 50.0;
+				rawdepth += svalue;
 			}
 			complete = 1;
 			break;
@@ -1157,7 +1176,10 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			}
 
 			if (have_temperature) {
-				sample.temperature = temperature;
+				if (fixed)
+					sample.fixed.temperature = rawtemperature * 400;
+				else
+					sample.temperature = temperature;
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 			}
 
@@ -1177,8 +1199,13 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			if (have_pressure) {
 				idx = uwatec_smart_find_tank(parser, tank);
 				if (idx < parser->ntanks) {
-					sample.pressure.tank = idx;
-					sample.pressure.value = pressure;
+					if (fixed) {
+						sample.fixed.pressure.tank = idx;
+						sample.fixed.pressure.value = rawpressure * 250;
+					} else {
+						sample.pressure.tank = idx;
+						sample.pressure.value = pressure;
+					}
 					if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 				}
 			}
@@ -1195,7 +1222,10 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			}
 
 			if (have_depth) {
-				sample.depth = (depth - depth_calibration) / salinity;
+				if (fixed)
+					sample.fixed.depth = dc_fixed_scale (rawdepth - rawcalibration, 20 * 1000, density);
+				else
+					sample.depth = (depth - depth_calibration) / salinity;
 				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 			}
 
@@ -1208,3 +1238,17 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return uwatec_smart_parser_samples (abstract, 0, callback, userdata);
+}
+
+
+static dc_status_t
+uwatec_smart_parser_samples_foreach_fixed (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
+{
+	return uwatec_smart_parser_samples (abstract, 1, callback, userdata);
+}